@@ -0,0 +1,280 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			EventSched.cpp
+ *
+ * Purpose: 		Implementation of EventSched class.
+ *							Events are kept in a binary heap (std::push_heap,
+ *							std::pop_heap), so scheduling and dispatching
+ *							costs O(log n) and checking for due event is
+ *							a single comparison.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#include <algorithm>
+#include "EventSched.h"
+
+namespace MKBasic {
+
+// Heap order: later event is "less", so the nearest event is on top.
+// Events due at the same cycle are dispatched in order of scheduling.
+static bool SchedEventLater(const SchedEvent &a, const SchedEvent &b)
+{
+	return (a.cycle > b.cycle
+					|| (a.cycle == b.cycle && a.handle > b.handle));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EventSched()
+ * Purpose:		Class default constructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+EventSched::EventSched()
+{
+	mCycles = 0;
+	mNextCycle = EVTSCHED_NEVER;
+	mLastHandle = 0;
+	mEvents.clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~EventSched()
+ * Purpose:		Class destructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+EventSched::~EventSched()
+{
+
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetCycles()
+ * Purpose:		Get # of CPU cycles elapsed.
+ * Arguments:	n/a
+ * Returns:		unsigned long long - cycles
+ *--------------------------------------------------------------------
+ */
+unsigned long long EventSched::GetCycles()
+{
+	return mCycles;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetNextCycle()
+ * Purpose:		Get cycle of the nearest scheduled event.
+ * Arguments:	n/a
+ * Returns:		unsigned long long - cycle, EVTSCHED_NEVER if there
+ *            are no events
+ *--------------------------------------------------------------------
+ */
+unsigned long long EventSched::GetNextCycle()
+{
+	return mNextCycle;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Schedule()
+ * Purpose:		Schedule event after given # of cycles.
+ * Arguments:	delay - # of cycles from now (0 is treated as 1,
+ *                    the event is dispatched on the next cycle)
+ *            phdlr - receiver of the event
+ *            evtid - event code passed to receiver
+ * Returns:		unsigned long - event handle (for Cancel())
+ *--------------------------------------------------------------------
+ */
+unsigned long EventSched::Schedule(unsigned long delay,
+																	 EventHandler *phdlr,
+																	 int evtid)
+{
+	SchedEvent evt;
+	evt.cycle = mCycles + ((delay > 0) ? delay : 1);
+	evt.handle = ++mLastHandle;
+	evt.evtid = evtid;
+	evt.phdlr = phdlr;
+	mEvents.push_back(evt);
+	push_heap(mEvents.begin(), mEvents.end(), SchedEventLater);
+	UpdateNext();
+
+	return evt.handle;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Cancel()
+ * Purpose:		Remove scheduled event.
+ * Arguments:	handle - event handle returned by Schedule()
+ * Returns:		bool - true if event was pending
+ *--------------------------------------------------------------------
+ */
+bool EventSched::Cancel(unsigned long handle)
+{
+	for (vector<SchedEvent>::iterator it = mEvents.begin();
+			 it != mEvents.end();
+			 ++it
+			) {
+		if (it->handle == handle) {
+			mEvents.erase(it);
+			make_heap(mEvents.begin(), mEvents.end(), SchedEventLater);
+			UpdateNext();
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		CancelAll()
+ * Purpose:		Remove all events scheduled for given receiver.
+ * Arguments:	phdlr - receiver of events
+ * Returns:		int - # of removed events
+ *--------------------------------------------------------------------
+ */
+int EventSched::CancelAll(EventHandler *phdlr)
+{
+	vector<SchedEvent> events_new;
+	for (vector<SchedEvent>::iterator it = mEvents.begin();
+			 it != mEvents.end();
+			 ++it
+			) {
+		if (it->phdlr != phdlr) events_new.push_back(*it);
+	}
+	int ret = (int)(mEvents.size() - events_new.size());
+	if (ret > 0) {
+		mEvents = events_new;
+		make_heap(mEvents.begin(), mEvents.end(), SchedEventLater);
+		UpdateNext();
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsScheduled()
+ * Purpose:		Check if event is pending.
+ * Arguments:	handle - event handle returned by Schedule()
+ * Returns:		bool - true if pending
+ *--------------------------------------------------------------------
+ */
+bool EventSched::IsScheduled(unsigned long handle)
+{
+	for (vector<SchedEvent>::iterator it = mEvents.begin();
+			 it != mEvents.end();
+			 ++it
+			) {
+		if (it->handle == handle) return true;
+	}
+	return false;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDueCycle()
+ * Purpose:		Get CPU cycle when pending event is due.
+ * Arguments:	handle - event handle returned by Schedule()
+ * Returns:		unsigned long long - due cycle or EVTSCHED_NEVER if
+ *						event is not pending
+ *--------------------------------------------------------------------
+ */
+unsigned long long EventSched::GetDueCycle(unsigned long handle)
+{
+	for (vector<SchedEvent>::iterator it = mEvents.begin();
+			 it != mEvents.end();
+			 ++it
+			) {
+		if (it->handle == handle) return it->cycle;
+	}
+	return EVTSCHED_NEVER;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetNumEvents()
+ * Purpose:		Get # of pending events.
+ * Arguments:	n/a
+ * Returns:		int - # of events
+ *--------------------------------------------------------------------
+ */
+int EventSched::GetNumEvents()
+{
+	return (int) mEvents.size();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Clear()
+ * Purpose:		Remove all events. Cycle counter is not changed.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void EventSched::Clear()
+{
+	mEvents.clear();
+	mNextCycle = EVTSCHED_NEVER;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		RunDue()
+ * Purpose:		Dispatch all events due at or before current cycle.
+ *            Event is removed before its handler is called, so the
+ *            handler may schedule it again (periodic events).
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void EventSched::RunDue()
+{
+	while (!mEvents.empty() && mEvents.front().cycle <= mCycles) {
+		pop_heap(mEvents.begin(), mEvents.end(), SchedEventLater);
+		SchedEvent evt = mEvents.back();
+		mEvents.pop_back();
+		UpdateNext();
+		if (NULL != evt.phdlr) evt.phdlr->HandleEvent(evt.evtid, mCycles);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		UpdateNext()
+ * Purpose:		Update cycle of the nearest event.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void EventSched::UpdateNext()
+{
+	mNextCycle = (mEvents.empty() ? EVTSCHED_NEVER : mEvents.front().cycle);
+}
+
+} // namespace MKBasic
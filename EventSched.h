@@ -0,0 +1,107 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			EventSched.h
+ *
+ * Purpose: 		Prototype of EventSched class - scheduler of events
+ *							(device and interrupt actions) timed in CPU clock
+ *							cycles, and EventHandler interface of the objects
+ *							receiving the events.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#ifndef EVENTSCHED_H
+#define EVENTSCHED_H
+
+#include <vector>
+
+#define EVTSCHED_NEVER	0xFFFFFFFFFFFFFFFFULL	// no event pending
+
+using namespace std;
+
+namespace MKBasic {
+
+// Object receiving scheduled events.
+class EventHandler {
+
+	public:
+
+		virtual ~EventHandler() {}
+		// evtid - event code given when scheduled, cycle - current cycle
+		virtual void HandleEvent(int evtid, unsigned long long cycle) = 0;
+
+};
+
+// Scheduled event.
+struct SchedEvent {
+	unsigned long long	cycle;		// CPU cycle when event is due
+	unsigned long				handle;		// unique id, also keeps order of events
+																// due at the same cycle
+	int									evtid;		// event code passed to handler
+	EventHandler				*phdlr;		// receiver of event
+};
+
+// Scheduler of events timed in CPU clock cycles.
+// Events are kept in a min-heap ordered by due cycle, the emulation
+// loop only compares the cycle counter with the cycle of the nearest
+// event (Tick()).
+class EventSched {
+
+	public:
+
+		EventSched();
+		~EventSched();
+
+		// Advance clock by one cycle and dispatch due events.
+		void Tick()
+		{
+			if (++mCycles >= mNextCycle) RunDue();
+		}
+
+		unsigned long long GetCycles();
+		unsigned long long GetNextCycle();
+		unsigned long Schedule(unsigned long delay,
+													 EventHandler *phdlr,
+													 int evtid);
+		bool Cancel(unsigned long handle);
+		int CancelAll(EventHandler *phdlr);
+		bool IsScheduled(unsigned long handle);
+		unsigned long long GetDueCycle(unsigned long handle);
+		int GetNumEvents();
+		void Clear();
+
+	private:
+
+		unsigned long long	mCycles;			// CPU cycles elapsed
+		unsigned long long	mNextCycle;		// cycle of the nearest event
+		unsigned long				mLastHandle;	// last assigned event handle
+		vector<SchedEvent>	mEvents;			// heap, nearest event on top
+
+		void RunDue();
+		void UpdateNext();
+
+};
+
+} // namespace MKBasic
+
+#endif
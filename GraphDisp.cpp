@@ -35,6 +35,9 @@
 
  *--------------------------------------------------------------------
  */
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include "GraphDisp.h"
 #include "MKGenException.h"
 #include "system.h"
@@ -55,6 +58,7 @@ namespace MKBasic {
  */
 GraphDisp::GraphDisp()
 {
+	mBackendType = GRDISP_BACKEND_SDL;
 	Initialize();
 }
 
@@ -73,6 +77,21 @@ GraphDisp::GraphDisp(int width, int height)
 {
 	mWidth = width;
 	mHeight = height;
+	mBackendType = GRDISP_BACKEND_SDL;
+	Initialize();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp()
+ * Purpose:		Class custom constructor.
+ * Arguments:	backend - integer, display backend (GraphDispBackends)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+GraphDisp::GraphDisp(int backend)
+{
+	mBackendType = backend;
 	Initialize();
 }
 
@@ -86,11 +105,10 @@ GraphDisp::GraphDisp(int width, int height)
  */
 GraphDisp::~GraphDisp()
 {
-	mContLoop = false;
-	while (mMainLoopActive);
-	SDL_DestroyRenderer(mpRenderer);
-	SDL_DestroyWindow(mpWindow);
-	SDL_Quit();
+	Stop();
+	CloseDisplay();
+	if (NULL != mpBackend) delete mpBackend;
+	if (NULL != mpFrameBuf) delete [] mpFrameBuf;
 }
 
 /*
@@ -99,71 +117,55 @@ GraphDisp::~GraphDisp()
  * Purpose:		Initialize class members, objects.
  * Arguments:	n/a
  * Returns:		n/a
- * Problems:
- *    SDL_CreateWindow with flags:
- *    SDL_WINDOW_SHOWN|SDL_WINDOW_BORDERLESS|SDL_WINDOW_RESIZABLE
- *    creates window with no title/icon/system buttons, but with
- *    a frame, which can be used to resize it. The problem is, when
- *    it is resized, it stops updating correctly.
  *--------------------------------------------------------------------
  */
 void GraphDisp::Initialize()
 {
-	int desk_w, desk_h, winbd_top = 5, winbd_right = 5;
-
 	mContLoop = true;
 	mMainLoopActive = false;		
 
 	mWidth 	= GRDISP_VR_X;			// virtual display width
 	mHeight = GRDISP_VR_Y;		// virtual display height
 	
-	mPixelSizeX = GRAPHDISP_MAXW / mWidth;
-	mPixelSizeY = GRAPHDISP_MAXH / mHeight;
-
-	mWinPosX = 0;			// SDL window position coordinate X
-	mWinPosY = 0;			// SDL window position coordinate Y
 	mBgRgbR = 0;			// bg color, RGB red intensity
 	mBgRgbG = 0;			// bg color, RGB green intensity
 	mBgRgbB = 0;			// bg color, RGB blue intensity
 	mFgRgbR = 0xFF;		// fg color, RGB red intensity
 	mFgRgbG = 0xFF;		// fg color, RGB green intensity
 	mFgRgbB = 0xFF;		// fg color, RGB blue intensity		
+	mBgColor = GRDISP_RGB(mBgRgbR, mBgRgbG, mBgRgbB);
+	mFgColor = GRDISP_RGB(mFgRgbR, mFgRgbG, mFgRgbB);
+	BuildGlyphLUT();
 
-	mpWindow = NULL;
-	mpSurface = NULL;
-	mpRenderer = NULL;
-
-	GetDesktopResolution(desk_w, desk_h);
-	// Available in version > 2.0.4
-	//SDL_GetWindowBordersSize(mpWindow, &winbd_top, NULL, NULL, &winbd_right);
-	mWinPosX = desk_w - GRAPHDISP_MAXW - winbd_right;
-	mWinPosY = winbd_top;
-
-	SDL_Init(SDL_INIT_VIDEO);
-
-	mpWindow = SDL_CreateWindow(
-		"GraphDisp", 
-		mWinPosX,
-		mWinPosY,
-		GRAPHDISP_MAXW, 
-		GRAPHDISP_MAXH, 
-		SDL_WINDOW_SHOWN|SDL_WINDOW_BORDERLESS|SDL_WINDOW_RESIZABLE
-		);
-
-	if (NULL == mpWindow) {
-		throw MKGenException(SDL_GetError());
-	}
-
-  // Get window surface
-  mpSurface = SDL_GetWindowSurface(mpWindow);
+	mpBackend = NULL;
+	mBackendOpen = false;
+	mDisplayClosed = false;
+	mLoopStarted = false;
+	mCloseEvent = false;
+	mCmdHead = 0;
+	mCmdTail = 0;
+	mPixelCount = 0;
+	mDirty = false;
+	SetFrameRate(GRDISP_FPS);
+	mLastFrame = high_resolution_clock::now();
+	mLastEvents = mLastFrame;
 
-	// Create renderer for window
-	mpRenderer = SDL_CreateRenderer(mpWindow, -1, SDL_RENDERER_SOFTWARE);
-  //mpRenderer = SDL_GetRenderer(mpWindow);	
+	mpFrameBuf = new Uint32[mWidth * mHeight];
+	if (NULL == mpFrameBuf) {
+		throw MKGenException("GraphDisp::Initialize() : Out of memory - framebuffer");
+	}
 
-	if (NULL == mpRenderer) {
-		throw MKGenException(SDL_GetError());
-	}	  
+	if (GRDISP_BACKEND_OFFSCREEN == mBackendType) {
+		mpBackend = new OffscreenGraphBackend();
+	} else {
+		mBackendType = GRDISP_BACKEND_SDL;
+		mpBackend = new SDLGraphBackend();
+	}
+	if (NULL == mpBackend) {
+		throw MKGenException("GraphDisp::Initialize() : Out of memory - backend");
+	}
+	// display is opened by the thread that presents the frames,
+	// see OpenDisplay()
 
   Clear();
 
@@ -172,103 +174,274 @@ void GraphDisp::Initialize()
 /*
  *--------------------------------------------------------------------
  * Method:		ClearScreen()
- * Purpose:		Clear the surface. Update screen.
+ * Purpose:		Clear the framebuffer. Update screen.
  * Arguments:	n/a
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
 void GraphDisp::ClearScreen()
 {
-	Clear();
-  UpdateSurface();	
+	PostCmd(GRDISP_CMD_CLRSCR, 0, 0, 0, 0, 0);
 }
 
 /*
  *--------------------------------------------------------------------
  * Method:		Clear()
- * Purpose:		Clear the surface.
+ * Purpose:		Clear the framebuffer (fill with background color).
  * Arguments:	n/a
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
 void GraphDisp::Clear()
 {
-  //Fill the surface with background color
-  SDL_FillRect(mpSurface, NULL, SDL_MapRGB(mpSurface->format, 
-  																				 mBgRgbR, 
-  																				 mBgRgbG, 
-  																				 mBgRgbB));
+	int n = mWidth * mHeight;
+	for (int i=0; i<n; i++) mpFrameBuf[i] = mBgColor;
+	MarkDirty(0, 0, mWidth-1, mHeight-1);
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		UpdateSurface()
- * Purpose:		Update window surface.
+ * Method:		Update()
+ * Purpose:		Present the framebuffer in the window if it changed and
+ *            the frame interval has elapsed since the last frame.
+ *            Nothing to do if render thread is running, it presents
+ *            the frames itself.
  * Arguments:	n/a
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
-void GraphDisp::UpdateSurface()
+void GraphDisp::Update()
 {
-  //Update the surface
-  SDL_UpdateWindowSurface(mpWindow);
+	if (mMainLoopActive) return;
+	DrainCmds();
+	UpdateFrame();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		Update()
- * Purpose:		Update window surface (public).
+ * Method:		UpdateFrame()
+ * Purpose:		Present the framebuffer if it changed and the frame
+ *            interval has elapsed since the last frame.
  * Arguments:	n/a
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
-void GraphDisp::Update()
+void GraphDisp::UpdateFrame()
 {
-  //Update the surface
-  UpdateSurface();
+	if (!mDirty) return;
+	auto now = high_resolution_clock::now();
+	if (duration_cast<microseconds>(now-mLastFrame).count() >= mFrameUsec) {
+		Present();
+		mLastFrame = now;
+	}
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		RenderPixel()
- * Purpose:		Set or unset pixel (scaled) on graphics display
- * 						surface.
- * Arguments:	x, y - integer, virtual pixel coordinates
- *						set - boolean, set or unset pixel
+ * Method:		Refresh()
+ * Purpose:		Present the framebuffer changes in the window now,
+ *            regardless of the frame rate. Returns when all drawing
+ *            requested so far is done and presented.
+ * Arguments:	n/a
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
-void GraphDisp::RenderPixel(int x, int y, bool set)
+void GraphDisp::Refresh()
+{
+	PostCmd(GRDISP_CMD_REFRESH, 0, 0, 0, 0, 0);
+	Sync();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Present()
+ * Purpose:		Present the dirty rectangle of the framebuffer with
+ *            the display backend.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::Present()
 {
-	SDL_Rect rtf;
+	if (!mBackendOpen) OpenDisplay();
+	lock_guard<mutex> lock(mBackendMutex);
+	if (mBackendOpen) {
+		mpBackend->Present(mDirtyX1,
+											 mDirtyY1,
+											 mDirtyX2 - mDirtyX1 + 1,
+											 mDirtyY2 - mDirtyY1 + 1);
+	}
+	mDirty = false;
+}
 
-	rtf.x = x * mPixelSizeX; rtf.y = y * mPixelSizeY;
-	rtf.w = mPixelSizeX;
-	rtf.h = mPixelSizeY;
+/*
+ *--------------------------------------------------------------------
+ * Method:		OpenDisplay()
+ * Purpose:		Open the display with the backend, unless it is open
+ *            or was closed already. SDL window has to be created and
+ *            its events read by the same thread, therefore the
+ *            display is opened by the render thread (or the caller's
+ *            thread if render thread is not running).
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::OpenDisplay()
+{
+	lock_guard<mutex> lock(mBackendMutex);
+	if (!mBackendOpen && !mDisplayClosed && NULL != mpBackend) {
+		mpBackend->Open(mpFrameBuf, mWidth, mHeight);
+		mBackendOpen = true;
+	}
+}
 
-	int rgb_r = 0, rgb_g = 0, rgb_b = 0;
+/*
+ *--------------------------------------------------------------------
+ * Method:		CloseDisplay()
+ * Purpose:		Close the display (delete backend). Framebuffer stays
+ *            and drawing continues in memory only.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::CloseDisplay()
+{
+	lock_guard<mutex> lock(mBackendMutex);
+	if (NULL != mpBackend) {
+		delete mpBackend;
+		mpBackend = NULL;
+	}
+	mBackendOpen = false;
+	mDisplayClosed = true;
+}
 
-	if (set) {
-		rgb_r = mFgRgbR;
-		rgb_g = mFgRgbG;
-		rgb_b = mFgRgbB;
+/*
+ *--------------------------------------------------------------------
+ * Method:		MarkDirty()
+ * Purpose:		Extend the dirty rectangle of the framebuffer.
+ * Arguments:	x1, y1 - upper-left corner (virtual coordinates)
+ *            x2, y2 - lower-right corner (inclusive)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::MarkDirty(int x1, int y1, int x2, int y2)
+{
+	if (!mDirty) {
+		mDirtyX1 = x1; mDirtyY1 = y1;
+		mDirtyX2 = x2; mDirtyY2 = y2;
+		mDirty = true;
 	} else {
-		rgb_r = mBgRgbR;
-		rgb_g = mBgRgbG;
-		rgb_b = mBgRgbB;
+		if (x1 < mDirtyX1) mDirtyX1 = x1;
+		if (y1 < mDirtyY1) mDirtyY1 = y1;
+		if (x2 > mDirtyX2) mDirtyX2 = x2;
+		if (y2 > mDirtyY2) mDirtyY2 = y2;
 	}
+}
 
-	// set or unset pixel
-	SDL_FillRect(mpSurface, &rtf, SDL_MapRGB(mpSurface->format, rgb_r, rgb_g, rgb_b));
+/*
+ *--------------------------------------------------------------------
+ * Method:		PutPixel()
+ * Purpose:		Store pixel in the framebuffer. Pixels outside of the
+ *            virtual display are clipped.
+ * Arguments:	x, y - integer, virtual pixel coordinates
+ *						color - packed pixel color
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::PutPixel(int x, int y, Uint32 color)
+{
+	if (x < 0 || y < 0 || x >= mWidth || y >= mHeight) return;
+	mpFrameBuf[y * mWidth + x] = color;
+	mPixelCount++;
+	MarkDirty(x, y, x, y);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetFrameRate()
+ * Purpose:		Set the rate of the framebuffer presentation.
+ * Arguments:	fps - frames per second (1 .. GRDISP_MAXFPS)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::SetFrameRate(int fps)
+{
+	if (fps < 1) fps = 1;
+	if (fps > GRDISP_MAXFPS) fps = GRDISP_MAXFPS;
+	mFrameRate = fps;
+	mFrameUsec = 1000000 / fps;
+}
 
-  //Update the surface
-  SDL_UpdateWindowSurface(mpWindow);	
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetFrameRate()
+ * Purpose:		Return the rate of the framebuffer presentation.
+ * Arguments:	n/a
+ * Returns:		int - frames per second
+ *--------------------------------------------------------------------
+ */
+int GraphDisp::GetFrameRate()
+{
+	return mFrameRate;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetPixelCount()
+ * Purpose:		Return # of pixels written to the framebuffer so far
+ *            (waits for pending drawing).
+ * Arguments:	n/a
+ * Returns:		unsigned long - pixel count
+ *--------------------------------------------------------------------
+ */
+unsigned long GraphDisp::GetPixelCount()
+{
+	Sync();
+	return mPixelCount;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		RenderPixel()
+ * Purpose:		Set or unset pixel in the framebuffer.
+ * Arguments:	x, y - integer, virtual pixel coordinates
+ *						set - boolean, set or unset pixel
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::RenderPixel(int x, int y, bool set)
+{
+	PutPixel(x, y, (set ? mFgColor : mBgColor));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    BuildGlyphLUT()
+ * Purpose:   Expand each possible glyph row (8-bit pattern) to 8
+ *            pixels of current fg/bg colors.
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::BuildGlyphLUT()
+{
+	for (int n=0; n<256; n++) {
+		for (int i=0; i<8; i++) {
+			mGlyphRowLUT[n][i] = ((n & (0x80 >> i)) ? mFgColor : mBgColor);
+		}
+	}
+	mGlyphFgColor = mFgColor;
+	mGlyphBgColor = mBgColor;
 }
 
 /*
  *--------------------------------------------------------------------
  * Method:    RendedChar8x8()
  * Purpose:   Draw 8x8 character from its pixel definition.	
+ *            Rows of the character fully inside the display are
+ *            copied from the glyph row lookup table, 8 pixels at
+ *            once. Character crossing the display edge is clipped
+ *            pixel by pixel.
  * Arguments: chdef - character definition in 8x8 bit matrix
  *						x, y - coordinates
  *						reversed - reversed (true) or normal (false)
@@ -277,31 +450,56 @@ void GraphDisp::RenderPixel(int x, int y, bool set)
  */
 void GraphDisp::RenderChar8x8(unsigned char chdef[8], int x, int y, bool reversed)
 {
-	SDL_Rect rtf;
-
-	int rgb_r = 0, rgb_g = 0, rgb_b = 0;	
+	if (x >= 0 && y >= 0 && x + 8 <= mWidth && y + 8 <= mHeight) {
+		if (mGlyphFgColor != mFgColor || mGlyphBgColor != mBgColor) {
+			BuildGlyphLUT();	// colors changed since last character
+		}
+		unsigned char rev = (reversed ? 0xFF : 0x00);
+		Uint32 *p = mpFrameBuf + y * mWidth + x;
+		for (int j=0; j < 8; j++, p += mWidth) {
+			memcpy(p, mGlyphRowLUT[chdef[j] ^ rev], 8 * sizeof(Uint32));
+		}
+		mPixelCount += 64;
+		MarkDirty(x, y, x + 7, y + 7);
+		return;
+	}
 	for (int yy = y, j=0; j < 8; j++, yy++) {
 		unsigned char chd = chdef[j];
 		for (int xx = x, i=0; i < 8; i++, xx++) {
 			bool pixset = (chd & 0x80) == 0x80;
 			if (reversed) pixset = !pixset;
-			rtf.x = xx * mPixelSizeX; rtf.y = yy * mPixelSizeY;
-			rtf.w = mPixelSizeX;
-			rtf.h = mPixelSizeY;			
-			if (pixset) {
-				rgb_r = mFgRgbR;
-				rgb_g = mFgRgbG;
-				rgb_b = mFgRgbB;
-			} else {
-				rgb_r = mBgRgbR;
-				rgb_g = mBgRgbG;
-				rgb_b = mBgRgbB;
-			}
-			SDL_FillRect(mpSurface, &rtf, SDL_MapRGB(mpSurface->format, rgb_r, rgb_g, rgb_b));			
+			PutPixel(xx, yy, (pixset ? mFgColor : mBgColor));
 			chd = chd << 1; chd &= 0xFE;
 		}
 	}
-	SDL_UpdateWindowSurface(mpWindow);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    RenderBitmap32()
+ * Purpose:   Draw up to 32 pixels of 1bpp bitmap row using glyph row
+ *            lookup table, 8 pixels at once. Bytes that do not fit
+ *            on the screen are skipped.
+ * Arguments: x, y - coordinates of the leftmost pixel
+ *            bits - pixels, bit 31 is the leftmost
+ *            nbytes - # of bytes (8 pixels each) to draw, 1..4
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::RenderBitmap32(int x, int y, Uint32 bits, int nbytes)
+{
+	if (x < 0 || y < 0 || y >= mHeight) return;
+	if (nbytes > (mWidth - x) / 8) nbytes = (mWidth - x) / 8;
+	if (nbytes <= 0) return;
+	if (mGlyphFgColor != mFgColor || mGlyphBgColor != mBgColor) {
+		BuildGlyphLUT();
+	}
+	Uint32 *p = mpFrameBuf + y * mWidth + x;
+	for (int i=0; i < nbytes; i++, p += 8) {
+		memcpy(p, mGlyphRowLUT[(bits >> (24 - i * 8)) & 0xFF], 8 * sizeof(Uint32));
+	}
+	mPixelCount += nbytes * 8;
+	MarkDirty(x, y, x + nbytes * 8 - 1, y);
 }
 
 /*
@@ -314,6 +512,7 @@ void GraphDisp::RenderChar8x8(unsigned char chdef[8], int x, int y, bool reverse
  */
 void GraphDisp::CopyCharRom8x8(unsigned char *pchrom)
 {
+	Sync();	// queued characters are rendered with the current table
 	for (int i=0; i<CHROM_8x8_SIZE; i++) {
 		mCharROM8x8[i] = pchrom[i];
 	}
@@ -331,14 +530,7 @@ void GraphDisp::CopyCharRom8x8(unsigned char *pchrom)
  */
 void GraphDisp::PrintChar8x8(int code, int col, int row, bool reversed)
 {
-	int x = col * 8;
-	int y = row * 8;
-	int n = code * 8;
-	unsigned char chdef[8];
-	for (int i=0; i<8; i++) {
-		chdef[i] = mCharROM8x8[n+i];
-	}
-	RenderChar8x8(chdef, x, y, reversed);
+	PostCmd(GRDISP_CMD_PUTC8x8, code & 0xFF, col, row, 0, (reversed ? 1 : 0));
 }
 
 /*
@@ -351,7 +543,7 @@ void GraphDisp::PrintChar8x8(int code, int col, int row, bool reversed)
  */
 void GraphDisp::SetPixel(int x, int y)
 {
-	RenderPixel(x, y, true);
+	PostCmd(GRDISP_CMD_SETPXL, x, y, 0, 0, 0);
 }
 
 /*
@@ -365,33 +557,66 @@ void GraphDisp::SetPixel(int x, int y)
  */
 void GraphDisp::ErasePixel(int x, int y)
 {
-	RenderPixel(x, y, false);
+	PostCmd(GRDISP_CMD_CLRPXL, x, y, 0, 0, 0);
 }
 
 /*
  *--------------------------------------------------------------------
  * Method:		DrawLine()
  * Purpose:		Draw or erase line between specified points.
+ *            Integer Bresenham algorithm, directly into framebuffer.
  * Arguments:	x1, y1 - coordinates of first point
  *            x2, y2 - coordinates of second point
+ *            draworerase - draw (true) or erase (false)
  * Returns:   n/a
  *--------------------------------------------------------------------
  */
 void GraphDisp::DrawLine(int x1, int y1, int x2, int y2, bool draworerase)
 {
-	int colR = mFgRgbR, colG = mFgRgbG, colB = mFgRgbB;
+	Uint32 color = (draworerase ? mFgColor : mBgColor);
+	int dx = abs(x2 - x1), sx = (x1 < x2 ? 1 : -1);
+	int dy = -abs(y2 - y1), sy = (y1 < y2 ? 1 : -1);
+	int err = dx + dy, e2 = 0;
+	int bx1 = max(min(x1, x2), 0), bx2 = min(max(x1, x2), mWidth-1);
+	int by1 = max(min(y1, y2), 0), by2 = min(max(y1, y2), mHeight-1);
 
-	if (false == draworerase) {
-		colR = mBgRgbR;
-		colG = mBgRgbG;
-		colB = mBgRgbB;
+	if (bx1 > bx2 || by1 > by2) return;	// entirely off screen
+	while (true) {
+		if (x1 >= 0 && y1 >= 0 && x1 < mWidth && y1 < mHeight) {
+			mpFrameBuf[y1 * mWidth + x1] = color;
+			mPixelCount++;
+		}
+		if (x1 == x2 && y1 == y2) break;
+		e2 = 2 * err;
+		if (e2 >= dy) { err += dy; x1 += sx; }
+		if (e2 <= dx) { err += dx; y1 += sy; }
 	}
+	MarkDirty(bx1, by1, bx2, by2);
+}
 
-	SDL_SetRenderDrawColor(mpRenderer, colR, colG, colB, SDL_ALPHA_OPAQUE);
-	SDL_RenderSetLogicalSize(mpRenderer, mWidth, mHeight);
-	SDL_RenderSetScale(mpRenderer, mPixelSizeX, mPixelSizeY);
-	SDL_RenderDrawLine(mpRenderer, x1, y1, x2, y2);
-	SDL_RenderPresent(mpRenderer);
+/*
+ *--------------------------------------------------------------------
+ * Method:		FillRect()
+ * Purpose:		Fill or erase rectangle, clipped to display.
+ * Arguments:	x1, y1 - coordinates of one corner
+ *            x2, y2 - coordinates of the opposite corner
+ *            fillorerase - fill with fg color (true) or bg (false)
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::FillRect(int x1, int y1, int x2, int y2, bool fillorerase)
+{
+	Uint32 color = (fillorerase ? mFgColor : mBgColor);
+	int bx1 = max(min(x1, x2), 0), bx2 = min(max(x1, x2), mWidth-1);
+	int by1 = max(min(y1, y2), 0), by2 = min(max(y1, y2), mHeight-1);
+
+	if (bx1 > bx2 || by1 > by2) return;	// entirely off screen
+	for (int y = by1; y <= by2; y++) {
+		Uint32 *p = mpFrameBuf + y * mWidth;
+		fill(p + bx1, p + bx2 + 1, color);
+	}
+	mPixelCount += (unsigned long)(bx2 - bx1 + 1) * (by2 - by1 + 1);
+	MarkDirty(bx1, by1, bx2, by2);
 }
 
 /*
@@ -405,7 +630,7 @@ void GraphDisp::DrawLine(int x1, int y1, int x2, int y2, bool draworerase)
  */
 void GraphDisp::DrawLine(int x1, int y1, int x2, int y2)
 {
-	DrawLine(x1, y1, x2, y2, true);
+	PostCmd(GRDISP_CMD_DRAWLN, x1, y1, x2, y2, 0);
 }
 
 /*
@@ -419,7 +644,74 @@ void GraphDisp::DrawLine(int x1, int y1, int x2, int y2)
  */
 void GraphDisp::EraseLine(int x1, int y1, int x2, int y2)
 {
-	DrawLine(x1, y1, x2, y2, false);
+	PostCmd(GRDISP_CMD_ERASLN, x1, y1, x2, y2, 0);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		FillRect()
+ * Purpose:		Fill rectangle with foreground color.
+ * Arguments:	x1, y1 - coordinates of one corner
+ *            x2, y2 - coordinates of the opposite corner
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::FillRect(int x1, int y1, int x2, int y2)
+{
+	PostCmd(GRDISP_CMD_FILLRC, x1, y1, x2, y2, 0);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EraseRect()
+ * Purpose:		Erase rectangle (fill with BG color).
+ * Arguments:	x1, y1 - coordinates of one corner
+ *            x2, y2 - coordinates of the opposite corner
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::EraseRect(int x1, int y1, int x2, int y2)
+{
+	PostCmd(GRDISP_CMD_ERASRC, x1, y1, x2, y2, 0);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DrawHSpan()
+ * Purpose:		Draw horizontal span of pixels with foreground color.
+ * Arguments:	x1, x2 - begin and end column
+ *            y - row
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::DrawHSpan(int x1, int x2, int y)
+{
+	PostCmd(GRDISP_CMD_HSPAN, x1, y, x2, 0, 0);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DrawBitmap32()
+ * Purpose:		Draw up to 32 pixels of 1 bit per pixel bitmap in a row,
+ *            set bits in fg color, cleared bits in bg color.
+ * Arguments:	x, y - coordinates of the leftmost pixel
+ *            pbits - 4 bytes of bitmap, bit 7 of first byte is the
+ *                    leftmost pixel
+ *            nbytes - # of bytes to draw (1..4)
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::DrawBitmap32(int x, int y, unsigned char *pbits, int nbytes)
+{
+	GraphDispCmd gdc;
+
+	gdc.cmd = GRDISP_CMD_BMP32;
+	gdc.flag = (unsigned char) nbytes;
+	gdc.x1 = (short) x; gdc.y1 = (short) y;
+	gdc.x2 = gdc.y2 = 0;
+	gdc.bits = ((Uint32) pbits[0] << 24) | ((Uint32) pbits[1] << 16)
+						 | ((Uint32) pbits[2] << 8) | (Uint32) pbits[3];
+	PostCmd(gdc);
 }
 
 /*
@@ -432,9 +724,7 @@ void GraphDisp::EraseLine(int x1, int y1, int x2, int y2)
  */
 void GraphDisp::SetBgColor(int r, int g, int b)
 {
-	mBgRgbR = r;
-	mBgRgbG = g;
-	mBgRgbB = b;
+	PostCmd(GRDISP_CMD_SETBGC, r, g, b, 0, 0);
 }
 
 /*
@@ -447,15 +737,14 @@ void GraphDisp::SetBgColor(int r, int g, int b)
  */
 void GraphDisp::SetFgColor(int r, int g, int b)
 {
-	mFgRgbR = r;
-	mFgRgbG = g;
-	mFgRgbB = b;
+	PostCmd(GRDISP_CMD_SETFGC, r, g, b, 0, 0);
 }
 
 /*
  *--------------------------------------------------------------------
  * Method:		MainLoop()
- * Purpose:		The main loop to process SDL events and update window.
+ * Purpose:		The main loop to render draw commands, process SDL
+ *            events and update window.
  *            This is a global function meant to run in a thread.
  * Arguments:	n/a
  * Returns:		n/a
@@ -463,25 +752,77 @@ void GraphDisp::SetFgColor(int r, int g, int b)
  */
 void MainLoop(GraphDisp *pgd)
 {
-	pgd->mMainLoopActive = true;
-	while (pgd->mContLoop) {
-		pgd->ReadEvents();
-		pgd->Update();
-  }
-  pgd->mMainLoopActive = false;
+	pgd->RenderLoop();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		Start()
- * Purpose:		Starts MainLoop in a thread.
+ * Method:		RenderLoop()
+ * Purpose:		Body of the render thread. Open display, then until
+ *            stopped: render queued draw commands, present frames at
+ *            the frame rate and read window events every
+ *            GRDISP_EVENT_USEC. On exit, render what is left in the
+ *            queue and close the display.
  * Arguments:	n/a
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
+void GraphDisp::RenderLoop()
+{
+	try {
+		OpenDisplay();
+		mMainLoopActive = true;
+	} catch (MKGenException& ex) {
+		mLoopErr = ex.GetCause();
+	}
+	mLoopStarted = true;
+	if (!mMainLoopActive) return;
+	try {
+		while (mContLoop) {
+			int n = DrainCmds();
+			auto now = high_resolution_clock::now();
+			if (duration_cast<microseconds>(now-mLastEvents).count()
+					>= GRDISP_EVENT_USEC) {
+				PollEvents();
+				mLastEvents = now;
+			}
+			UpdateFrame();
+			if (0 == n) this_thread::sleep_for(microseconds(GRDISP_IDLE_USEC));
+		}
+		DrainCmds();
+		if (mDirty) Present();
+	} catch (MKGenException& ex) {
+		mLoopErr = ex.GetCause();
+	}
+	CloseDisplay();
+	mMainLoopActive = false;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Start()
+ * Purpose:		Starts MainLoop in a thread. From now on the drawing
+ *            methods only queue the commands, the render thread
+ *            executes them.
+ * Arguments:	pgd - pointer to this object
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
 void GraphDisp::Start(GraphDisp *pgd)
 {
+	if (mMainLoopActive) return;
+	if (mMainLoopThread.joinable()) mMainLoopThread.join();
+	mContLoop = true;
+	mLoopStarted = false;
 	mMainLoopThread = thread(MainLoop,pgd);
+	// wait until render thread opens the display
+	while (!mLoopStarted) this_thread::yield();
+	if (!mMainLoopActive) {
+		mMainLoopThread.join();
+		string err = mLoopErr;
+		mLoopErr.clear();
+		throw MKGenException(err);
+	}
 }
 
 /*
@@ -495,7 +836,7 @@ void GraphDisp::Start(GraphDisp *pgd)
 void GraphDisp::Stop()
 {
 	mContLoop = false;
-	mMainLoopThread.join();
+	if (mMainLoopThread.joinable()) mMainLoopThread.join();
 }
 
 /*
@@ -513,86 +854,253 @@ bool GraphDisp::IsMainLoopActive()
 
 /*
  *--------------------------------------------------------------------
- * Method:		ReadEvents()
- * Purpose:		Read events and perform actions when needed.	
+ * Method:		PostCmd()
+ * Purpose:		Queue draw command for the render thread. Waits if the
+ *            queue is full. If render thread is not running, the
+ *            command is executed right away.
+ * Arguments:	cmd - command code (GraphDispCmds)
+ *            x1, y1, x2, y2, flag - arguments (see GraphDispCmds)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::PostCmd(int cmd, int x1, int y1, int x2, int y2, int flag)
+{
+	GraphDispCmd gdc;
+
+	gdc.cmd = (unsigned char) cmd;
+	gdc.flag = (unsigned char) flag;
+	gdc.x1 = (short) x1; gdc.y1 = (short) y1;
+	gdc.x2 = (short) x2; gdc.y2 = (short) y2;
+	gdc.bits = 0;
+	PostCmd(gdc);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PostCmd()
+ * Purpose:		Queue prepared draw command, see above.
+ * Arguments:	gdc - command
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::PostCmd(GraphDispCmd& gdc)
+{
+	if (!mMainLoopActive) {
+		DrainCmds();	// left by render thread that ended
+		ExecCmd(gdc);
+		return;
+	}
+	unsigned int head = mCmdHead.load(memory_order_relaxed);
+	while (head - mCmdTail.load(memory_order_acquire) >= GRDISP_CMDQ_SIZE) {
+		if (!mMainLoopActive) {
+			DrainCmds();
+			break;
+		}
+		this_thread::yield();
+	}
+	mCmdQueue[head & (GRDISP_CMDQ_SIZE - 1)] = gdc;
+	mCmdHead.store(head + 1, memory_order_release);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DrainCmds()
+ * Purpose:		Execute all queued draw commands.
+ *            Only one thread may consume the queue at a time: the
+ *            render thread or, when it is not running, the caller.
  * Arguments:	n/a
+ * Returns:		int - # of executed commands
+ *--------------------------------------------------------------------
+ */
+int GraphDisp::DrainCmds()
+{
+	unsigned int tail = mCmdTail.load(memory_order_relaxed);
+	unsigned int head = mCmdHead.load(memory_order_acquire);
+	int n = 0;
+
+	while (tail != head) {
+		ExecCmd(mCmdQueue[tail & (GRDISP_CMDQ_SIZE - 1)]);
+		// command is done, release its slot
+		mCmdTail.store(++tail, memory_order_release);
+		n++;
+	}
+	return n;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ExecCmd()
+ * Purpose:		Execute draw command - render to framebuffer.
+ * Arguments:	gdc - draw command
  * Returns:		n/a
- * Problems:
- *    By blitting (copying) surface I wanted to avoid loosing already
- *    drawn pixels during windows resize, but this doesn't work.
  *--------------------------------------------------------------------
  */
-void GraphDisp::ReadEvents()
+void GraphDisp::ExecCmd(GraphDispCmd& gdc)
 {
-		SDL_Event e;
-		SDL_Surface *pTmpSurface;
-
-		while (SDL_PollEvent(&e)) {
-
-			switch (e.type) {
-
-				case SDL_QUIT:
-					mContLoop = false;
-					break;
-
-				case SDL_WINDOWEVENT:
-					if (SDL_WINDOWEVENT_RESIZED == e.window.event) {
-
-						pTmpSurface = SDL_CreateRGBSurface(0, 
-																							 mpSurface->w,
-																							 mpSurface->h,
-																							 mpSurface->format->BitsPerPixel,
-                                  						 mpSurface->format->Rmask, 
-                                  						 mpSurface->format->Gmask,
-                                  						 mpSurface->format->Bmask, 
-                                  						 mpSurface->format->Amask);
-						SDL_SetWindowSize(mpWindow, GRAPHDISP_MAXW, GRAPHDISP_MAXH);
-						mpSurface = SDL_GetWindowSurface(mpWindow);
-						SDL_SetWindowPosition(mpWindow, mWinPosX, mWinPosY);
-						SDL_SetSurfaceAlphaMod(pTmpSurface, 0);
-						SDL_BlitSurface(pTmpSurface, 0, mpSurface, 0);						
-						UpdateSurface();
-						SDL_FreeSurface(pTmpSurface);						
-
-					} else if (SDL_WINDOWEVENT_FOCUS_GAINED == e.window.event) {
-
-						SDL_RaiseWindow(mpWindow);
-						
-					}
-					break;
-
-				default:
-					break;
+	switch (gdc.cmd) {
+		case GRDISP_CMD_SETPXL:
+			RenderPixel(gdc.x1, gdc.y1, true);
+			break;
+		case GRDISP_CMD_CLRPXL:
+			RenderPixel(gdc.x1, gdc.y1, false);
+			break;
+		case GRDISP_CMD_DRAWLN:
+			DrawLine(gdc.x1, gdc.y1, gdc.x2, gdc.y2, true);
+			break;
+		case GRDISP_CMD_ERASLN:
+			DrawLine(gdc.x1, gdc.y1, gdc.x2, gdc.y2, false);
+			break;
+		case GRDISP_CMD_SETBGC:
+			mBgRgbR = gdc.x1;
+			mBgRgbG = gdc.y1;
+			mBgRgbB = gdc.x2;
+			mBgColor = GRDISP_RGB(mBgRgbR, mBgRgbG, mBgRgbB);
+			break;
+		case GRDISP_CMD_SETFGC:
+			mFgRgbR = gdc.x1;
+			mFgRgbG = gdc.y1;
+			mFgRgbB = gdc.x2;
+			mFgColor = GRDISP_RGB(mFgRgbR, mFgRgbG, mFgRgbB);
+			break;
+		case GRDISP_CMD_CLRSCR:
+			Clear();
+			Present();
+			mLastFrame = high_resolution_clock::now();
+			break;
+		case GRDISP_CMD_PUTC8x8:
+			RenderChar8x8(mCharROM8x8 + gdc.x1 * 8,
+										gdc.y1 * 8,
+										gdc.x2 * 8,
+										(gdc.flag != 0));
+			break;
+		case GRDISP_CMD_REFRESH:
+			if (mDirty) {
+				Present();
+				mLastFrame = high_resolution_clock::now();
 			}
+			break;
+		case GRDISP_CMD_FILLRC:
+			FillRect(gdc.x1, gdc.y1, gdc.x2, gdc.y2, true);
+			break;
+		case GRDISP_CMD_ERASRC:
+			FillRect(gdc.x1, gdc.y1, gdc.x2, gdc.y2, false);
+			break;
+		case GRDISP_CMD_HSPAN:
+			FillRect(gdc.x1, gdc.y1, gdc.x2, gdc.y1, true);
+			break;
+		case GRDISP_CMD_BMP32:
+			RenderBitmap32(gdc.x1, gdc.y1, gdc.bits, gdc.flag);
+			break;
+		default:
+			break;
+	}
+}
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		Sync()
+ * Purpose:		Barrier - wait until all queued draw commands are
+ *            rendered to framebuffer. Use before reading results of
+ *            drawing (framebuffer, stats). Reports error that ended
+ *            the render thread.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::Sync()
+{
+	while (mCmdTail.load(memory_order_acquire)
+				 != mCmdHead.load(memory_order_relaxed)) {
+		if (!mMainLoopActive) {
+			DrainCmds();
+			break;
 		}
+		this_thread::yield();
+	}
+	if (!mMainLoopActive && mLoopErr.length() > 0) {
+		string err = mLoopErr;
+		mLoopErr.clear();
+		throw MKGenException(err);
+	}
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		ReadEvents()
+ * Purpose:		Read events from the display backend.
+ *            Nothing to do if render thread is running, it reads
+ *            the events itself.
+ * Arguments:	n/a
+ * Returns:		n/a
  *--------------------------------------------------------------------
  */
-void GraphDisp::GetDesktopResolution(int& horizontal, int& vertical)
-{
-#if defined(WINDOWS)	
-   RECT desktop;
-   // Get a handle to the desktop window
-   const HWND hDesktop = GetDesktopWindow();
-   // Get the size of screen to the variable desktop
-   GetWindowRect(hDesktop, &desktop);
-   // The top left corner will have coordinates (0,0)
-   // and the bottom right corner will have coordinates
-   // (horizontal, vertical)
-   horizontal = desktop.right;
-   vertical = desktop.bottom;
-#else
-   horizontal = GRAPHDISP_MAXW;
-   vertical = GRAPHDISP_MAXH;
-#endif   
+void GraphDisp::ReadEvents()
+{
+	if (mMainLoopActive) return;
+	PollEvents();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PollEvents()
+ * Purpose:		Read events from the display backend. If display was
+ *            closed, end main loop and post the close event.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::PollEvents()
+{
+	if (!mBackendOpen) OpenDisplay();
+	if (mBackendOpen && false == mpBackend->ReadEvents()) {
+		mContLoop = false;
+		mCloseEvent = true;
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetCloseEvent()
+ * Purpose:		Check if window was closed by user since last call.
+ *            Window events are read by the render thread, this is
+ *            how the emulation thread learns about them.
+ * Arguments:	n/a
+ * Returns:		bool - true if window was closed
+ *--------------------------------------------------------------------
+ */
+bool GraphDisp::GetCloseEvent()
+{
+	return mCloseEvent.exchange(false);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SaveImage()
+ * Purpose:		Save current framebuffer contents (virtual resolution)
+ *            to binary PPM file.
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, -1 if error
+ *--------------------------------------------------------------------
+ */
+int GraphDisp::SaveImage(string fname)
+{
+	Sync();
+	return WritePPM(fname, mpFrameBuf, mWidth, mHeight);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetFrameDump()
+ * Purpose:		Save each presented frame to file, see
+ *            GraphDispBackend::SetFrameDump().
+ * Arguments:	prefix - file name prefix, empty string disables dump
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void GraphDisp::SetFrameDump(string prefix)
+{
+	lock_guard<mutex> lock(mBackendMutex);
+	if (NULL != mpBackend) mpBackend->SetFrameDump(prefix);
 }
 
 } // namespace MKBasic
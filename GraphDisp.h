@@ -38,29 +38,64 @@
  */
 
 #include <thread>
+#include <chrono>
+#include <string>
+#include <atomic>
+#include <mutex>
 #include <SDL.h>
+#include "GraphDispBackend.h"
 
 // defaults
 #define GRDISP_VR_X	320
 #define GRDISP_VR_Y	200
 #define CHROM_8x8_SIZE	2048
+#define GRDISP_FPS	60		// default frame presentation rate (frames/sec)
+#define GRDISP_MAXFPS	1000
+#define GRDISP_CMDQ_SIZE	16384	// draw commands queue size (power of 2)
+#define GRDISP_IDLE_USEC	500		// render thread sleep time when idle
+#define GRDISP_EVENT_USEC	10000	// window events polling interval
 
 using namespace std; 
+using namespace chrono;
 
 namespace MKBasic {
 
-const int GRAPHDISP_MAXW = 960; // "real" display width or maximum virtual width
-const int GRAPHDISP_MAXH = 600; // "real" display width or maximum virtual height
+// Draw commands passed from emulation thread to render thread.
+enum GraphDispCmds {
+	GRDISP_CMD_SETPXL = 0,	// set pixel x1,y1
+	GRDISP_CMD_CLRPXL,			// erase pixel x1,y1
+	GRDISP_CMD_DRAWLN,			// draw line x1,y1 - x2,y2
+	GRDISP_CMD_ERASLN,			// erase line x1,y1 - x2,y2
+	GRDISP_CMD_SETBGC,			// set bg color, RGB in x1,y1,x2
+	GRDISP_CMD_SETFGC,			// set fg color, RGB in x1,y1,x2
+	GRDISP_CMD_CLRSCR,			// clear screen
+	GRDISP_CMD_PUTC8x8,			// print char x1 at col y1, row x2
+	GRDISP_CMD_REFRESH,			// present changes now
+	GRDISP_CMD_FILLRC,			// fill rectangle x1,y1 - x2,y2
+	GRDISP_CMD_ERASRC,			// erase rectangle x1,y1 - x2,y2
+	GRDISP_CMD_HSPAN,				// draw horizontal span x1 - x2, row y1
+	GRDISP_CMD_BMP32				// up to 32 pixels 1bpp at x1,y1, bits in bits,
+													// # of bytes in flag
+};
+
+struct GraphDispCmd {
+	unsigned char cmd;			// GraphDispCmds
+	unsigned char flag;			// reversed character
+	short x1, y1;						// coordinates or arguments
+	short x2, y2;						// (see GraphDispCmds)
+	Uint32 bits;						// bitmap of GRDISP_CMD_BMP32
+};
 
 class GraphDisp {
 
 	public:
 
-		bool mContLoop;	// = true;
-		bool mMainLoopActive;	// = false;		
+		atomic<bool> mContLoop;	// = true;
+		atomic<bool> mMainLoopActive;	// = false;		
 
 		GraphDisp();
 		GraphDisp(int width, int height);
+		GraphDisp(int backend);
 		~GraphDisp();
 		void Start(GraphDisp *pgd);
 		void Stop();
@@ -68,6 +103,10 @@ class GraphDisp {
 		void ErasePixel(int x, int y);
 		void DrawLine(int x1, int y1, int x2, int y2);
 		void EraseLine(int x1, int y1, int x2, int y2);
+		void FillRect(int x1, int y1, int x2, int y2);
+		void EraseRect(int x1, int y1, int x2, int y2);
+		void DrawHSpan(int x1, int x2, int y);
+		void DrawBitmap32(int x, int y, unsigned char *pbits, int nbytes);
 		void SetBgColor(int r, int g, int b);
 		void SetFgColor(int r, int g, int b);
 		void Update();
@@ -77,34 +116,76 @@ class GraphDisp {
 		bool IsMainLoopActive();
 		void PrintChar8x8(int code, int col, int row, bool reversed);
 		void CopyCharRom8x8(unsigned char *pchrom);
+		void Refresh();
+		void SetFrameRate(int fps);
+		int GetFrameRate();
+		unsigned long GetPixelCount();
+		int SaveImage(string fname);
+		void SetFrameDump(string prefix);
+		void Sync();
+		void RenderLoop();
+		bool GetCloseEvent();
 
 	private:
 
 		int	mWidth;								// virtual display width
 		int mHeight;							// virtual display height
-		int mPixelSizeX;					// virtual pixel width
-		int mPixelSizeY;					// virtual pixel height
-		int mWinPosX;							// SDL window position coordinate X
-		int mWinPosY;							// SDL window position coordinate Y
 		int mBgRgbR;							// bg color, RGB red intensity
 		int mBgRgbG;							// bg color, RGB green intensity
 		int mBgRgbB;							// bg color, RGB blue intensity
 		int mFgRgbR;							// fg color, RGB red intensity
 		int mFgRgbG;							// fg color, RGB green intensity
 		int mFgRgbB;							// fg color, RGB blue intensity		
-		SDL_Window *mpWindow;
-		SDL_Surface *mpSurface;
-		SDL_Renderer *mpRenderer;
+		int mBackendType;					// GraphDispBackends
+		GraphDispBackend *mpBackend;	// presents the framebuffer
 		thread mMainLoopThread;
 		unsigned char mCharROM8x8[CHROM_8x8_SIZE];
+		// glyph row (bit pattern) expanded to 8 pixels of fg/bg colors
+		Uint32 mGlyphRowLUT[256][8];
+		Uint32 mGlyphFgColor;			// colors mGlyphRowLUT was built for
+		Uint32 mGlyphBgColor;
+		Uint32 *mpFrameBuf;				// framebuffer, virtual resolution
+		Uint32 mFgColor;					// packed fg color
+		Uint32 mBgColor;					// packed bg color
+		bool mDirty;							// framebuffer changed since last frame
+		int mDirtyX1, mDirtyY1;		// dirty rectangle (inclusive,
+		int mDirtyX2, mDirtyY2;		// virtual coordinates)
+		int mFrameRate;						// frames presented per second
+		atomic<long> mFrameUsec;	// frame interval (usec)
+		time_point<high_resolution_clock> mLastFrame;	// last presentation
+		time_point<high_resolution_clock> mLastEvents;	// last events poll
+		atomic<bool> mCloseEvent;	// window closed by user, not reported yet
+		unsigned long mPixelCount;	// # of pixels written (stats)
+		// single producer (emulation thread), single consumer (render
+		// thread) queue of draw commands, indexes run freely and wrap
+		GraphDispCmd mCmdQueue[GRDISP_CMDQ_SIZE];
+		atomic<unsigned int> mCmdHead;	// next free slot (producer)
+		atomic<unsigned int> mCmdTail;	// next command to render (consumer)
+		atomic<bool> mLoopStarted;	// render thread initialized
+		string mLoopErr;					// error that ended render thread
+		mutex mBackendMutex;			// backend access
+		bool mBackendOpen;				// display opened by backend
+		bool mDisplayClosed;			// display closed, render to memory only
 
 		void Initialize();
-		void UpdateSurface();
 		void Clear();
-		void GetDesktopResolution(int& horizontal, int& vertical);
 		void DrawLine(int x1, int y1, int x2, int y2, bool draworerase);
+		void FillRect(int x1, int y1, int x2, int y2, bool fillorerase);
 		void RenderPixel(int x, int y, bool set);
 		void RenderChar8x8(unsigned char chdef[8], int x, int y, bool reversed);
+		void PutPixel(int x, int y, Uint32 color);
+		void BuildGlyphLUT();
+		void RenderBitmap32(int x, int y, Uint32 bits, int nbytes);
+		void MarkDirty(int x1, int y1, int x2, int y2);
+		void Present();
+		void UpdateFrame();
+		void OpenDisplay();
+		void CloseDisplay();
+		void PollEvents();
+		void PostCmd(int cmd, int x1, int y1, int x2, int y2, int flag);
+		void PostCmd(GraphDispCmd& gdc);
+		int  DrainCmds();
+		void ExecCmd(GraphDispCmd& gdc);
 
 }; // class GraphDisp
 
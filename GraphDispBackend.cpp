@@ -0,0 +1,424 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			GraphDispBackend.cpp
+ *
+ * Purpose: 		Implementation of graphics display backends.
+ *							SDLGraphBackend presents the GraphDisp framebuffer
+ *							in the SDL window, OffscreenGraphBackend keeps it
+ *							in memory only, so the graphics device can be used
+ *							with no display (batch runs, tests) and the frames
+ *							can be saved to image files.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include "GraphDispBackend.h"
+#include "MKGenException.h"
+#include "system.h"
+
+#if defined(WINDOWS)
+#include "wtypes.h"
+#endif
+
+namespace MKBasic {
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		WritePPM()
+ * Purpose:		Save 32-bit ARGB image to binary PPM (P6) file.
+ *            Alpha channel is dropped.
+ * Arguments:	fname - file name
+ *            pimg - pointer to image pixels (row by row)
+ *            width, height - image dimensions
+ * Returns:		int - 0 if OK, -1 if error
+ *--------------------------------------------------------------------
+ */
+int WritePPM(string fname, Uint32 *pimg, int width, int height)
+{
+	FILE *fp = fopen(fname.c_str(), "wb");
+	if (NULL == fp) return -1;
+
+	int ret = 0;
+	unsigned char *prow = new unsigned char[width * 3];
+	if (NULL == prow) {
+		fclose(fp);
+		return -1;
+	}
+	fprintf(fp, "P6\n%d %d\n255\n", width, height);
+	for (int y = 0; y < height && 0 == ret; y++) {
+		Uint32 *ppix = pimg + y * width;
+		for (int x = 0; x < width; x++) {
+			prow[x*3]   = (unsigned char)((ppix[x] & GRDISP_RMASK) >> 16);
+			prow[x*3+1] = (unsigned char)((ppix[x] & GRDISP_GMASK) >> 8);
+			prow[x*3+2] = (unsigned char)(ppix[x] & GRDISP_BMASK);
+		}
+		if (fwrite(prow, 1, width * 3, fp) != (size_t)(width * 3)) ret = -1;
+	}
+	delete [] prow;
+	fclose(fp);
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DumpFrame()
+ * Purpose:		Save the whole frame to file named:
+ *            prefix_NNNNNN.ppm (NNNNNN - frame number).
+ * Arguments:	prefix - file name prefix
+ *            num - frame number
+ *            pfb - pointer to framebuffer
+ *            width, height - framebuffer dimensions
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+static void DumpFrame(string prefix, unsigned long num, Uint32 *pfb,
+											int width, int height)
+{
+	char suffix[16];
+	sprintf(suffix, "_%06lu.ppm", num);
+	if (0 != WritePPM(prefix + suffix, pfb, width, height)) {
+		throw MKGenException("Unable to write frame dump file: " + prefix + suffix);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SDLGraphBackend()
+ * Purpose:		Class default constructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+SDLGraphBackend::SDLGraphBackend()
+{
+	mpWindow = NULL;
+	mpSurface = NULL;
+	mpFrameSurf = NULL;
+	mpFrameBuf = NULL;
+	mWidth = mHeight = 0;
+	mDumpPrefix.clear();
+	mFrameNum = 0;
+	mPixelSizeX = mPixelSizeY = 1;
+	mWinPosX = 0;
+	mWinPosY = 0;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~SDLGraphBackend()
+ * Purpose:		Class destructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+SDLGraphBackend::~SDLGraphBackend()
+{
+	if (NULL != mpFrameSurf) SDL_FreeSurface(mpFrameSurf);
+	if (NULL != mpWindow) SDL_DestroyWindow(mpWindow);
+	SDL_Quit();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Open()
+ * Purpose:		Create SDL window and attach the framebuffer.
+ * Arguments:	pfb - pointer to framebuffer (32-bit ARGB)
+ *            width, height - virtual display dimensions
+ * Returns:		n/a
+ * Problems:
+ *    SDL_CreateWindow with flags:
+ *    SDL_WINDOW_SHOWN|SDL_WINDOW_BORDERLESS|SDL_WINDOW_RESIZABLE
+ *    creates window with no title/icon/system buttons, but with
+ *    a frame, which can be used to resize it. The problem is, when
+ *    it is resized, it stops updating correctly.
+ *--------------------------------------------------------------------
+ */
+void SDLGraphBackend::Open(Uint32 *pfb, int width, int height)
+{
+	int desk_w, desk_h, winbd_top = 5, winbd_right = 5;
+
+	mpFrameBuf = pfb;
+	mWidth = width;
+	mHeight = height;
+	mPixelSizeX = GRAPHDISP_MAXW / mWidth;
+	mPixelSizeY = GRAPHDISP_MAXH / mHeight;
+
+	GetDesktopResolution(desk_w, desk_h);
+	// Available in version > 2.0.4
+	//SDL_GetWindowBordersSize(mpWindow, &winbd_top, NULL, NULL, &winbd_right);
+	mWinPosX = desk_w - GRAPHDISP_MAXW - winbd_right;
+	mWinPosY = winbd_top;
+
+	SDL_Init(SDL_INIT_VIDEO);
+
+	mpWindow = SDL_CreateWindow(
+		"GraphDisp",
+		mWinPosX,
+		mWinPosY,
+		GRAPHDISP_MAXW,
+		GRAPHDISP_MAXH,
+		SDL_WINDOW_SHOWN|SDL_WINDOW_BORDERLESS|SDL_WINDOW_RESIZABLE
+		);
+
+	if (NULL == mpWindow) {
+		throw MKGenException(SDL_GetError());
+	}
+
+  // Get window surface
+  mpSurface = SDL_GetWindowSurface(mpWindow);
+
+	// wrap the framebuffer, so its dirty part can be scaled to window
+	// surface in a single blit
+	mpFrameSurf = SDL_CreateRGBSurfaceFrom(pfb,
+																				 mWidth,
+																				 mHeight,
+																				 32,
+																				 mWidth * sizeof(Uint32),
+																				 GRDISP_RMASK,
+																				 GRDISP_GMASK,
+																				 GRDISP_BMASK,
+																				 GRDISP_AMASK);
+	if (NULL == mpFrameSurf) {
+		throw MKGenException(SDL_GetError());
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Present()
+ * Purpose:		Show the rectangle of the framebuffer in the window.
+ *            If frame dump is enabled, save the whole frame to file
+ *            named: prefix_NNNNNN.ppm (NNNNNN - frame number).
+ * Arguments:	x, y, w, h - rectangle (virtual coordinates)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SDLGraphBackend::Present(int x, int y, int w, int h)
+{
+	Update(x, y, w, h);
+	if (mDumpPrefix.length() > 0 && NULL != mpFrameBuf) {
+		DumpFrame(mDumpPrefix, mFrameNum, mpFrameBuf, mWidth, mHeight);
+	}
+	mFrameNum++;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Update()
+ * Purpose:		Scale the rectangle of the framebuffer to the window
+ *            surface and update that part of the window.
+ * Arguments:	x, y, w, h - rectangle (virtual coordinates)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SDLGraphBackend::Update(int x, int y, int w, int h)
+{
+	SDL_Rect src, dst;
+
+	src.x = x; src.y = y;
+	src.w = w; src.h = h;
+	dst.x = x * mPixelSizeX; dst.y = y * mPixelSizeY;
+	dst.w = w * mPixelSizeX;
+	dst.h = h * mPixelSizeY;
+	SDL_BlitScaled(mpFrameSurf, &src, mpSurface, &dst);
+	SDL_UpdateWindowSurfaceRects(mpWindow, &dst, 1);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ReadEvents()
+ * Purpose:		Read events and perform actions when needed.
+ *            Window contents are restored from the framebuffer after
+ *            resize.
+ * Arguments:	n/a
+ * Returns:		bool - false if window was closed
+ *--------------------------------------------------------------------
+ */
+bool SDLGraphBackend::ReadEvents()
+{
+		SDL_Event e;
+		bool ret = true;
+
+		while (SDL_PollEvent(&e)) {
+
+			switch (e.type) {
+
+				case SDL_QUIT:
+					ret = false;
+					break;
+
+				case SDL_WINDOWEVENT:
+					if (SDL_WINDOWEVENT_RESIZED == e.window.event) {
+
+						SDL_SetWindowSize(mpWindow, GRAPHDISP_MAXW, GRAPHDISP_MAXH);
+						mpSurface = SDL_GetWindowSurface(mpWindow);
+						SDL_SetWindowPosition(mpWindow, mWinPosX, mWinPosY);
+						Update(0, 0, mWidth, mHeight);
+
+					} else if (SDL_WINDOWEVENT_FOCUS_GAINED == e.window.event) {
+
+						SDL_RaiseWindow(mpWindow);
+
+					}
+					break;
+
+				default:
+					break;
+			}
+
+		}
+
+		return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetFrameDump()
+ * Purpose:		Enable or disable saving of each presented frame.
+ * Arguments:	prefix - file name prefix, empty string disables dump
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SDLGraphBackend::SetFrameDump(string prefix)
+{
+	mDumpPrefix = prefix;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDesktopResolution()
+ * Purpose:		Get the size of the desktop.
+ * Arguments:	horizontal, vertical - references to returned values
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SDLGraphBackend::GetDesktopResolution(int& horizontal, int& vertical)
+{
+#if defined(WINDOWS)
+   RECT desktop;
+   // Get a handle to the desktop window
+   const HWND hDesktop = GetDesktopWindow();
+   // Get the size of screen to the variable desktop
+   GetWindowRect(hDesktop, &desktop);
+   // The top left corner will have coordinates (0,0)
+   // and the bottom right corner will have coordinates
+   // (horizontal, vertical)
+   horizontal = desktop.right;
+   vertical = desktop.bottom;
+#else
+   horizontal = GRAPHDISP_MAXW;
+   vertical = GRAPHDISP_MAXH;
+#endif
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		OffscreenGraphBackend()
+ * Purpose:		Class default constructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+OffscreenGraphBackend::OffscreenGraphBackend()
+{
+	mpFrameBuf = NULL;
+	mWidth = mHeight = 0;
+	mDumpPrefix.clear();
+	mFrameNum = 0;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~OffscreenGraphBackend()
+ * Purpose:		Class destructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+OffscreenGraphBackend::~OffscreenGraphBackend()
+{
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Open()
+ * Purpose:		Attach the framebuffer. No display is opened.
+ * Arguments:	pfb - pointer to framebuffer (32-bit ARGB)
+ *            width, height - virtual display dimensions
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void OffscreenGraphBackend::Open(Uint32 *pfb, int width, int height)
+{
+	mpFrameBuf = pfb;
+	mWidth = width;
+	mHeight = height;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Present()
+ * Purpose:		The framebuffer already holds the image. If frame dump
+ *            is enabled, save the whole frame to file named:
+ *            prefix_NNNNNN.ppm (NNNNNN - frame number).
+ * Arguments:	x, y, w, h - changed rectangle (not used)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void OffscreenGraphBackend::Present(int x, int y, int w, int h)
+{
+	if (mDumpPrefix.length() > 0 && NULL != mpFrameBuf) {
+		DumpFrame(mDumpPrefix, mFrameNum, mpFrameBuf, mWidth, mHeight);
+	}
+	mFrameNum++;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ReadEvents()
+ * Purpose:		No events to process with no display.
+ * Arguments:	n/a
+ * Returns:		bool - always true
+ *--------------------------------------------------------------------
+ */
+bool OffscreenGraphBackend::ReadEvents()
+{
+	return true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetFrameDump()
+ * Purpose:		Enable or disable saving of each presented frame.
+ * Arguments:	prefix - file name prefix, empty string disables dump
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void OffscreenGraphBackend::SetFrameDump(string prefix)
+{
+	mDumpPrefix = prefix;
+}
+
+} // namespace MKBasic
@@ -0,0 +1,139 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			GraphDispBackend.h
+ *
+ * Purpose: 		Prototype of GraphDispBackend interface and its
+ *							implementations: SDLGraphBackend (window) and
+ *							OffscreenGraphBackend (memory only, no display).
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#ifndef GRAPHDISPBACKEND_H
+#define GRAPHDISPBACKEND_H
+
+/*
+ * Presentation layer of the graphics display device.
+ * GraphDisp draws into its framebuffer, the backend shows it.
+ */
+
+#include <string>
+#include <SDL.h>
+
+// framebuffer pixel format (32-bit ARGB)
+#define GRDISP_AMASK	0xFF000000
+#define GRDISP_RMASK	0x00FF0000
+#define GRDISP_GMASK	0x0000FF00
+#define GRDISP_BMASK	0x000000FF
+#define GRDISP_RGB(r,g,b)	(GRDISP_AMASK | (((r) & 0xFF) << 16) \
+													| (((g) & 0xFF) << 8) | ((b) & 0xFF))
+
+using namespace std;
+
+namespace MKBasic {
+
+// supported backends
+enum GraphDispBackends {
+	GRDISP_BACKEND_SDL				= 0,	// SDL window
+	GRDISP_BACKEND_OFFSCREEN	= 1		// memory only (headless)
+};
+
+const int GRAPHDISP_MAXW = 960; // "real" display width or maximum virtual width
+const int GRAPHDISP_MAXH = 600; // "real" display width or maximum virtual height
+
+// write 32-bit ARGB image to binary PPM (P6) file
+int WritePPM(string fname, Uint32 *pimg, int width, int height);
+
+// Interface of the graphics display backend.
+class GraphDispBackend {
+
+	public:
+
+		virtual ~GraphDispBackend() {}
+		// attach framebuffer (virtual resolution), open the display
+		virtual void Open(Uint32 *pfb, int width, int height) = 0;
+		// show the rectangle of the framebuffer (virtual coordinates)
+		virtual void Present(int x, int y, int w, int h) = 0;
+		// process events, return false if display was closed by user
+		virtual bool ReadEvents() = 0;
+		virtual void SetFrameDump(string prefix) = 0;
+
+};
+
+// Display in the SDL window, each virtual pixel scaled up.
+class SDLGraphBackend : public GraphDispBackend {
+
+	public:
+
+		SDLGraphBackend();
+		~SDLGraphBackend();
+		void Open(Uint32 *pfb, int width, int height);
+		void Present(int x, int y, int w, int h);
+		bool ReadEvents();
+		void SetFrameDump(string prefix);
+
+	private:
+
+		Uint32 *mpFrameBuf;				// attached framebuffer
+		int mWidth;								// virtual display width
+		int mHeight;							// virtual display height
+		string mDumpPrefix;				// frame dump file name prefix, empty - off
+		unsigned long mFrameNum;	// # of presented frames
+		int mPixelSizeX;					// virtual pixel width
+		int mPixelSizeY;					// virtual pixel height
+		int mWinPosX;							// SDL window position coordinate X
+		int mWinPosY;							// SDL window position coordinate Y
+		SDL_Window *mpWindow;
+		SDL_Surface *mpSurface;
+		SDL_Surface *mpFrameSurf;	// SDL surface wrapping the framebuffer
+
+		void GetDesktopResolution(int& horizontal, int& vertical);
+		void Update(int x, int y, int w, int h);
+
+};
+
+// Render to memory only, optionally dump each presented frame to file.
+class OffscreenGraphBackend : public GraphDispBackend {
+
+	public:
+
+		OffscreenGraphBackend();
+		~OffscreenGraphBackend();
+		void Open(Uint32 *pfb, int width, int height);
+		void Present(int x, int y, int w, int h);
+		bool ReadEvents();
+		void SetFrameDump(string prefix);
+
+	private:
+
+		Uint32 *mpFrameBuf;				// attached framebuffer
+		int mWidth;								// virtual display width
+		int mHeight;							// virtual display height
+		string mDumpPrefix;				// frame dump file name prefix, empty - off
+		unsigned long mFrameNum;	// # of presented frames
+
+};
+
+} // namespace MKBasic
+
+#endif
@@ -0,0 +1,418 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			IntCtrl.cpp
+ *
+ * Purpose: 		Implementation of IntCtrl class.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#include "IntCtrl.h"
+
+namespace MKBasic {
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IntCtrl()
+ * Purpose:		Class constructor.
+ * Arguments:	psched - clock (CPU cycles) for latency measurement
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+IntCtrl::IntCtrl(EventSched *psched)
+{
+	mpEvtSched = psched;
+	mLines = 0;
+	mMask = 0xFF;
+	Reset();
+	ResetStats();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~IntCtrl()
+ * Purpose:		Class destructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+IntCtrl::~IntCtrl()
+{
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Reset()
+ * Purpose:		Drop triggered requests and pending NMI, enable all
+ *            sources. Lines of level triggered sources are left as
+ *            their devices drive them.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::Reset()
+{
+	mTriggered = 0;
+	mMask = 0xFF;
+	mNmiPending = false;
+	mNmiStats.waiting = false;
+	for (int i = 0; i < INTC_NUM_SRC; i++) {
+		if (!(mLines & (1 << i))) mStats[i].waiting = false;
+	}
+	Update();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetStats()
+ * Purpose:		Clear interrupt statistics.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::ResetStats()
+{
+	IntSrcStats empty = {0, 0, 0, 0, 0, 0, false};
+	for (int i = 0; i < INTC_NUM_SRC; i++) mStats[i] = empty;
+	mNmiStats = empty;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Update()
+ * Purpose:		Recompute state of CPU IRQ input.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::Update()
+{
+	mIrqAsserted = (0 != ((mLines | mTriggered) & mMask));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Request()
+ * Purpose:		Count new request of interrupt source and remember
+ *            when it came.
+ * Arguments:	pstats - statistics of the source
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::Request(IntSrcStats *pstats)
+{
+	pstats->count++;
+	if (!pstats->waiting) {
+		pstats->waiting = true;
+		pstats->req_cycle = mpEvtSched->GetCycles();
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Service()
+ * Purpose:		Record latency of request taken by CPU.
+ * Arguments:	pstats - statistics of the source
+ *            cycle - cycle when CPU started interrupt sequence
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::Service(IntSrcStats *pstats, unsigned long long cycle)
+{
+	if (!pstats->waiting) return;
+	unsigned long lat = (unsigned long)(cycle - pstats->req_cycle) + INTC_SEQ_CYCLES;
+	pstats->waiting = false;
+	pstats->lat_total += lat;
+	if (0 == pstats->serviced || lat < pstats->lat_min) pstats->lat_min = lat;
+	if (lat > pstats->lat_max) pstats->lat_max = lat;
+	pstats->serviced++;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetLine()
+ * Purpose:		Drive IRQ line of level triggered source.
+ * Arguments:	src - source (eIntSources)
+ *            asserted - true if device requests interrupt
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::SetLine(int src, bool asserted)
+{
+	unsigned char bit = 1 << src;
+	if (asserted) {
+		if (mLines & bit) return;
+		mLines |= bit;
+		Request(&mStats[src]);
+	} else {
+		if (!(mLines & bit)) return;
+		mLines &= ~bit;
+		// condition cleared by program before CPU took the interrupt
+		if (!(mTriggered & bit)) mStats[src].waiting = false;
+	}
+	Update();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Trigger()
+ * Purpose:		Request interrupt from triggered (pulse) source.
+ *            Request stays pending until cleared (see AcceptIrq()).
+ * Arguments:	src - source (eIntSources)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::Trigger(int src)
+{
+	mTriggered |= (1 << src);
+	Request(&mStats[src]);
+	Update();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Nmi()
+ * Purpose:		Non-maskable interrupt request (falling edge of NMI).
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::Nmi()
+{
+	mNmiPending = true;
+	Request(&mNmiStats);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AcceptIrq()
+ * Purpose:		CPU starts IRQ sequence. Requests of all pending
+ *            enabled sources are considered serviced. External
+ *            source request is cleared (nothing else acknowledges
+ *            it), other triggered sources wait for ClearTriggered().
+ * Arguments:	n/a
+ * Returns:		int - highest priority pending source
+ *--------------------------------------------------------------------
+ */
+int IntCtrl::AcceptIrq()
+{
+	int ret = GetActiveSrc();
+	unsigned char pend = (mLines | mTriggered) & mMask;
+	unsigned long long cycle = mpEvtSched->GetCycles();
+	for (int i = 0; i < INTC_NUM_SRC; i++) {
+		if (pend & (1 << i)) Service(&mStats[i], cycle);
+	}
+	mTriggered &= ~(mMask & (1 << INTSRC_EXT));
+	Update();
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AcceptNmi()
+ * Purpose:		CPU starts NMI sequence.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::AcceptNmi()
+{
+	mNmiPending = false;
+	Service(&mNmiStats, mpEvtSched->GetCycles());
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetPending()
+ * Purpose:		Return sources requesting interrupt (also masked).
+ * Arguments:	n/a
+ * Returns:		unsigned char - bit per source
+ *--------------------------------------------------------------------
+ */
+unsigned char IntCtrl::GetPending()
+{
+	return mLines | mTriggered;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetMask()
+ * Purpose:		Return enabled sources.
+ * Arguments:	n/a
+ * Returns:		unsigned char - bit per source, 1 - enabled
+ *--------------------------------------------------------------------
+ */
+unsigned char IntCtrl::GetMask()
+{
+	return mMask;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetMask()
+ * Purpose:		Enable / disable sources.
+ * Arguments:	mask - bit per source, 1 - enabled
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::SetMask(unsigned char mask)
+{
+	mMask = mask;
+	Update();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ClearTriggered()
+ * Purpose:		Drop pending requests of triggered sources.
+ * Arguments:	bits - bit per source, 1 - clear
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::ClearTriggered(unsigned char bits)
+{
+	for (int i = 0; i < INTC_NUM_SRC; i++) {
+		if ((bits & mTriggered & ~mLines) & (1 << i)) mStats[i].waiting = false;
+	}
+	mTriggered &= ~bits;
+	Update();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetActiveSrc()
+ * Purpose:		Return highest priority enabled source requesting
+ *            interrupt, so the handler doesn't have to poll devices.
+ * Arguments:	n/a
+ * Returns:		int - source (eIntSources) or INTC_SRC_NONE
+ *--------------------------------------------------------------------
+ */
+int IntCtrl::GetActiveSrc()
+{
+	unsigned char pend = (mLines | mTriggered) & mMask;
+	for (int i = 0; i < INTC_NUM_SRC; i++) {
+		if (pend & (1 << i)) return i;
+	}
+	return INTC_SRC_NONE;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetStats()
+ * Purpose:		Return statistics of IRQ source.
+ * Arguments:	src - source (eIntSources)
+ * Returns:		IntSrcStats - counts and latencies (cycles)
+ *--------------------------------------------------------------------
+ */
+IntSrcStats IntCtrl::GetStats(int src)
+{
+	return mStats[src];
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetNmiStats()
+ * Purpose:		Return statistics of NMI.
+ * Arguments:	n/a
+ * Returns:		IntSrcStats - counts and latencies (cycles)
+ *--------------------------------------------------------------------
+ */
+IntSrcStats IntCtrl::GetNmiStats()
+{
+	return mNmiStats;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetSrcName()
+ * Purpose:		Return name of IRQ source.
+ * Arguments:	src - source (eIntSources)
+ * Returns:		string - name
+ *--------------------------------------------------------------------
+ */
+string IntCtrl::GetSrcName(int src)
+{
+	string ret;
+	switch (src) {
+		case INTSRC_VIA:	ret = "VIA";	break;
+		case INTSRC_ACIA:	ret = "ACIA";	break;
+		case INTSRC_DISK:	ret = "DISK";	break;
+		case INTSRC_SOFT:	ret = "SOFT";	break;
+		case INTSRC_EXT:	ret = "EXT";	break;
+		default:					ret = "IRQ" + to_string(src);	break;
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SaveState()
+ * Purpose:		Get interrupt controller state for memory snapshot.
+ *            Format: version (INTC_STATE_VER), asserted lines,
+ *            triggered requests, mask, NMI pending.
+ * Arguments:	n/a
+ * Returns:		vector<unsigned char> - INTC_STATE_LEN bytes
+ *--------------------------------------------------------------------
+ */
+vector<unsigned char> IntCtrl::SaveState()
+{
+	vector<unsigned char> state;
+	state.push_back(INTC_STATE_VER);
+	state.push_back(mLines);
+	state.push_back(mTriggered);
+	state.push_back(mMask);
+	state.push_back(mNmiPending ? 1 : 0);
+	return state;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		RestoreState()
+ * Purpose:		Restore interrupt controller state saved by
+ *            SaveState(). Pending requests are counted as waiting
+ *            since the current cycle.
+ * Arguments:	state - INTC_STATE_LEN bytes, ignored if shorter or
+ *                    of unknown version
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void IntCtrl::RestoreState(vector<unsigned char> state)
+{
+	if (state.size() < INTC_STATE_LEN || INTC_STATE_VER != state[0]) return;
+	mLines = state[1];
+	mTriggered = state[2];
+	mMask = state[3];
+	mNmiPending = (0 != state[4]);
+	unsigned long long now = mpEvtSched->GetCycles();
+	for (int i = 0; i < INTC_NUM_SRC; i++) {
+		bool pend = (0 != ((mLines | mTriggered) & (1 << i)));
+		if (pend && !mStats[i].waiting) mStats[i].req_cycle = now;
+		mStats[i].waiting = pend;
+	}
+	if (mNmiPending && !mNmiStats.waiting) mNmiStats.req_cycle = now;
+	mNmiStats.waiting = mNmiPending;
+	Update();
+}
+
+} // namespace MKBasic
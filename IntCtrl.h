@@ -0,0 +1,124 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			IntCtrl.h
+ *
+ * Purpose: 		Prototype of IntCtrl class - interrupt controller
+ *							combining IRQ lines of interrupt sources, NMI
+ *							input and interrupt statistics (counts, latency).
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#ifndef INTCTRL_H
+#define INTCTRL_H
+
+#include <string>
+#include <vector>
+#include "EventSched.h"
+
+#define INTC_NUM_SRC		8		// # of IRQ sources (bits of pending/mask)
+#define INTC_SEQ_CYCLES	7		// cycles of CPU interrupt sequence
+#define INTC_SRC_NONE		0xFF	// no source pending
+#define INTC_STATE_VER		1		// version of saved state format
+#define INTC_STATE_LEN		5		// version, lines, triggered, mask, NMI
+
+using namespace std;
+
+namespace MKBasic {
+
+// IRQ sources, lower number - higher priority
+enum eIntSources {
+	INTSRC_VIA			= 0,	// VIA (6522) timers / ports device
+	INTSRC_ACIA			= 1,	// ACIA (6551) serial port device
+	INTSRC_DISK			= 2,	// disk controller, command completed
+	INTSRC_SOFT			= 6,	// software trigger (controller register)
+	INTSRC_EXT			= 7		// external: debug console, scheduled IRQ
+};
+
+// Statistics of interrupt source.
+struct IntSrcStats {
+	unsigned long				count;			// # of requests (line asserted)
+	unsigned long				serviced;		// # of requests taken by CPU
+	unsigned long long	lat_total;	// sum of latencies (cycles)
+	unsigned long				lat_min;		// shortest latency
+	unsigned long				lat_max;		// longest latency
+	unsigned long long	req_cycle;	// cycle of request waiting for CPU
+	bool								waiting;		// request not serviced yet
+};
+
+// Interrupt controller.
+// Level triggered sources keep their line asserted until device
+// condition is cleared, triggered sources stay pending until program
+// clears them (external source - until CPU takes the interrupt).
+// NMI is edge triggered.
+// Latency is counted from the request to the first instruction of
+// the handler.
+class IntCtrl {
+
+	public:
+
+		IntCtrl(EventSched *psched);
+		~IntCtrl();
+
+		void SetLine(int src, bool asserted);
+		void Trigger(int src);
+		void Nmi();
+		// checked by CPU before each instruction
+		bool IsPending() { return mIrqAsserted || mNmiPending; }
+		bool IsIrqAsserted() { return mIrqAsserted; }
+		bool IsNmiPending() { return mNmiPending; }
+		int AcceptIrq();
+		void AcceptNmi();
+		unsigned char GetPending();
+		unsigned char GetMask();
+		void SetMask(unsigned char mask);
+		void ClearTriggered(unsigned char bits);
+		int GetActiveSrc();
+		IntSrcStats GetStats(int src);
+		IntSrcStats GetNmiStats();
+		string GetSrcName(int src);
+		void ResetStats();
+		void Reset();
+		vector<unsigned char> SaveState();
+		void RestoreState(vector<unsigned char> state);
+
+	private:
+
+		EventSched	*mpEvtSched;		// clock
+		unsigned char mLines;				// level triggered sources asserted
+		unsigned char mTriggered;		// triggered sources pending
+		unsigned char mMask;				// enabled sources
+		bool mIrqAsserted;					// enabled source pending
+		bool mNmiPending;						// NMI edge not taken yet
+		IntSrcStats mStats[INTC_NUM_SRC];
+		IntSrcStats mNmiStats;
+
+		void Update();
+		void Request(IntSrcStats *pstats);
+		void Service(IntSrcStats *pstats, unsigned long long cycle);
+
+};
+
+} // namespace MKBasic
+
+#endif
@@ -34,6 +34,7 @@
  *--------------------------------------------------------------------
  */
 #include <string.h>
+#include <algorithm>
 #include "MKCpu.h"
 #include "MKGenException.h"
 
@@ -380,12 +381,19 @@ void MKCpu::InitCpu()
 	mReg.PtrAddr = 0;
 	mReg.PtrStack = 0xFF;	// top of stack	
 	mReg.SoftIrq = false;
-	mReg.IrqPending = false;
 	mReg.CyclesLeft = 1;
 	mReg.PageBoundary = false;
 	mLocalMem = false;
 	mExitAtLastRTS = true;
 	mEnableHistory = false;	// performance decrease when enabled
+	mEnableProfiler = false;
+	mpProfCount = NULL;			// counters allocated when profiler is enabled
+	mpProfCycles = NULL;
+	mEnableCallGraph = false;
+	mCallGrDepth = 0;
+	mpSymTab = NULL;
+	mEnableOpStats = false;
+	ResetOpStats();
 	if (NULL == mpMem) {
 		mpMem = new Memory();
 		if (NULL == mpMem) {
@@ -393,6 +401,8 @@ void MKCpu::InitCpu()
 		}
 		mLocalMem = true;
 	}	
+	mpEvtSched = mpMem->GetEventSched();
+	mpIntCtrl = mpMem->GetIntCtrl();
 	// Set default BRK vector ($FFFE -> $FFF0)
 	mpMem->Poke8bitImg(0xFFFE,0xF0); // LSB
 	mpMem->Poke8bitImg(0xFFFF,0xFF); // MSB
@@ -784,6 +794,8 @@ MKCpu::~MKCpu()
 		if (NULL != mpMem)
 			delete mpMem;
 	}
+	if (NULL != mpProfCount) delete [] mpProfCount;
+	if (NULL != mpProfCycles) delete [] mpProfCycles;
 }
 
 /*
@@ -884,6 +896,8 @@ unsigned short MKCpu::GetAddrWithMode(int mode)
  *--------------------------------------------------------------------
  * Method:		GetArgWithMode()
  * Purpose:		Get argument from address with specified mode.
+ *            Reads memory image only, devices and heat map are not
+ *            affected (used by disassembler).
  * Arguments:	addr - address in memory
  *            mode - code of the addressing mode, see eAddrModes.
  * Returns:		argument
@@ -896,15 +910,15 @@ unsigned short MKCpu::GetArgWithMode(unsigned short addr, int mode)
 	switch (mode) {
 		
 		case ADDRMODE_IMM:
-			arg16 = mpMem->Peek8bit(addr);
+			arg16 = mpMem->Peek8bitImg(addr);
 			break;
 			
 		case ADDRMODE_ABS:
-			arg16 = mpMem->Peek16bit(addr);
+			arg16 = mpMem->Peek16bitImg(addr);
 			break;
 			
 		case ADDRMODE_ZP:
-			arg16 = (unsigned short) mpMem->Peek8bit(addr);
+			arg16 = (unsigned short) mpMem->Peek8bitImg(addr);
 			break;
 			
 		case ADDRMODE_IMP:
@@ -912,35 +926,35 @@ unsigned short MKCpu::GetArgWithMode(unsigned short addr, int mode)
 			break;
 			
 		case ADDRMODE_IND:
-			arg16 = mpMem->Peek16bit(addr);
+			arg16 = mpMem->Peek16bitImg(addr);
 			break;
 			
 		case ADDRMODE_ABX:
-			arg16 = mpMem->Peek16bit(addr);
+			arg16 = mpMem->Peek16bitImg(addr);
 			break;
 			
 		case ADDRMODE_ABY:
-			arg16 = mpMem->Peek16bit(addr);
+			arg16 = mpMem->Peek16bitImg(addr);
 			break;
 			
 		case ADDRMODE_ZPX:
-			arg16 = mpMem->Peek8bit(addr);
+			arg16 = mpMem->Peek8bitImg(addr);
 			break;
 			
 		case ADDRMODE_ZPY:
-			arg16 = mpMem->Peek8bit(addr);
+			arg16 = mpMem->Peek8bitImg(addr);
 			break;
 			
 		case ADDRMODE_IZX:
-			arg16 = mpMem->Peek8bit(addr);
+			arg16 = mpMem->Peek8bitImg(addr);
 			break;
 			
 		case ADDRMODE_IZY:
-			arg16 = mpMem->Peek8bit(addr);
+			arg16 = mpMem->Peek8bitImg(addr);
 			break;
 			
 		case ADDRMODE_REL:
-			arg16 = ComputeRelJump(addr+1, mpMem->Peek8bit(addr));
+			arg16 = ComputeRelJump(addr+1, mpMem->Peek8bitImg(addr));
 			break;
 			
 		case ADDRMODE_ACC:
@@ -1018,13 +1032,22 @@ unsigned short MKCpu::Disassemble(unsigned short opcaddr, char *instrbuf)
   		strcpy(sBuf, "       ");
   		break;
 	}
+	unsigned short arg16 = GetArgWithMode(addr,addrmode);
 	strcpy(sFmt, "$%04x: $%02x %s   %s ");
 	strcat(sFmt, mArgFmtTbl[addrmode].c_str());
 	sprintf(sArg, sFmt, opcaddr, mpMem->Peek8bitImg(opcaddr), sBuf,
 								((mOpCodesMap[(eOpCodes)opcode]).amf.length() > 0 
 											? (mOpCodesMap[(eOpCodes)opcode]).amf.c_str() : "???"),
-								GetArgWithMode(addr,addrmode));
+								arg16);
 	for (unsigned int i=0; i<strlen(sArg); i++) sArg[i] = toupper(sArg[i]);
+	// name the address argument after the symbol, e.g.: JSR $0792 ;POUT
+	if (NULL != mpSymTab && ADDRMODE_IMM != addrmode && 2 <= mAddrModesLen[addrmode]) {
+		string sym = mpSymTab->AddrName(arg16);
+		if (sym.length() > 0) {
+			strcat(sArg, " ;");
+			strncat(sArg, sym.c_str(), DISS_BUF_SIZE - strlen(sArg) - 1);
+		}
+	}
 	strcpy(instrbuf, sArg);
 	
 	return opcaddr + mAddrModesLen[addrmode];
@@ -1042,7 +1065,7 @@ unsigned short MKCpu::Disassemble(unsigned short opcaddr, char *instrbuf)
  */
 bool MKCpu::PageBoundary(unsigned short startaddr, unsigned short endaddr)
 {
-	return (startaddr != (endaddr & 0xFF00));
+	return ((startaddr & 0xFF00) != (endaddr & 0xFF00));
 }
 
 /*
@@ -1066,8 +1089,7 @@ void MKCpu::OpCodeBrk()
 		// (where PC is the next address after BRK).
 		// That means the next opcode after BRK will not be executed upon return
 		// from interrupt, but the next after that will be.
-		// In case of hardware IRQ, just put current address on stack.
-		if (!mReg.IrqPending) mReg.PtrAddr++;
+		mReg.PtrAddr++;
 		// HI(PC+1) - HI part of next instr. addr. + 1
 		mpMem->Poke8bit(arg16, (unsigned char) (((mReg.PtrAddr) & 0xFF00) >> 8));
 		arg16 = 0x100;
@@ -1076,9 +1098,8 @@ void MKCpu::OpCodeBrk()
 		mpMem->Poke8bit(arg16, (unsigned char) ((mReg.PtrAddr) & 0x00FF));
 		arg16 = 0x100;
 		arg16 += mReg.PtrStack--;
-		// The BRK flag that goes on stack is set in case of BRK
-		//  or cleared in case of IRQ.
-		SetFlag(!mReg.IrqPending, FLAGS_BRK);
+		// The BRK flag that goes on stack is set in case of BRK.
+		SetFlag(true, FLAGS_BRK);
 		mpMem->Poke8bit(arg16, mReg.Flags);
 		// The BRK flag that remains in CPU status is unchanged, so unset after
 		// putting on stack.
@@ -1090,7 +1111,31 @@ void MKCpu::OpCodeBrk()
 	} else {
 		mReg.PtrAddr++;
 	}
-	if (mReg.IrqPending) mReg.IrqPending = false;	// let the next request come
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		InterruptSeq()
+ * Purpose:		Execute hardware interrupt sequence (IRQ or NMI):
+ *            push PC and flags (with BRK flag cleared) on stack,
+ *            mask IRQ and load PC from vector. Takes 7 cycles.
+ * Arguments:	vector - address of interrupt vector
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MKCpu::InterruptSeq(unsigned short vector)
+{
+	mpMem->Poke8bit(0x100 + mReg.PtrStack--,
+									(unsigned char) ((mReg.PtrAddr & 0xFF00) >> 8));
+	mpMem->Poke8bit(0x100 + mReg.PtrStack--,
+									(unsigned char) (mReg.PtrAddr & 0x00FF));
+	SetFlag(false, FLAGS_BRK);
+	mpMem->Poke8bit(0x100 + mReg.PtrStack--, mReg.Flags);
+	SetFlag(true, FLAGS_IRQ);
+	mReg.PtrAddr = mpMem->Peek16bit(vector);
+	mReg.SoftIrq = false;
+	mReg.LastRTS = false;
+	mReg.CyclesLeft = INTC_SEQ_CYCLES - 1;
 }
 
 /*
@@ -3856,6 +3901,9 @@ Regs *MKCpu::ExecOpcode(unsigned short memaddr)
 	mReg.LastAddr = memaddr;
 	unsigned char opcode = OPCODE_BRK;
 
+	// Advance clock, dispatch due device/interrupt events.
+	mpEvtSched->Tick();
+
 	// The op-code action was executed already once.
 	// Now skip if the clock cycles for this op-code are not yet completed.
 	if (mReg.CyclesLeft > 0) {
@@ -3863,13 +3911,26 @@ Regs *MKCpu::ExecOpcode(unsigned short memaddr)
 		return &mReg;
 	}
 
-	// If no IRQ waiting, get the next opcode and advance PC.
-	// Otherwise the opcode is OPCODE_BRK and with IrqPending
-	// flag set the IRQ sequence will be executed.
-	if (!mReg.IrqPending) {
-		opcode = mpMem->Peek8bit(mReg.PtrAddr++);
+	// Take interrupt instead of next instruction: NMI always,
+	// IRQ unless masked with I flag (then it stays pending).
+	if (mpIntCtrl->IsPending()) {
+		if (mpIntCtrl->IsNmiPending()) {
+			mpIntCtrl->AcceptNmi();
+			InterruptSeq(0xFFFA);
+			if (mEnableCallGraph) CallGraphPush(CALLGR_NMI);
+			return &mReg;
+		}
+		if (!CheckFlag(FLAGS_IRQ)) {
+			mpIntCtrl->AcceptIrq();
+			InterruptSeq(0xFFFE);
+			if (mEnableCallGraph) CallGraphPush(CALLGR_IRQ);
+			return &mReg;
+		}
 	}
 
+	opcode = mpMem->Fetch8bit(mReg.PtrAddr++);
+	unsigned char spbefore = mReg.PtrStack;
+
 	// load CPU instruction details from map
 	OpCode *instrdet = &mOpCodesMap[(eOpCodes)opcode];
 	
@@ -3892,7 +3953,29 @@ Regs *MKCpu::ExecOpcode(unsigned short memaddr)
 		mReg.CyclesLeft = instrdet->time - 1;
 		OpCodeHdlrFn pfun = instrdet->pfun;
 		if (NULL != pfun) (this->*pfun)();
+		// cycles over the base time: branch taken, page crossed
+		int extra = mReg.CyclesLeft - (instrdet->time - 1);
+		// bus cycles taken by DMA transfer started by this opcode
+		mReg.CyclesLeft += mpMem->TakeStallCycles();
+		if (mEnableOpStats) {
+			mOpStats.count[opcode]++;
+			mOpStats.cycles[opcode] += mReg.CyclesLeft + 1;
+			if (extra > 0) {
+				if (ADDRMODE_REL == instrdet->addrmode) {
+					mOpStats.taken[opcode]++;
+					extra--;
+				}
+				mOpStats.pagecross[opcode] += extra;
+			}
+		}
+	}
+
+	// Count instruction and all its cycles at its address.
+	if (mEnableProfiler) {
+		mpProfCount[mReg.LastAddr]++;
+		mpProfCycles[mReg.LastAddr] += mReg.CyclesLeft + 1;
 	}
+	if (mEnableCallGraph) CallGraphUpdate(opcode, spbefore);
 				
 	// Update history/log of recently executed op-codes/instructions.
 	if (mEnableHistory) {
@@ -3967,7 +4050,13 @@ queue<string>	MKCpu::GetExecHistory()
 						"$%04x: %-16s \t$%02x | $%02x | $%02x | $%02x | $%02x",
 						item.LastAddr, item.LastInstr.c_str(), item.Acc, item.IndX,
 						item.IndY, item.Flags, item.PtrStack);		
-		ret.push(histentry);
+		string entry = histentry;
+		// label of instruction address at the end, columns stay in place
+		if (NULL != mpSymTab) {
+			string sym = mpSymTab->AddrName(item.LastAddr);
+			if (sym.length() > 0) entry += " | " + sym;
+		}
+		ret.push(entry);
 		exechist.pop();
 	}
 
@@ -4000,6 +4089,380 @@ bool	MKCpu::IsExecHistoryEnabled()
 	return mEnableHistory;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableProfiler()
+ * Purpose:		Enable/disable execution profiler. Counters of all
+ *            addresses are allocated once, when profiler is enabled
+ *            the first time, and kept when it is disabled.
+ * Arguments:	enprof - true = enable / false = disable
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void	MKCpu::EnableProfiler(bool enprof)
+{
+	if (enprof && NULL == mpProfCount) {
+		mpProfCount = new unsigned long long[PROF_NUM_ADDR];
+		mpProfCycles = new unsigned long long[PROF_NUM_ADDR];
+		if (NULL == mpProfCount || NULL == mpProfCycles) {
+			throw MKGenException("Unable to allocate memory!");
+		}
+		ResetProfiler();
+	}
+	mEnableProfiler = enprof;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsProfilerEnabled()
+ * Purpose:		Check if execution profiler is enabled.
+ * Arguments:	n/a
+ * Returns:		bool - true = enabled / false = disabled
+ *--------------------------------------------------------------------
+ */
+bool	MKCpu::IsProfilerEnabled()
+{
+	return mEnableProfiler;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetProfiler()
+ * Purpose:		Zero execution profiler counters.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void	MKCpu::ResetProfiler()
+{
+	if (NULL == mpProfCount) return;
+	memset(mpProfCount, 0, PROF_NUM_ADDR * sizeof(unsigned long long));
+	memset(mpProfCycles, 0, PROF_NUM_ADDR * sizeof(unsigned long long));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetProfile()
+ * Purpose:		Create execution profile report: totals and addresses
+ *            which took the most cycles (hot-spots), disassembled
+ *            with the current memory contents.
+ * Arguments:	maxn - maximum # of hot-spots in report
+ * Returns:		ProfReport - report
+ *--------------------------------------------------------------------
+ */
+ProfReport MKCpu::GetProfile(int maxn)
+{
+	ProfReport ret;
+	vector<unsigned short> addrs;
+
+	ret.count = ret.cycles = 0;
+	ret.addrs = 0;
+	if (NULL == mpProfCount) return ret;
+	for (int addr = 0; addr < PROF_NUM_ADDR; addr++) {
+		if (0 == mpProfCount[addr]) continue;
+		ret.count += mpProfCount[addr];
+		ret.cycles += mpProfCycles[addr];
+		addrs.push_back((unsigned short) addr);
+	}
+	ret.addrs = (int) addrs.size();
+	if (maxn > ret.addrs) maxn = ret.addrs;
+	if (maxn <= 0) return ret;
+	unsigned long long *pcycles = mpProfCycles;
+	partial_sort(addrs.begin(), addrs.begin() + maxn, addrs.end(),
+		[pcycles](unsigned short a, unsigned short b) {
+			return (pcycles[a] > pcycles[b] || (pcycles[a] == pcycles[b] && a < b));
+		});
+	for (int i = 0; i < maxn; i++) {
+		ProfEntry entry;
+		char instrbuf[DISS_BUF_SIZE] = {0};
+		entry.addr = addrs[i];
+		entry.count = mpProfCount[entry.addr];
+		entry.cycles = mpProfCycles[entry.addr];
+		Disassemble(entry.addr, instrbuf);
+		entry.instr = instrbuf;
+		if (NULL != mpSymTab) entry.sym = mpSymTab->AddrName(entry.addr);
+		ret.hot.push_back(entry);
+	}
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableCallGraph()
+ * Purpose:		Enable/disable call graph profiler. Call paths are
+ *            kept when it is disabled.
+ * Arguments:	encallgr - true = enable / false = disable
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void	MKCpu::EnableCallGraph(bool encallgr)
+{
+	if (encallgr && mCallGrNodes.empty()) ResetCallGraph();
+	mEnableCallGraph = encallgr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsCallGraphEnabled()
+ * Purpose:		Check if call graph profiler is enabled.
+ * Arguments:	n/a
+ * Returns:		bool - true = enabled / false = disabled
+ *--------------------------------------------------------------------
+ */
+bool	MKCpu::IsCallGraphEnabled()
+{
+	return mEnableCallGraph;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetCallGraph()
+ * Purpose:		Drop all call paths and empty shadow call stack,
+ *            code executed from now on is accounted to the root
+ *            until the first call.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void	MKCpu::ResetCallGraph()
+{
+	CallGrNode root;
+	root.parent = -1;
+	root.addr = 0;
+	root.kind = CALLGR_ROOT;
+	root.cycles = 0;
+	mCallGrNodes.clear();
+	mCallGrNodes.push_back(root);
+	mCallGrStack[0].node = 0;
+	mCallGrStack[0].sp = 0xFF;
+	mCallGrDepth = 1;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		CallGraphPush()
+ * Purpose:		Enter routine at current PC, called after return
+ *            address was pushed on stack (JSR, BRK, interrupt).
+ *            Call path is the path of current frame extended with
+ *            the routine. When the shadow stack or the number of
+ *            call paths is exhausted, the routine is accounted to
+ *            its caller.
+ * Arguments:	kind - kind of frame, see eCallGrFrames
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MKCpu::CallGraphPush(int kind)
+{
+	if (mCallGrDepth >= CALLGR_MAX_DEPTH) return;
+	int curr = mCallGrStack[mCallGrDepth-1].node;
+	int key = (kind << 16) | mReg.PtrAddr;
+	map<int,int>::iterator it = mCallGrNodes[curr].children.find(key);
+	int node = curr;
+	if (it != mCallGrNodes[curr].children.end()) {
+		node = it->second;
+	} else if (mCallGrNodes.size() < CALLGR_MAX_NODES) {
+		CallGrNode callee;
+		callee.parent = curr;
+		callee.addr = mReg.PtrAddr;
+		callee.kind = kind;
+		callee.cycles = 0;
+		node = (int) mCallGrNodes.size();
+		mCallGrNodes[curr].children[key] = node;
+		mCallGrNodes.push_back(callee);
+	}
+	mCallGrStack[mCallGrDepth].node = node;
+	mCallGrStack[mCallGrDepth].sp = mReg.PtrStack;
+	mCallGrDepth++;
+	// interrupt sequence cycles belong to the handler
+	if (CALLGR_SUB != kind) mCallGrNodes[node].cycles += mReg.CyclesLeft + 1;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		CallGraphUpdate()
+ * Purpose:		Account cycles of executed instruction to the current
+ *            call path, then follow calls and returns.
+ *            Frames are not popped by RTS / RTI alone, but when
+ *            the stack pointer moves above the return address of
+ *            the frame, so the shadow stack stays in line with the
+ *            CPU stack when code discards return address (PLA,
+ *            TXS), returns to the caller of caller or uses RTS
+ *            to jump to pushed address.
+ * Arguments:	opcode - executed op-code
+ *            spbefore - stack pointer before execution
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MKCpu::CallGraphUpdate(unsigned char opcode, unsigned char spbefore)
+{
+	int curr = mCallGrStack[mCallGrDepth-1].node;
+	mCallGrNodes[curr].cycles += mReg.CyclesLeft + 1;
+	if (OPCODE_JSR_ABS == opcode) {
+		CallGraphPush(CALLGR_SUB);
+	} else if (OPCODE_BRK == opcode && 3 == (unsigned char)(spbefore - mReg.PtrStack)) {
+		// BRK taken (IRQ not masked), handler entered
+		CallGraphPush(CALLGR_IRQ);
+	} else {
+		while (mCallGrDepth > 1 && mCallGrStack[mCallGrDepth-1].sp < mReg.PtrStack) {
+			mCallGrDepth--;
+		}
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetCallGraph()
+ * Purpose:		Create call graph report in folded stacks format:
+ *            one line per call path with routines separated by ';'
+ *            and # of cycles spent in the last routine, e.g.:
+ *              ROOT;$0400;$C2A5 1234
+ *            Routines are named by symbol (label+offset) or entry
+ *            address, interrupt handlers are prefixed with IRQ: /
+ *            NMI:. Lines can be fed to
+ *            flame graph tools as they are.
+ * Arguments:	n/a
+ * Returns:		vector<string> - call paths with cycles
+ *--------------------------------------------------------------------
+ */
+vector<string> MKCpu::GetCallGraph()
+{
+	vector<string> ret, paths;
+	char name[16];
+
+	// caller node is always created before its callees
+	for (unsigned int i = 0; i < mCallGrNodes.size(); i++) {
+		CallGrNode *pnode = &mCallGrNodes[i];
+		string sym = (NULL == mpSymTab) ? "" : mpSymTab->AddrName(pnode->addr);
+		if (sym.empty()) {
+			sprintf(name, "$%04X", pnode->addr);
+			sym = name;
+		}
+		switch (pnode->kind) {
+			case CALLGR_ROOT:	sym = "ROOT"; break;
+			case CALLGR_IRQ:	sym = "IRQ:" + sym; break;
+			case CALLGR_NMI:	sym = "NMI:" + sym; break;
+			default:					break;
+		}
+		paths.push_back((pnode->parent < 0) ? sym : paths[pnode->parent] + ";" + sym);
+		if (0 == pnode->cycles) continue;
+		ret.push_back(paths[i] + " " + to_string(pnode->cycles));
+	}
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetSymTab()
+ * Purpose:		Set table of program symbols used to name addresses
+ *            in disassembly, execute history and profiler reports.
+ * Arguments:	psymtab - pointer to symbol table, NULL - no symbols
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MKCpu::SetSymTab(SymTab *psymtab)
+{
+	mpSymTab = psymtab;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableOpStats()
+ * Purpose:		Enable/disable instruction mix counters (executions,
+ *            cycles, taken branches and page crossing penalties per
+ *            op-code). Counters are kept when disabled.
+ * Arguments:	enopstats - true = enable / false = disable
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void	MKCpu::EnableOpStats(bool enopstats)
+{
+	mEnableOpStats = enopstats;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsOpStatsEnabled()
+ * Purpose:		Check if instruction mix counters are enabled.
+ * Arguments:	n/a
+ * Returns:		bool - true = enabled / false = disabled
+ *--------------------------------------------------------------------
+ */
+bool	MKCpu::IsOpStatsEnabled()
+{
+	return mEnableOpStats;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetOpStats()
+ * Purpose:		Zero instruction mix counters.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void	MKCpu::ResetOpStats()
+{
+	memset(&mOpStats, 0, sizeof(mOpStats));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetOpStats()
+ * Purpose:		Get instruction mix counters.
+ * Arguments:	n/a
+ * Returns:		OpStats - copy of counters
+ *--------------------------------------------------------------------
+ */
+OpStats MKCpu::GetOpStats()
+{
+	return mOpStats;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetMnemonic()
+ * Purpose:		Get assembler mnemonic of op-code.
+ * Arguments:	opcode - op-code
+ * Returns:		string - mnemonic, ILL for illegal op-code
+ *--------------------------------------------------------------------
+ */
+string MKCpu::GetMnemonic(unsigned char opcode)
+{
+	return mOpCodesMap[(eOpCodes)opcode].amf;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetAddrMode()
+ * Purpose:		Get addressing mode of op-code.
+ * Arguments:	opcode - op-code
+ * Returns:		int - addressing mode (eAddrModes)
+ *--------------------------------------------------------------------
+ */
+int MKCpu::GetAddrMode(unsigned char opcode)
+{
+	return mOpCodesMap[(eOpCodes)opcode].addrmode;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetAddrModeName()
+ * Purpose:		Get short name of addressing mode.
+ * Arguments:	mode - addressing mode (eAddrModes)
+ * Returns:		string - name, e.g.: IMM, ABX, IZY
+ *--------------------------------------------------------------------
+ */
+string MKCpu::GetAddrModeName(int mode)
+{
+	static const char *names[] = {"IMM", "ABS", "ZP", "IMP", "IND", "ABX",
+																"ABY", "ZPX", "ZPY", "IZX", "IZY", "REL",
+																"ACC", "UND"};
+	if (mode < 0 || mode >= ADDRMODE_LENGTH) return "UND";
+	return names[mode];
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		Reset()
@@ -4059,7 +4522,61 @@ void MKCpu::SetRegs(Regs r)
  */
 void MKCpu::Interrupt()
 {
-	mReg.IrqPending = true;
+	mpIntCtrl->Trigger(INTSRC_EXT);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		NMInterrupt()
+ * Purpose:		Non-Maskable Interrupt.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MKCpu::NMInterrupt()
+{
+	mpIntCtrl->Nmi();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ScheduleInterrupt()
+ * Purpose:		Interrupt ReQuest after given # of CPU cycles.
+ * Arguments:	cycles - # of cycles from now
+ * Returns:		unsigned long - event handle (see EventSched::Cancel())
+ *--------------------------------------------------------------------
+ */
+unsigned long MKCpu::ScheduleInterrupt(unsigned long cycles)
+{
+	return mpEvtSched->Schedule(cycles, this, CPUEVT_IRQ);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetCycles()
+ * Purpose:		Get # of CPU cycles elapsed.
+ * Arguments:	n/a
+ * Returns:		unsigned long long - # of cycles
+ *--------------------------------------------------------------------
+ */
+unsigned long long MKCpu::GetCycles()
+{
+	return mpEvtSched->GetCycles();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		HandleEvent()
+ * Purpose:		Execute scheduled CPU event.
+ * Arguments:	evtid - event code (eCpuEvents)
+ *            cycle - current cycle
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MKCpu::HandleEvent(int evtid, unsigned long long cycle)
+{
+	if (CPUEVT_IRQ == evtid) Interrupt();
+	else if (CPUEVT_NMI == evtid) NMInterrupt();
 }
 
 } // namespace MKBasic
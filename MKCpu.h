@@ -36,15 +36,20 @@
 #include <string>
 #include <map>
 #include <queue>
+#include <vector>
 #include "system.h"
 #include "Memory.h"
+#include "SymTab.h"
 
 using namespace std;
 
 namespace MKBasic {
 	
-#define DISS_BUF_SIZE 60	// disassembled instruction buffer size	
+#define DISS_BUF_SIZE 100	// disassembled instruction buffer size	
 #define OPCO_HIS_SIZE 20	// size of op-code execute history queue	
+#define PROF_NUM_ADDR	0x10000	// # of addresses counted by profiler
+#define CALLGR_MAX_DEPTH	256		// maximum depth of call graph shadow stack
+#define CALLGR_MAX_NODES	65536	// maximum # of distinct call paths
 
 struct Regs {
 	unsigned char 	Acc;					// 8-bit accumulator
@@ -62,11 +67,53 @@ struct Regs {
 	int							LastOpCode;		// op-code of last instruction
 	unsigned short	LastArg;			// argument to the last instruction
 	int							LastAddrMode;	// addressing mode of last instruction
-	bool						IrqPending;		// pending Interrupt ReQuest (IRQ)
 	int  						CyclesLeft;		// # of cycles left to complete current opcode
 	bool						PageBoundary;	// true if page boundary was crossed
 };
 
+// Execution profiler counters of single address (hot-spot).
+struct ProfEntry {
+	unsigned short			addr;			// address of instruction
+	unsigned long long	count;		// # of times executed
+	unsigned long long	cycles;		// # of cycles taken (incl. DMA stalls)
+	string							instr;		// disassembled instruction
+	string							sym;			// label+offset of address (if symbols loaded)
+};
+
+// Dynamic instruction mix counters, indexed by op-code.
+// Counts per addressing mode are sums over op-codes of the mode.
+struct OpStats {
+	unsigned long long	count[256];			// # of executions
+	unsigned long long	cycles[256];		// # of cycles (incl. DMA stalls)
+	unsigned long long	taken[256];			// # of taken branches (REL op-codes)
+	unsigned long long	pagecross[256];	// page crossing penalty cycles
+};
+
+// Kinds of call graph frames.
+enum eCallGrFrames {
+	CALLGR_ROOT = 0,	// code executed outside of any call
+	CALLGR_SUB,				// subroutine (JSR)
+	CALLGR_IRQ,				// IRQ or BRK handler
+	CALLGR_NMI				// NMI handler
+};
+
+// Call graph node - unique call path.
+struct CallGrNode {
+	int									parent;		// index of caller node, -1 for root
+	unsigned short			addr;			// entry address of routine
+	int									kind;			// see eCallGrFrames
+	unsigned long long	cycles;		// # of cycles spent in routine itself
+	map<int,int>				children;	// (kind << 16 | addr) -> node index
+};
+
+// Execution profiler report.
+struct ProfReport {
+	unsigned long long	count;		// total # of executed instructions
+	unsigned long long	cycles;		// total # of cycles
+	int									addrs;		// # of distinct addresses executed
+	vector<ProfEntry>		hot;			// hot-spots, most cycles first
+};
+
 /*
  * Virtual CPU, 6502 addressing modes:
  
@@ -446,7 +493,13 @@ enum eLogicOps {
 	LOGOP_EOR
 };
 
-class MKCpu
+// events scheduled by CPU
+enum eCpuEvents {
+	CPUEVT_IRQ = 0,		// Interrupt ReQuest
+	CPUEVT_NMI				// Non-Maskable Interrupt
+};
+
+class MKCpu : public EventHandler
 {
 	public:
 
@@ -462,10 +515,30 @@ class MKCpu
 		queue<string>	GetExecHistory();
 		void	EnableExecHistory(bool enexehist);
 		bool	IsExecHistoryEnabled();
+		void	EnableProfiler(bool enprof);
+		bool	IsProfilerEnabled();
+		void	ResetProfiler();
+		ProfReport GetProfile(int maxn);										// hot-spots report, maxn most expensive addresses
+		void	EnableCallGraph(bool encallgr);
+		bool	IsCallGraphEnabled();
+		void	ResetCallGraph();
+		vector<string> GetCallGraph();											// call paths and cycles in folded stacks format
+		void	SetSymTab(SymTab *psymtab);										// symbols for disassembly and reports
+		void	EnableOpStats(bool enopstats);
+		bool	IsOpStatsEnabled();
+		void	ResetOpStats();
+		OpStats GetOpStats();																// instruction mix counters
+		string GetMnemonic(unsigned char opcode);						// assembler mnemonic of op-code
+		int		GetAddrMode(unsigned char opcode);						// addressing mode of op-code (eAddrModes)
+		string GetAddrModeName(int mode);										// short name of addressing mode, e.g.: ABX
 		unsigned short Disassemble(unsigned short addr,
 															 char *instrbuf);					// Disassemble instruction in memory, return next instruction addr.
 		void Reset();																				// reset CPU		
 		void Interrupt();																		// Interrupt ReQuest (IRQ)
+		void NMInterrupt();																	// Non-Maskable Interrupt (NMI)
+		unsigned long ScheduleInterrupt(unsigned long cycles);	// IRQ after # of cycles
+		unsigned long long GetCycles();											// # of cycles elapsed
+		void HandleEvent(int evtid, unsigned long long cycle);
 		
 	protected:
 		
@@ -487,12 +560,29 @@ class MKCpu
 		
 		struct Regs mReg;						// CPU registers
 		Memory 			*mpMem;					// pointer to memory object
+		EventSched	*mpEvtSched;		// clock and scheduled events
+		IntCtrl			*mpIntCtrl;			// interrupt requests
 		bool 				mLocalMem;			// true - memory locally allocated
 		OpCodesMap	mOpCodesMap;		// hash table of all opcodes
 		int					mAddrModesLen[ADDRMODE_LENGTH];	// array of instructions lengths per addressing mode
 		string			mArgFmtTbl[ADDRMODE_LENGTH];		// array of instructions assembly formats per addressing mode
 		queue<OpCodeHistItem> mExecHistory;					// keep the op-codes execute history
 		bool				mEnableHistory;	// enable/disable execute history
+		bool				mEnableProfiler;	// enable/disable execution profiler
+		unsigned long long *mpProfCount;	// # of executions per address (PROF_NUM_ADDR)
+		unsigned long long *mpProfCycles;	// # of cycles per address (PROF_NUM_ADDR)
+		// call graph shadow stack entry
+		struct CallGrFrame {
+			int						node;		// call graph node
+			unsigned char	sp;			// stack pointer after return address was pushed
+		};
+		bool				mEnableCallGraph;	// enable/disable call graph profiler
+		vector<CallGrNode> mCallGrNodes;	// call paths
+		CallGrFrame	mCallGrStack[CALLGR_MAX_DEPTH];	// shadow call stack
+		int					mCallGrDepth;		// # of frames in shadow call stack
+		SymTab			*mpSymTab;			// program symbols, just a pointer
+		bool				mEnableOpStats;	// enable/disable instruction mix counters
+		OpStats			mOpStats;				// instruction mix counters
 		
 		
 		void	InitCpu();
@@ -521,6 +611,10 @@ class MKCpu
 		void Add2History(OpCodeHistItem histitem);					// add entry to op-codes execute history
 		bool PageBoundary(unsigned short startaddr,
 											unsigned short endaddr);					// detect if page boundary was crossed
+		void InterruptSeq(unsigned short vector);						// push PC and flags, jump via vector
+		void CallGraphPush(int kind);												// enter routine at PC in call graph
+		void CallGraphUpdate(unsigned char opcode,
+												 unsigned char spbefore);				// account executed instruction in call graph
 
 		// opcode execute methods
 		void OpCodeBrk();
@@ -32,14 +32,213 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "MassStorage.h"
 #include "MKGenException.h"
 #include "system.h"
 
+#if defined(WINDOWS)
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// journal checksum (32-bit FNV-1a)
+#define MASSSTOR_FNVBASIS   2166136261UL
+#define MASSSTOR_FNVPRIME   16777619UL
+
 namespace MKBasic {
 
 constexpr int MassStorage::sect_per_track[];
 
+/*
+ *--------------------------------------------------------------------
+ * Method:    PutJrnlBytes()
+ * Purpose:   Write bytes to journal file and add them to checksum.
+ * Arguments: fp - journal file
+ *            buf, len - data
+ *            psum - pointer to checksum, NULL if not summed
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+static void PutJrnlBytes(FILE *fp, const unsigned char *buf, size_t len,
+                         unsigned long *psum)
+{
+  fwrite(buf, 1, len, fp);
+  if (NULL == psum) return;
+  for (size_t i=0; i < len; i++) {
+    *psum = ((*psum ^ buf[i]) * MASSSTOR_FNVPRIME) & 0xFFFFFFFFUL;
+  }
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    PutJrnlU32()
+ * Purpose:   Write 32-bit value (little endian) to journal file.
+ * Arguments: fp - journal file
+ *            val - value
+ *            psum - pointer to checksum, NULL if not summed
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+static void PutJrnlU32(FILE *fp, unsigned long val, unsigned long *psum)
+{
+  unsigned char buf[4];
+  for (int i=0; i < 4; i++) buf[i] = (unsigned char) ((val >> (8*i)) & 0xFF);
+  PutJrnlBytes(fp, buf, 4, psum);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    GetJrnlBytes()
+ * Purpose:   Read bytes from journal file and add them to checksum.
+ * Arguments: fp - journal file
+ *            buf, len - data
+ *            psum - pointer to checksum, NULL if not summed
+ * Returns:   bool - false if file is too short
+ *--------------------------------------------------------------------
+ */
+static bool GetJrnlBytes(FILE *fp, unsigned char *buf, size_t len,
+                         unsigned long *psum)
+{
+  if (fread(buf, 1, len, fp) != len) return false;
+  if (NULL == psum) return true;
+  for (size_t i=0; i < len; i++) {
+    *psum = ((*psum ^ buf[i]) * MASSSTOR_FNVPRIME) & 0xFFFFFFFFUL;
+  }
+  return true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    GetJrnlU32()
+ * Purpose:   Read 32-bit value (little endian) from journal file.
+ * Arguments: fp - journal file
+ *            pval - pointer to value
+ *            psum - pointer to checksum, NULL if not summed
+ * Returns:   bool - false if file is too short
+ *--------------------------------------------------------------------
+ */
+static bool GetJrnlU32(FILE *fp, unsigned long *pval, unsigned long *psum)
+{
+  unsigned char buf[4];
+  if (!GetJrnlBytes(fp, buf, 4, psum)) return false;
+  *pval = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((unsigned long) buf[3] << 24);
+  return true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    SyncFile()
+ * Purpose:   Flush file buffers and wait until data are on disk.
+ * Arguments: fp - file
+ * Returns:   int - 0 if OK, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+static int SyncFile(FILE *fp)
+{
+  if (0 != fflush(fp)) return -1;
+#if defined(WINDOWS)
+  return (0 == _commit(_fileno(fp))) ? 0 : -1;
+#else
+  return (0 == fsync(fileno(fp))) ? 0 : -1;
+#endif
+}
+
+// run of data to write to disk image file
+struct ImageRun {
+  unsigned long         offs;   // offset in file
+  const unsigned char  *buf;    // data
+  size_t                len;
+};
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    WriteImageRuns()
+ * Purpose:   Write runs of data to disk image file and wait until
+ *            they are on disk. File is opened once and synced once
+ *            for all runs.
+ * Arguments: fname - image file name
+ *            runs - data and their offsets
+ * Returns:   int - 0 if OK, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+static int WriteImageRuns(string fname, const vector<ImageRun> &runs)
+{
+  int ret = 0;
+
+#if defined(WINDOWS)
+  FILE *fp = fopen(fname.c_str(), "r+b");
+  if (NULL == fp) {
+    return -1;
+  }
+  for (size_t i=0; 0 == ret && i < runs.size(); i++) {
+    if (0 != fseek(fp, (long) runs[i].offs, SEEK_SET)
+        || fwrite(runs[i].buf, 1, runs[i].len, fp) != runs[i].len) {
+      ret = -1;
+    }
+  }
+  if (0 == ret && 0 != SyncFile(fp)) {
+    ret = -1;
+  }
+  fclose(fp);
+#else
+  int fd = open(fname.c_str(), O_RDWR);
+  if (0 > fd) {
+    return -1;
+  }
+  for (size_t i=0; 0 == ret && i < runs.size(); i++) {
+    size_t done = 0;
+    while (done < runs[i].len) {
+      ssize_t n = pwrite(fd, runs[i].buf + done, runs[i].len - done,
+                         (off_t) (runs[i].offs + done));
+      if (0 >= n) {
+        ret = -1;
+        break;
+      }
+      done += n;
+    }
+  }
+  if (0 == ret && 0 != fsync(fd)) {
+    ret = -1;
+  }
+  close(fd);
+#endif
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    SyncDir()
+ * Purpose:   Wait until directory entries of the directory containing
+ *            file (created or removed files) are on disk.
+ *            Nothing to do on Windows (directory cannot be synced).
+ * Arguments: fname - file name
+ * Returns:   int - 0 if OK, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+static int SyncDir(string fname)
+{
+#if defined(WINDOWS)
+  return 0;
+#else
+  size_t pos = fname.find_last_of('/');
+  string dname = (string::npos == pos) ? "." : fname.substr(0, pos ? pos : 1);
+  int fd = open(dname.c_str(), O_RDONLY);
+  if (0 > fd) {
+    return -1;
+  }
+  int ret = (0 == fsync(fd)) ? 0 : -1;
+  close(fd);
+  return ret;
+#endif
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:    MassStorage() 
@@ -56,55 +255,100 @@ MassStorage::MassStorage()
  /*
   *--------------------------------------------------------------------
   * Method:     ~MassStorage()
-  * Purpose:    Class destructor.
+  * Purpose:    Class destructor. Flush and unmap opened disk images,
+  *             wait until background writer writes all queued data.
   * Arguments: 
   * Returns:   
   *--------------------------------------------------------------------
   */
 MassStorage::~MassStorage()
 {
-
+  for (int i=0; i < num_of_images; i++) {
+    Close(i);
+  }
+  {
+    lock_guard<mutex> lock(mFlushMutex);
+    mWriterStop = true;
+    mFlushCond.notify_all();
+  }
+  if (mWriterThread.joinable()) mWriterThread.join();
 }
 
  /*
   *--------------------------------------------------------------------
   * Method:     Initialize()
   * Purpose:    Initialize internal variables.
+  *             Disk image files are not touched here, each image is
+  *             opened (created and formatted if needed) and mapped
+  *             to memory when it is accessed first time.
   * Arguments: 
   * Returns:   
   *--------------------------------------------------------------------
   */
 void MassStorage::Initialize()
 {
-  // TO DO: add code to initialize class
-
   // initialize standard disk images
-  DiskTrack dtrk;
-  DiskImage ditbl[] = {
-    {0, "DISK0", {dtrk}},
-    {1, "DISK1", {dtrk}},
-    {2, "DISK2", {dtrk}},
-    {3, "DISK3", {dtrk}},
-    {4, "DISK4", {dtrk}},
-    {5, "DISK5", {dtrk}},
-    {6, "DISK6", {dtrk}},
-    {7, "DISK7", {dtrk}},
-    {8, "DISK8", {dtrk}},
-    {9, "DISK9", {dtrk}}
-  };
   for (int i=0; i < num_of_images; i++) {
-    mDiskImages[i].id = ditbl[i].id;
-    mDiskImages[i].name = ditbl[i].name;
-    string fname = mDiskImages[i].name + "_" + to_string(mDiskImages[i].id) + ".disk";
-    FILE *fp = fopen(fname.c_str(), "r");
-    if (NULL == fp) {
-      Format(mDiskImages[i].id, mDiskImages[i].name);
-      Flush(mDiskImages[i].id);
-    } else {
-      LoadFromFile(mDiskImages[i].id, mDiskImages[i].name);
-      fclose(fp);
-    }
+    mDiskImages[i].id = i;
+    mDiskImages[i].name = "DISK" + to_string(i);
+    mDiskImages[i].data = NULL;
+    mDiskImages[i].size = 0;
+    mDiskImages[i].dirty = 0;
+    mDiskImages[i].lastuse = 0;
+    mPending[i] = 0;
   }
+  mUseCount = 0;
+  mWriterStop = false;
+  mWriteErr = false;
+  memset(&mFlushStats, 0, sizeof(mFlushStats));
+  // image file is a sequence of sectors, track after track
+  int offs = 0;
+  for (int track=0; track < max_numof_tracks; track++) {
+    mTrackOffs[track] = offs;
+    offs += sect_per_track[track];
+  }
+  mTrackOffs[max_numof_tracks] = offs;
+  memset(mSectorBuf, 0, sector_size);
+}
+
+ /*
+  *--------------------------------------------------------------------
+  * Method:     ImageFileName()
+  * Purpose:    Get the name of disk image file.
+  * Arguments:  id - the disk image id
+  * Returns:    string - file name
+  *--------------------------------------------------------------------
+  */
+string MassStorage::ImageFileName(int id)
+{
+  return mDiskImages[id].name + "_" + to_string(mDiskImages[id].id) + ".disk";
+}
+
+ /*
+  *--------------------------------------------------------------------
+  * Method:     SectorOffset()
+  * Purpose:    Calculate the offset of sector data in disk image,
+  *             open the image if it is not open yet.
+  * Arguments:  id - the disk image id
+  *             track - track# (1..max_numof_tracks)
+  *             sector - sector# (0..sectors per track - 1)
+  * Returns:    int - offset in bytes, less than 0 if error
+  *--------------------------------------------------------------------
+  */
+int MassStorage::SectorOffset(int id, int track, int sector)
+{
+  if (id < 0 || id >= num_of_images
+      || track < 1 || track > max_numof_tracks
+      || sector < 0 || sector >= sect_per_track[track-1]) {
+    return -1;
+  }
+  if (NULL == mDiskImages[id].data
+      && 0 > LoadFromFile(id, mDiskImages[id].name)) {
+    return -1;
+  }
+  mDiskImages[id].lastuse = ++mUseCount;
+
+  return (mTrackOffs[track-1] + sector) * sector_size;
 }
 
  /*
@@ -120,28 +364,47 @@ int MassStorage::Format (int id, string name)
 {
   int ret = 0;
 
-  // TO DO: add code to format disk image
-  DiskImage dimg;
-  dimg.name = name;
+  if (id < 0 || id >= num_of_images) {
+    return -1;
+  }
+  if (NULL == mDiskImages[id].data) {
+    ret = LoadFromFile(id, mDiskImages[id].name);
+    if (0 > ret) return ret;
+  }
+  unsigned char *pimg = mDiskImages[id].data;
+  memset(pimg, 0, mDiskImages[id].size);
+  mDiskImages[id].dirty = (1ULL << max_numof_tracks) - 1;
+  // BAM + directory
+  unsigned char *pbam = pimg + mTrackOffs[17] * sector_size;
+  pbam[0x00] = 0x12; // point to track 18
+  pbam[0x01] = 0x01; // and sector 1 (directory)
+  pbam[0x02] = 0x41; // DOS version
+  pbam[0x03] = 0x00; // unused
   for (int track=0; track < max_numof_tracks; track++) {
-    dimg.data[track].num = track+1;
-    dimg.data[track].num_of_sectors = sect_per_track[track];
-    if (track+1 == 18) { // BAM + directory
-      dimg.data[track].data[0x00] = 0x12; // point to track 18
-      dimg.data[track].data[0x01] = 0x01; // and sector 1 (directory)
-      dimg.data[track].data[0x02] = 0x41; // DOS version
-      dimg.data[track].data[0x03] = 0x01; // unused
-      // BAM
-      for (int sector = 0x04; sector < 0x90; sector += 4) {
-        dimg.data[track].data[sector] = dimg.data[track].num_of_sectors;
-        dimg.data[track].data[sector+1] = 0xff;
-        dimg.data[track].data[sector+2] = 0xff;
-        dimg.data[track].data[sector+3] = ~(0xff << (dimg.data[track].num_of_sectors - 16));
-      }
-    } else {
-
+    unsigned char *pent = pbam + 0x04 + track * 4;
+    unsigned long map = (1UL << sect_per_track[track]) - 1;
+    if (track+1 == 18) {
+      map &= ~3UL; // BAM and first directory sector are taken
     }
+    int nfree = 0;
+    for (int sector=0; sector < sect_per_track[track]; sector++) {
+      if (map & (1UL << sector)) nfree++;
+    }
+    pent[0] = (unsigned char) nfree;
+    pent[1] = (unsigned char) (map & 0xff);
+    pent[2] = (unsigned char) ((map >> 8) & 0xff);
+    pent[3] = (unsigned char) ((map >> 16) & 0xff);
   }
+  memset(pbam + 0x90, 0xa0, 0x1b);
+  memcpy(pbam + 0x90, name.c_str(), (name.length() > 16) ? 16 : name.length());
+  pbam[0xa2] = '0';
+  pbam[0xa3] = (unsigned char) ('0' + id);
+  pbam[0xa5] = '2';
+  pbam[0xa6] = 'A';
+  // empty directory
+  pbam[sector_size] = 0x00;
+  pbam[sector_size + 1] = 0xff;
+  BuildDirIndex(id);
 
   return ret;
 }
@@ -150,6 +413,10 @@ int MassStorage::Format (int id, string name)
  *--------------------------------------------------------------------
  * Method:    Flush()
  * Purpose:   Save image data to disk file.
+ *            Tracks modified since last flush are copied, each
+ *            contiguous run of dirty tracks as one request, and
+ *            queued to background writer. Returns without waiting
+ *            for the disk, use Sync() to wait.
  * Arguments: id - the disk image id
  * Returns:   int - 0 if OK, less than 0 if error
  *--------------------------------------------------------------------
@@ -158,7 +425,432 @@ int MassStorage::Flush (int id)
 {
   int ret = 0;
 
-  // TO DO: add code to flush disk image to file
+  if (id < 0 || id >= num_of_images) {
+    return -1;
+  }
+  if (NULL == mDiskImages[id].data) {
+    return ret; // nothing to flush, image was never accessed
+  }
+  unsigned long long dirty = mDiskImages[id].dirty;
+  int track = 0;
+  while (0 != dirty && track < max_numof_tracks) {
+    if (0 == (dirty & (1ULL << track))) {
+      track++;
+      continue;
+    }
+    int first = track;
+    while (track < max_numof_tracks && 0 != (dirty & (1ULL << track))) {
+      dirty &= ~(1ULL << track);
+      track++;
+    }
+    QueueTracks(id, first, track-1);
+  }
+  mDiskImages[id].dirty = 0;
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    QueueTracks()
+ * Purpose:   Copy the range of tracks of mapped image and queue it
+ *            to background writer, start writer if not running.
+ * Arguments: id - the disk image id
+ *            first, last - index of first and last track (0 based)
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void MassStorage::QueueTracks(int id, int first, int last)
+{
+  FlushReq req;
+  size_t begin = (size_t) mTrackOffs[first] * sector_size;
+  size_t end = (size_t) mTrackOffs[last+1] * sector_size;
+
+  req.id = id;
+  req.offs = begin;
+  req.data.assign(mDiskImages[id].data + begin, mDiskImages[id].data + end);
+  req.queued = high_resolution_clock::now();
+  lock_guard<mutex> lock(mFlushMutex);
+  if (!mWriterThread.joinable()) {
+    mWriterStop = false;
+    mWriterThread = thread(&MassStorage::WriterLoop, this);
+  }
+  mFlushQueue.push_back(req);
+  mPending[id]++;
+  mFlushStats.queue_depth = mFlushQueue.size();
+  if (mFlushStats.queue_depth > mFlushStats.queue_max) {
+    mFlushStats.queue_max = mFlushStats.queue_depth;
+  }
+  mFlushCond.notify_all();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    Sync()
+ * Purpose:   Flush all open disk images and wait until all queued
+ *            data are written to image files and on disk.
+ * Arguments: n/a
+ * Returns:   int - 0 if OK, less than 0 if any write failed since
+ *            last Sync()
+ *--------------------------------------------------------------------
+ */
+int MassStorage::Sync ()
+{
+  int ret = 0;
+
+  for (int i=0; i < num_of_images; i++) {
+    Flush(i);
+  }
+  unique_lock<mutex> lock(mFlushMutex);
+  mFlushCond.wait(lock, [this] {
+    for (int i=0; i < num_of_images; i++) {
+      if (0 < mPending[i]) return false;
+    }
+    return true;
+  });
+  if (mWriteErr) ret = -1;
+  mWriteErr = false;
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    WriterLoop()
+ * Purpose:   Body of background writer thread. Takes all requests
+ *            queued so far as one batch and writes it, until stopped
+ *            and the queue is empty.
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void MassStorage::WriterLoop()
+{
+  unique_lock<mutex> lock(mFlushMutex);
+  while (true) {
+    mFlushCond.wait(lock, [this] { return mWriterStop || !mFlushQueue.empty(); });
+    if (mFlushQueue.empty()) break; // stopped
+    vector<FlushReq> batch(mFlushQueue.begin(), mFlushQueue.end());
+    mFlushQueue.clear();
+    mFlushStats.queue_depth = 0;
+    lock.unlock();
+    int err = WriteBatch(batch);
+    auto now = high_resolution_clock::now();
+    lock.lock();
+    for (vector<FlushReq>::iterator it = batch.begin(); it != batch.end(); ++it) {
+      long lat = (long) duration_cast<microseconds>(now - it->queued).count();
+      mFlushStats.lat_last = lat;
+      if (lat > mFlushStats.lat_max) mFlushStats.lat_max = lat;
+      mFlushStats.lat_total += lat;
+      mFlushStats.bytes += it->data.size();
+      mPending[it->id]--;
+    }
+    mFlushStats.requests += batch.size();
+    mFlushStats.batches++;
+    if (0 > err) {
+      mFlushStats.errors++;
+      mWriteErr = true;
+    }
+    mFlushCond.notify_all();
+  }
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    WriteBatch()
+ * Purpose:   Write batch of requests image by image, each through
+ *            the journal of its image file (WriteImageBatch()).
+ * Arguments: batch - requests to write
+ * Returns:   int - 0 if OK, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+int MassStorage::WriteBatch(vector<FlushReq> &batch)
+{
+  int ret = 0;
+
+  for (int id=0; id < num_of_images; id++) {
+    vector<FlushReq *> reqs;
+    for (vector<FlushReq>::iterator it = batch.begin(); it != batch.end(); ++it) {
+      if (it->id == id) reqs.push_back(&(*it));
+    }
+    if (!reqs.empty() && 0 > WriteImageBatch(ImageFileName(id), reqs)) {
+      ret = -1;
+    }
+  }
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    WriteImageBatch()
+ * Purpose:   Write requests of one image to its journal, commit it,
+ *            then write the data to image file and remove the
+ *            journal. If interrupted before commit, image file is
+ *            not touched yet, if after, ReplayJournal() completes it.
+ * Arguments: fname - image file name
+ *            reqs - requests to write
+ * Returns:   int - 0 if OK, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+int MassStorage::WriteImageBatch(string fname, vector<FlushReq *> &reqs)
+{
+  int ret = 0;
+  unsigned long sum = MASSSTOR_FNVBASIS;
+  string jname = fname + MASSSTOR_JRNLEXT;
+
+  FILE *fj = fopen(jname.c_str(), "wb");
+  if (NULL == fj) {
+    return -1;
+  }
+  fwrite(MASSSTOR_JRNLMAGIC, 1, strlen(MASSSTOR_JRNLMAGIC), fj);
+  PutJrnlU32(fj, reqs.size(), NULL);
+  for (vector<FlushReq *>::iterator it = reqs.begin(); it != reqs.end(); ++it) {
+    PutJrnlU32(fj, fname.length(), &sum);
+    PutJrnlBytes(fj, (const unsigned char *) fname.c_str(), fname.length(), &sum);
+    PutJrnlU32(fj, (*it)->offs, &sum);
+    PutJrnlU32(fj, (*it)->data.size(), &sum);
+    PutJrnlBytes(fj, (*it)->data.data(), (*it)->data.size(), &sum);
+  }
+  fwrite(MASSSTOR_JRNLEND, 1, strlen(MASSSTOR_JRNLEND), fj);
+  PutJrnlU32(fj, sum, NULL);
+  if (0 != ferror(fj) || 0 != SyncFile(fj)) {
+    ret = -1;
+  }
+  fclose(fj);
+  // journal must be found after crash before image is touched
+  if (0 == ret && 0 != SyncDir(jname)) {
+    ret = -1;
+  }
+  if (0 > ret) {
+    remove(jname.c_str());
+    return ret;
+  }
+  // journal committed, update image
+  vector<ImageRun> runs;
+  for (vector<FlushReq *>::iterator it = reqs.begin(); it != reqs.end(); ++it) {
+    ImageRun run = { (*it)->offs, (*it)->data.data(), (*it)->data.size() };
+    runs.push_back(run);
+  }
+  ret = WriteImageRuns(fname, runs);
+  // journal left after crash is replayed again, no harm
+  if (0 == ret) {
+    remove(jname.c_str());
+    SyncDir(jname);
+  }
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    ReplayJournal()
+ * Purpose:   Complete the flush of image file interrupted by crash:
+ *            if its journal is committed, write the data to image
+ *            file. Journal that is not complete or belongs to other
+ *            file is discarded (image was not touched).
+ * Arguments: fname - image file name
+ * Returns:   int - # of entries replayed, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+int MassStorage::ReplayJournal(string fname)
+{
+  int ret = 0;
+  unsigned long sum = MASSSTOR_FNVBASIS;
+  unsigned long n = 0, v = 0;
+  char magic[16];
+  string jname = fname + MASSSTOR_JRNLEXT;
+
+  FILE *fj = fopen(jname.c_str(), "rb");
+  if (NULL == fj) {
+    return ret;
+  }
+  size_t mlen = strlen(MASSSTOR_JRNLMAGIC);
+  bool ok = (fread(magic, 1, mlen, fj) == mlen
+             && 0 == memcmp(magic, MASSSTOR_JRNLMAGIC, mlen)
+             && GetJrnlU32(fj, &n, NULL));
+  vector<string> names;
+  vector<unsigned long> offs;
+  vector<vector<unsigned char> > datas;
+  for (unsigned long i=0; ok && i < n; i++) {
+    unsigned long len = 0, off = 0;
+    ok = GetJrnlU32(fj, &len, &sum) && len < 256;
+    string name(ok ? len : 0, ' ');
+    ok = ok && GetJrnlBytes(fj, (unsigned char *) &name[0], len, &sum)
+         && name == fname;
+    ok = ok && GetJrnlU32(fj, &off, &sum) && GetJrnlU32(fj, &len, &sum)
+         && off + len <= (unsigned long) numof_sectors * sector_size;
+    vector<unsigned char> data(ok ? len : 0);
+    ok = ok && GetJrnlBytes(fj, data.data(), len, &sum);
+    if (ok) {
+      names.push_back(name);
+      offs.push_back(off);
+      datas.push_back(data);
+    }
+  }
+  size_t elen = strlen(MASSSTOR_JRNLEND);
+  ok = ok && fread(magic, 1, elen, fj) == elen
+       && 0 == memcmp(magic, MASSSTOR_JRNLEND, elen)
+       && GetJrnlU32(fj, &v, NULL) && v == sum;
+  fclose(fj);
+  // all entries belong to fname (checked above)
+  vector<ImageRun> runs;
+  for (size_t i=0; ok && i < names.size(); i++) {
+    ImageRun run = { offs[i], datas[i].data(), datas[i].size() };
+    runs.push_back(run);
+  }
+  if (!runs.empty() && 0 > WriteImageRuns(fname, runs)) {
+    ret = -1;
+  } else {
+    ret = (int) runs.size();
+  }
+  if (0 <= ret) {
+    remove(jname.c_str());
+    SyncDir(jname);
+  }
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    GetFlushStats()
+ * Purpose:   Get statistics of background writer.
+ * Arguments: n/a
+ * Returns:   MassStorFlushStats - counters and latencies (usec)
+ *--------------------------------------------------------------------
+ */
+MassStorFlushStats MassStorage::GetFlushStats()
+{
+  lock_guard<mutex> lock(mFlushMutex);
+  return mFlushStats;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    EvictLRU()
+ * Purpose:   Write back and unmap the least recently used disk image.
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void MassStorage::EvictLRU()
+{
+  int lru = -1;
+
+  for (int i=0; i < num_of_images; i++) {
+    if (NULL != mDiskImages[i].data
+        && (0 > lru || mDiskImages[i].lastuse < mDiskImages[lru].lastuse)) {
+      lru = i;
+    }
+  }
+  if (0 <= lru) {
+    Close(lru);
+  }
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    Close()
+ * Purpose:   Flush the disk image and unmap it from memory.
+ *            Image will be mapped again on next access.
+ * Arguments: id - the disk image id
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void MassStorage::Close (int id)
+{
+  if (id < 0 || id >= num_of_images || NULL == mDiskImages[id].data) {
+    return;
+  }
+  Flush(id);
+#if defined(WINDOWS)
+  UnmapViewOfFile(mDiskImages[id].data);
+#else
+  munmap(mDiskImages[id].data, mDiskImages[id].size);
+#endif
+  mDiskImages[id].data = NULL;
+  mDiskImages[id].size = 0;
+  mDiskImages[id].dirty = 0;
+  mDirList[id].clear();
+  mDirIndex[id].clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    IsOpen()
+ * Purpose:   Check if disk image is mapped to memory.
+ * Arguments: id - the disk image id
+ * Returns:   bool - true if image is open
+ *--------------------------------------------------------------------
+ */
+bool MassStorage::IsOpen (int id)
+{
+  return (id >= 0 && id < num_of_images && NULL != mDiskImages[id].data);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    ImageExists()
+ * Purpose:   Check if disk image file exists, without creating it
+ *            (accessing the image creates and formats missing file).
+ * Arguments: id - the disk image id
+ * Returns:   bool - true if image is open or its file exists
+ *--------------------------------------------------------------------
+ */
+bool MassStorage::ImageExists (int id)
+{
+  if (id < 0 || id >= num_of_images) {
+    return false;
+  }
+  if (IsOpen(id)) {
+    return true;
+  }
+  FILE *fp = fopen(ImageFileName(id).c_str(), "rb");
+  if (NULL == fp) {
+    return false;
+  }
+  fclose(fp);
+
+  return true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    GetMappedSize()
+ * Purpose:   Get the size of address space taken by opened images.
+ *            Pages are loaded from the image files on demand, so
+ *            resident memory is usually much smaller.
+ * Arguments: n/a
+ * Returns:   size_t - # of bytes mapped
+ *--------------------------------------------------------------------
+ */
+size_t MassStorage::GetMappedSize()
+{
+  size_t ret = 0;
+
+  for (int i=0; i < num_of_images; i++) {
+    ret += mDiskImages[i].size;
+  }
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    GetNumOpen()
+ * Purpose:   Get the number of disk images mapped to memory.
+ * Arguments: n/a
+ * Returns:   int - # of open images (up to max_open_images)
+ *--------------------------------------------------------------------
+ */
+int MassStorage::GetNumOpen()
+{
+  int ret = 0;
+
+  for (int i=0; i < num_of_images; i++) {
+    if (NULL != mDiskImages[i].data) ret++;
+  }
 
   return ret;
 }
@@ -170,14 +862,18 @@ int MassStorage::Flush (int id)
  * Arguments: id - disk image id
  *            track - track#
  *            sector - sector#
- * Returns:   pointer to data
+ * Returns:   pointer to data, NULL if error
  *--------------------------------------------------------------------
  */
 unsigned char * MassStorage::ReadSectorData(int id, 
                                             int track, 
                                             int sector)
 {
-  // TO DO: add code to read data
+  int offs = SectorOffset(id, track, sector);
+  if (0 > offs) {
+    return NULL;
+  }
+  memcpy(mSectorBuf, mDiskImages[id].data + offs, sector_size);
 
   return mSectorBuf;
 }
@@ -200,7 +896,15 @@ int MassStorage::WriteSectorData (int id,
 {
   int ret = 0;
 
-  // TO DO: add code to write sector data
+  int offs = SectorOffset(id, track, sector);
+  if (0 > offs || NULL == buf) {
+    return -1;
+  }
+  memcpy(mDiskImages[id].data + offs, buf, sector_size);
+  mDiskImages[id].dirty |= 1ULL << (track-1);
+  if (dir_track == track) {
+    BuildDirIndex(id);
+  }
 
   return ret;
 }
@@ -208,7 +912,12 @@ int MassStorage::WriteSectorData (int id,
 /*
  *--------------------------------------------------------------------
  * Method:    LoadFromFile()
- * Purpose:   Load image data from file.
+ * Purpose:   Map image data from file to memory.
+ *            File is created (and formatted) if it does not exist,
+ *            extended if it is shorter than the image.
+ *            Mapping is private (copy on write), image file is only
+ *            updated by background writer, so the data written to
+ *            the file are always journaled first.
  * Arguments: id - the disk image id
  *            name - disk image name
  * Returns:   int - 0 if OK, less than 0 if error
@@ -217,6 +926,290 @@ int MassStorage::WriteSectorData (int id,
 int  MassStorage::LoadFromFile(int id, string name)
 {
   int ret = 0;
+  size_t size = numof_sectors * sector_size;
+  bool newimg = false;
+
+  if (id < 0 || id >= num_of_images) {
+    return -1;
+  }
+  if (NULL != mDiskImages[id].data) {
+    return ret; // already mapped
+  }
+  if (GetNumOpen() >= max_open_images) {
+    EvictLRU();
+  }
+  {
+    // data of this image queued before it was closed must be in file
+    unique_lock<mutex> lock(mFlushMutex);
+    mFlushCond.wait(lock, [this, id] { return 0 == mPending[id]; });
+  }
+  mDiskImages[id].name = name;
+  string fname = ImageFileName(id);
+  // flush interrupted by crash is completed before image is mapped
+  ReplayJournal(fname);
+#if defined(WINDOWS)
+  HANDLE hfile = CreateFile(fname.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE == hfile) {
+    return -1;
+  }
+  DWORD fsize = GetFileSize(hfile, NULL);
+  newimg = (0 == fsize);
+  if (fsize < size) {
+    SetFilePointer(hfile, (LONG) size, NULL, FILE_BEGIN);
+    SetEndOfFile(hfile);
+  }
+  HANDLE hmap = CreateFileMapping(hfile, NULL, PAGE_WRITECOPY, 0,
+                                  (DWORD) size, NULL);
+  if (NULL != hmap) {
+    mDiskImages[id].data = (unsigned char *) MapViewOfFile(hmap,
+                                                           FILE_MAP_COPY,
+                                                           0, 0, size);
+    CloseHandle(hmap);
+  }
+  CloseHandle(hfile);
+  if (NULL == mDiskImages[id].data) {
+    return -1;
+  }
+#else
+  int fd = open(fname.c_str(), O_RDWR | O_CREAT, 0644);
+  if (0 > fd) {
+    return -1;
+  }
+  struct stat st;
+  if (0 != fstat(fd, &st)) {
+    close(fd);
+    return -1;
+  }
+  newimg = (0 == st.st_size);
+  if ((size_t) st.st_size < size && 0 != ftruncate(fd, size)) {
+    close(fd);
+    return -1;
+  }
+  void *pmap = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd); // mapping keeps the file referenced
+  if (MAP_FAILED == pmap) {
+    return -1;
+  }
+  mDiskImages[id].data = (unsigned char *) pmap;
+#endif
+  mDiskImages[id].size = size;
+  mDiskImages[id].dirty = 0;
+  mDiskImages[id].lastuse = ++mUseCount;
+  if (newimg) {
+    ret = Format(id, name);
+    if (0 == ret) ret = Flush(id);
+  } else {
+    BuildDirIndex(id);
+  }
+
+  return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    BuildDirIndex()
+ * Purpose:   Read directory of mapped disk image (sector chain
+ *            starting at track 18, sector 1) into the list of files
+ *            and index by file name.
+ * Arguments: id - the disk image id
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void MassStorage::BuildDirIndex(int id)
+{
+  mDirList[id].clear();
+  mDirIndex[id].clear();
+  unsigned char *pimg = mDiskImages[id].data;
+  int track = dir_track, sector = 1;
+  // chain can't be longer than the directory track (guards loops)
+  for (int n=0; n < sect_per_track[dir_track-1] && track == dir_track; n++) {
+    if (sector >= sect_per_track[track-1]) break;
+    unsigned char *psec = pimg + (mTrackOffs[track-1] + sector) * sector_size;
+    for (int e=0; e < sector_size; e += dir_entry_size) {
+      unsigned char *pent = psec + e;
+      if (0 == (pent[2] & 0x0F) && 0 == (pent[2] & 0x80)) {
+        continue; // empty or scratched
+      }
+      MassStorDirEntry entry;
+      int len = 16;
+      while (len > 0 && 0xa0 == pent[5 + len - 1]) len--;
+      entry.name.assign((const char *) pent + 5, len);
+      entry.type = pent[2] & 0x0F;
+      entry.track = pent[3];
+      entry.sector = pent[4];
+      entry.blocks = pent[30] + 256 * pent[31];
+      if (mDirIndex[id].find(entry.name) == mDirIndex[id].end()) {
+        mDirIndex[id][entry.name] = (int) mDirList[id].size();
+      }
+      mDirList[id].push_back(entry);
+    }
+    track = psec[0];
+    sector = psec[1];
+  }
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    GetDirectory()
+ * Purpose:   Get list of files of disk image in directory order.
+ * Arguments: id - the disk image id
+ * Returns:   vector<MassStorDirEntry> - files, empty if error
+ *--------------------------------------------------------------------
+ */
+vector<MassStorDirEntry> MassStorage::GetDirectory (int id)
+{
+  if (0 > SectorOffset(id, dir_track, 0)) {
+    return vector<MassStorDirEntry>();
+  }
+
+  return mDirList[id];
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    FindFile()
+ * Purpose:   Look up file in the directory of disk image.
+ * Arguments: id - the disk image id
+ *            name - file name
+ *            entry - directory entry of the file (output)
+ * Returns:   bool - true if found
+ *--------------------------------------------------------------------
+ */
+bool MassStorage::FindFile (int id, string name, MassStorDirEntry &entry)
+{
+  if (0 > SectorOffset(id, dir_track, 0)) {
+    return false;
+  }
+  unordered_map<string, int>::iterator it = mDirIndex[id].find(name);
+  if (it == mDirIndex[id].end()) {
+    return false;
+  }
+  entry = mDirList[id][it->second];
+
+  return true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    ReadFile()
+ * Purpose:   Read data of the file from disk image, following the
+ *            chain of sectors.
+ * Arguments: id - the disk image id
+ *            name - file name
+ *            data - file data (output)
+ * Returns:   int - 0 if OK, less than 0 if error (file not found,
+ *            broken chain)
+ *--------------------------------------------------------------------
+ */
+int MassStorage::ReadFile (int id, string name, vector<unsigned char> &data)
+{
+  MassStorDirEntry entry;
+
+  data.clear();
+  if (!FindFile(id, name, entry)) {
+    return -1;
+  }
+  int track = entry.track, sector = entry.sector;
+  for (int n=0; n < numof_sectors; n++) {
+    int offs = SectorOffset(id, track, sector);
+    if (0 > offs) {
+      return -1;
+    }
+    unsigned char *psec = mDiskImages[id].data + offs;
+    if (0 == psec[0]) {
+      // last sector, byte 1 is the index of last used byte
+      if (psec[1] >= 2) {
+        data.insert(data.end(), psec + 2, psec + psec[1] + 1);
+      }
+      return 0;
+    }
+    data.insert(data.end(), psec + 2, psec + sector_size);
+    track = psec[0];
+    sector = psec[1];
+  }
+
+  return -1; // chain loops
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    ImportD64()
+ * Purpose:   Load contents of .d64 file (35 tracks, with or without
+ *            error info bytes, which are ignored) to disk image.
+ *            Image is flushed to its file. Extended images (40, 42
+ *            tracks) are rejected, tracks beyond 35 would be lost.
+ * Arguments: id - the disk image id
+ *            path - .d64 file path
+ * Returns:   int - 0 if OK, -2 if not a 35 track image,
+ *                  -1 if other error
+ *--------------------------------------------------------------------
+ */
+int MassStorage::ImportD64 (int id, string path)
+{
+  int ret = 0;
+  long size = (long) numof_sectors * sector_size;
+
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (NULL == fp) {
+    return -1;
+  }
+  // 35 tracks, optionally followed by 1 error info byte per sector
+  long fsize = -1;
+  if (0 == fseek(fp, 0, SEEK_END)) {
+    fsize = ftell(fp);
+  }
+  if (fsize != size && fsize != size + numof_sectors) {
+    fclose(fp);
+    return (fsize > size + numof_sectors) ? -2 : -1;
+  }
+  if (0 != fseek(fp, 0, SEEK_SET) || 0 > SectorOffset(id, dir_track, 0)) {
+    fclose(fp);
+    return -1;
+  }
+  vector<unsigned char> buf(mDiskImages[id].size);
+  if (fread(buf.data(), 1, buf.size(), fp) != buf.size()) {
+    ret = -1;
+  }
+  fclose(fp);
+  if (0 > ret) {
+    return ret;
+  }
+  memcpy(mDiskImages[id].data, buf.data(), buf.size());
+  mDiskImages[id].dirty = (1ULL << max_numof_tracks) - 1;
+  BuildDirIndex(id);
+
+  return Flush(id);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    ExportD64()
+ * Purpose:   Save disk image as .d64 file (35 tracks, no error info).
+ * Arguments: id - the disk image id
+ *            path - .d64 file path
+ * Returns:   int - 0 if OK, less than 0 if error
+ *--------------------------------------------------------------------
+ */
+int MassStorage::ExportD64 (int id, string path)
+{
+  int ret = 0;
+
+  if (0 > SectorOffset(id, dir_track, 0)) {
+    return -1;
+  }
+  FILE *fp = fopen(path.c_str(), "wb");
+  if (NULL == fp) {
+    return -1;
+  }
+  if (fwrite(mDiskImages[id].data, 1, mDiskImages[id].size, fp)
+      != mDiskImages[id].size) {
+    ret = -1;
+  }
+  if (0 != fclose(fp)) {
+    ret = -1;
+  }
 
   return ret;
 }
@@ -34,11 +34,57 @@
 #define MASSSTORAGE_H
 
 #include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stddef.h>
+
+// journal of flushed data, written before the image file is updated,
+// one per image: image file name + extension
+#define MASSSTOR_JRNLEXT   ".jrnl"
+#define MASSSTOR_JRNLMAGIC "VM65JRNL"
+#define MASSSTOR_JRNLEND   "COMMIT"
 
 using namespace std;
+using namespace chrono;
 
 namespace MKBasic {
 
+   // CBM DOS file types (low bits of directory entry type byte)
+   enum eMassStorFileTypes {
+      MASSSTOR_FTYPE_DEL = 0,
+      MASSSTOR_FTYPE_SEQ = 1,
+      MASSSTOR_FTYPE_PRG = 2,
+      MASSSTOR_FTYPE_USR = 3,
+      MASSSTOR_FTYPE_REL = 4
+   };
+
+   // file in the disk image directory
+   struct MassStorDirEntry {
+      string   name;          // file name (without $A0 padding)
+      int      type;          // file type (eMassStorFileTypes)
+      int      track;         // first track/sector of the file data
+      int      sector;
+      int      blocks;        // size in sectors (as in directory)
+   };
+
+   // statistics of background writer
+   struct MassStorFlushStats {
+      unsigned long        requests;      // contiguous runs of tracks written
+      unsigned long        batches;       // journal transactions
+      unsigned long long   bytes;         // bytes written to images
+      unsigned long        errors;        // failed transactions
+      unsigned long        queue_depth;   // requests waiting now
+      unsigned long        queue_max;     // max. requests waiting
+      long                 lat_last;      // flush to durable latency (usec)
+      long                 lat_max;
+      long long            lat_total;     // sum of latencies of all requests
+   };
+
    class MassStorage {
 
       public:
@@ -48,6 +94,10 @@ namespace MKBasic {
          static const int sector_size         = 256;
          static const int max_numof_tracks    = 35;
          static const int num_of_images       = 10;
+         static const int numof_sectors       = 683;   // total, 174848 bytes
+         static const int max_open_images     = 4;     // mapped at a time
+         static const int dir_track           = 18;    // BAM and directory
+         static const int dir_entry_size      = 32;
          constexpr static int sect_per_track[]  = 
                {21, 21, 21, 21, 21, 21, 21,
                 21, 21, 21, 21, 21, 21, 21,
@@ -59,7 +109,8 @@ namespace MKBasic {
          MassStorage();
          ~MassStorage();
          int Format (int id, string name);  // format disk image
-         int Flush (int id);                // flush disk image to hard drive
+         int Flush (int id);                // queue write back of disk image
+         int Sync ();                       // wait until all writes are durable
          unsigned char *ReadSectorData(int id, 
                                        int track, 
                                        int sector);  // read data from sector
@@ -67,31 +118,71 @@ namespace MKBasic {
                               int track, 
                               int sector, 
                               unsigned char *buf); // write data to sector
+         void Close (int id);               // flush and unmap disk image
+         bool IsOpen (int id);              // disk image is mapped
+         bool ImageExists (int id);         // disk image file exists
+         size_t GetMappedSize();            // bytes of mapped disk images
+         int GetNumOpen();                  // # of mapped disk images
+         MassStorFlushStats GetFlushStats();
+         int ImportD64 (int id, string path);  // load .d64 file to image
+         int ExportD64 (int id, string path);  // save image as .d64 file
+         vector<MassStorDirEntry> GetDirectory (int id);
+         bool FindFile (int id, string name, MassStorDirEntry &entry);
+         int ReadFile (int id, string name, vector<unsigned char> &data);
 
       private:
 
-         // definition of a disk track structure
-         struct DiskTrack {
-
-            int num;
-            int num_of_sectors;
-            unsigned char data[max_numof_sectors * sector_size];
+         // definition of a disk image structure, the data are mapped
+         // from the image file when the image is accessed first time
+         struct DiskImage {
 
+            int             id;
+            string          name;
+            unsigned char   *data;         // mapped file, NULL if not open
+            size_t          size;
+            unsigned long long dirty;      // bit per track modified since flush
+            unsigned long   lastuse;       // access stamp for LRU eviction
          };
 
-         // definition of a disk image structure
-         struct DiskImage {
+         unsigned char  mSectorBuf[sector_size];        // buffer for sector data
+         DiskImage      mDiskImages[num_of_images];     // disk images
+         int            mTrackOffs[max_numof_tracks+1]; // first sector of track
+         unsigned long  mUseCount;                      // access stamp counter
 
-            int         id;
-            string      name;
-            DiskTrack   data[max_numof_tracks];
-         };         
+         // data of contiguous run of tracks to be written to image file
+         struct FlushReq {
 
-         unsigned char  mSectorBuf[sector_size];        // buffer for sector data
-         DiskImage      mDiskImages[num_of_images];     // buffer for all disk images
+            int             id;
+            size_t          offs;          // offset in image file
+            vector<unsigned char> data;
+            time_point<high_resolution_clock> queued;
+         };
+
+         deque<FlushReq> mFlushQueue;                   // waiting for writer
+         int            mPending[num_of_images];        // queued or being written
+         thread         mWriterThread;
+         mutex          mFlushMutex;                    // guards all below
+         condition_variable mFlushCond;
+         bool           mWriterStop;
+         bool           mWriteErr;                      // reported by Sync()
+         MassStorFlushStats mFlushStats;
+
+         // directory of each image, built when image is opened and
+         // rebuilt when directory track is written
+         vector<MassStorDirEntry> mDirList[num_of_images];
+         unordered_map<string, int> mDirIndex[num_of_images];  // name -> entry #
 
          void Initialize();
-         int  LoadFromFile(int id, string name);        // load image from disk cache
+         int  LoadFromFile(int id, string name);        // map image file
+         int  SectorOffset(int id, int track, int sector);
+         void QueueTracks(int id, int first, int last); // copy tracks for writer
+         void WriterLoop();                             // background writer
+         int  WriteBatch(vector<FlushReq> &batch);      // journal and apply
+         int  WriteImageBatch(string fname, vector<FlushReq *> &reqs);
+         int  ReplayJournal(string fname);              // finish interrupted flush
+         void BuildDirIndex(int id);                    // read directory of image
+         void EvictLRU();                               // unmap least recently used
+         string ImageFileName(int id);
 
    }; // class MassStorage
 
@@ -50,6 +50,8 @@
 #include <iostream>
 #include <sstream>
 #include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 #if defined(WINDOWS)
 #include <conio.h>
 #endif
@@ -109,7 +111,19 @@ MemMapDev::MemMapDev(Memory *pmem)
  */
 MemMapDev::~MemMapDev()
 {
-
+	// devices first, their code may live in libraries unloaded by registry
+	for (vector<PlugDevEntry>::iterator it = mPlugDevs.begin();
+			 it != mPlugDevs.end();
+			 ++it
+			) {
+		delete it->pdev;
+	}
+	mPlugDevs.clear();
+	if (NULL != mpMem) mpMem->GetEventSched()->CancelAll(this);
+	if (NULL != mpAciaLink) delete mpAciaLink;
+	if (NULL != mpDiskStorage) delete mpDiskStorage;
+	if (NULL != mpPlugDevReg) delete mpPlugDevReg;
+	if (NULL != mpPlugDevHost) delete mpPlugDevHost;
 }
 
 /*
@@ -127,9 +141,15 @@ void MemMapDev::Initialize()
 		throw MKGenException("MemMapDev::Initialize() : Out of memory - ConsoleIO");
 	mInBufDataBegin = mInBufDataEnd = 0;	
 	mOutBufDataBegin = mOutBufDataEnd = 0;
+	mCharIOCaptActive = false;
+	mCharIOCaptMax = CHARIO_CAPT_SIZE;
+	ClearCharIOCapture();
 	mIOEcho = false;
 	mCharIOAddr = CHARIO_ADDR;
 	mGraphDispAddr = GRDISP_ADDR;
+	mGraphDispFps = GRDISP_FPS;
+	mGraphDispBackend = GRDISP_BACKEND_SDL;
+	mGraphDispDumpPrefix.clear();
 	mpGraphDisp = NULL;
 	mpCharIODisp = NULL;
 	mGrDevRegs.mGraphDispChrTbl = CHARTBL_BANK;
@@ -143,12 +163,18 @@ void MemMapDev::Initialize()
 	DevParams dev_params_chario;
 	addr_ranges_chario.push_back(addr_range);
 	dev_params_chario.push_back(dev_par);
+	RegReadFuns rdregs_chario;
+	RegWriteFuns wrregs_chario(2, &MemMapDev::CharIOReg_PutCh);
+	rdregs_chario.push_back(&MemMapDev::CharIOReg_GetCh);
+	rdregs_chario.push_back(&MemMapDev::CharIOReg_GetChNb);
 	Device dev_chario(DEVNUM_CHARIO, 
 						 				"Character I/O", 
 									  addr_ranges_chario, 
-									  &MemMapDev::CharIODevice_Read,
-									  &MemMapDev::CharIODevice_Write,
-									  dev_params_chario);
+									  NULL,
+									  NULL,
+									  dev_params_chario,
+									  rdregs_chario,
+									  wrregs_chario);
 	mDevices.push_back(dev_chario);
 
 	addr_range.start_addr = GRDISP_ADDR;
@@ -159,14 +185,237 @@ void MemMapDev::Initialize()
 	DevParams dev_params_grdisp;
 	addr_ranges_grdisp.push_back(addr_range);
 	dev_params_grdisp.push_back(dev_par);	
+	mGrDevRegPtr[GRAPHDEVREG_X]				= &mGrDevRegs.mGraphDispLoX;
+	mGrDevRegPtr[GRAPHDEVREG_X + 1]		= &mGrDevRegs.mGraphDispHiX;
+	mGrDevRegPtr[GRAPHDEVREG_Y]				= &mGrDevRegs.mGraphDispY;
+	mGrDevRegPtr[GRAPHDEVREG_PXCOL_R]	= &mGrDevRegs.mGraphDispPixColR;
+	mGrDevRegPtr[GRAPHDEVREG_PXCOL_G]	= &mGrDevRegs.mGraphDispPixColG;
+	mGrDevRegPtr[GRAPHDEVREG_PXCOL_B]	= &mGrDevRegs.mGraphDispPixColB;
+	mGrDevRegPtr[GRAPHDEVREG_BGCOL_R]	= &mGrDevRegs.mGraphDispBgColR;
+	mGrDevRegPtr[GRAPHDEVREG_BGCOL_G]	= &mGrDevRegs.mGraphDispBgColG;
+	mGrDevRegPtr[GRAPHDEVREG_BGCOL_B]	= &mGrDevRegs.mGraphDispBgColB;
+	mGrDevRegPtr[GRAPHDEVREG_X2]			= &mGrDevRegs.mGraphDispLoX2;
+	mGrDevRegPtr[GRAPHDEVREG_X2 + 1]	= &mGrDevRegs.mGraphDispHiX2;
+	mGrDevRegPtr[GRAPHDEVREG_Y2]			= &mGrDevRegs.mGraphDispY2;
+	RegWriteFuns wrregs_grdisp(GRAPHDEVREG_END, &MemMapDev::GraphDispReg_Latch);
+	wrregs_grdisp[GRAPHDEVREG_CMD]			= &MemMapDev::GraphDispReg_Cmd;
+	wrregs_grdisp[GRAPHDEVREG_CHRTBL]		= &MemMapDev::GraphDispReg_ChrTbl;
+	wrregs_grdisp[GRAPHDEVREG_TXTCURX]	= &MemMapDev::GraphDispReg_TxtCurX;
+	wrregs_grdisp[GRAPHDEVREG_TXTCURY]	= &MemMapDev::GraphDispReg_TxtCurY;
+	wrregs_grdisp[GRAPHDEVREG_PUTC]			= &MemMapDev::GraphDispReg_PutC;
+	wrregs_grdisp[GRAPHDEVREG_CRSMODE]	= &MemMapDev::GraphDispReg_CrsMode;
+	wrregs_grdisp[GRAPHDEVREG_TXTMODE]	= &MemMapDev::GraphDispReg_TxtMode;
+	wrregs_grdisp[GRAPHDEVREG_BMPADDR]	= &MemMapDev::GraphDispReg_BmpAddr;
+	wrregs_grdisp[GRAPHDEVREG_BMPMODE]	= &MemMapDev::GraphDispReg_BmpMode;
+	// no read registers
 	Device dev_grdisp(DEVNUM_GRDISP, 
 									  "Graphics Display", 
 									  addr_ranges_grdisp, 
-									  &MemMapDev::GraphDispDevice_Read,
-									  &MemMapDev::GraphDispDevice_Write,
-									  dev_params_grdisp);
+									  NULL,
+									  NULL,
+									  dev_params_grdisp,
+									  RegReadFuns(),
+									  wrregs_grdisp);
 	mDevices.push_back(dev_grdisp);	
+
+	mDmaAddr = DMA_ADDR;
+	mDmaByteCycles = DMA_BYTECYCLES;
+	memset(mDmaRegs, 0, sizeof(mDmaRegs));
+	addr_range.start_addr = DMA_ADDR;
+	addr_range.end_addr = DMA_ADDR + DMADEVREG_END - 1;
+	MemAddrRanges addr_ranges_dma;
+	DevParams dev_params_dma;
+	addr_ranges_dma.push_back(addr_range);
+	dev_params_dma.push_back(dev_par);
+	RegWriteFuns wrregs_dma(DMADEVREG_END, &MemMapDev::DmaReg_Latch);
+	wrregs_dma[DMADEVREG_CMD] = &MemMapDev::DmaReg_Cmd;
+	Device dev_dma(DEVNUM_DMA,
+								 "DMA / Blitter",
+								 addr_ranges_dma,
+								 NULL,
+								 NULL,
+								 dev_params_dma,
+								 RegReadFuns(),
+								 wrregs_dma);
+	mDevices.push_back(dev_dma);
+
+	mViaAddr = VIA_ADDR;
+	mViaRegs.t1evt = mViaRegs.t2evt = mViaRegs.srevt = 0;
+	ViaReset();
+	addr_range.start_addr = VIA_ADDR;
+	addr_range.end_addr = VIA_ADDR + VIADEVREG_END - 1;
+	MemAddrRanges addr_ranges_via;
+	DevParams dev_params_via;
+	addr_ranges_via.push_back(addr_range);
+	dev_params_via.push_back(dev_par);
+	RegReadFuns rdregs_via(VIADEVREG_END, &MemMapDev::ViaReg_Read);
+	RegWriteFuns wrregs_via(VIADEVREG_END, &MemMapDev::ViaReg_Write);
+	Device dev_via(DEVNUM_VIA,
+								 "VIA 6522",
+								 addr_ranges_via,
+								 NULL,
+								 NULL,
+								 dev_params_via,
+								 rdregs_via,
+								 wrregs_via);
+	mDevices.push_back(dev_via);
+
+	mAciaAddr = ACIA_ADDR;
+	mAciaClock = ACIA_CLOCK;
+	mpAciaLink = new SerialLink();
+	if (NULL == mpAciaLink)
+		throw MKGenException("MemMapDev::Initialize() : Out of memory - SerialLink");
+	mAciaRegs.txevt = mAciaRegs.rxevt = mAciaRegs.pollevt = 0;
+	AciaReset();
+	addr_range.start_addr = ACIA_ADDR;
+	addr_range.end_addr = ACIA_ADDR + ACIADEVREG_END - 1;
+	MemAddrRanges addr_ranges_acia;
+	DevParams dev_params_acia;
+	addr_ranges_acia.push_back(addr_range);
+	dev_params_acia.push_back(dev_par);
+	RegReadFuns rdregs_acia(ACIADEVREG_END, &MemMapDev::AciaReg_Status);
+	rdregs_acia[ACIADEVREG_DATA] = &MemMapDev::AciaReg_Data;
+	RegWriteFuns wrregs_acia(ACIADEVREG_END, &MemMapDev::AciaReg_Ctrl);
+	wrregs_acia[ACIADEVREG_DATA] = &MemMapDev::AciaReg_Tx;
+	wrregs_acia[ACIADEVREG_STATUS] = &MemMapDev::AciaReg_Reset;
+	wrregs_acia[ACIADEVREG_CMD] = &MemMapDev::AciaReg_Cmd;
+	Device dev_acia(DEVNUM_ACIA,
+								 "ACIA 6551",
+								 addr_ranges_acia,
+								 NULL,
+								 NULL,
+								 dev_params_acia,
+								 rdregs_acia,
+								 wrregs_acia);
+	mDevices.push_back(dev_acia);
+
+	mIntcAddr = INTC_ADDR;
+	addr_range.start_addr = INTC_ADDR;
+	addr_range.end_addr = INTC_ADDR + INTCDEVREG_END - 1;
+	MemAddrRanges addr_ranges_intc;
+	DevParams dev_params_intc;
+	addr_ranges_intc.push_back(addr_range);
+	dev_params_intc.push_back(dev_par);
+	RegReadFuns rdregs_intc(INTCDEVREG_END, &MemMapDev::IntcReg_Read);
+	RegWriteFuns wrregs_intc(INTCDEVREG_END, &MemMapDev::IntcReg_Write);
+	Device dev_intc(DEVNUM_INTC,
+								 "Interrupt Controller",
+								 addr_ranges_intc,
+								 NULL,
+								 NULL,
+								 dev_params_intc,
+								 rdregs_intc,
+								 wrregs_intc);
+	mDevices.push_back(dev_intc);
+
+	mDiskAddr = DISK_ADDR;
+	mDiskCmdCycles = DISK_CMDCYCLES;
+	// disk image files are opened on first access, not here
+	mpDiskStorage = new MassStorage();
+	if (NULL == mpDiskStorage)
+		throw MKGenException("MemMapDev::Initialize() : Out of memory - MassStorage");
+	mDiskRegs.cmdevt = 0;
+	DiskReset();
+	addr_range.start_addr = DISK_ADDR;
+	addr_range.end_addr = DISK_ADDR + DISKDEVREG_END - 1;
+	MemAddrRanges addr_ranges_disk;
+	DevParams dev_params_disk;
+	addr_ranges_disk.push_back(addr_range);
+	dev_params_disk.push_back(dev_par);
+	RegReadFuns rdregs_disk(DISKDEVREG_END, &MemMapDev::DiskReg_Read);
+	RegWriteFuns wrregs_disk(DISKDEVREG_END, &MemMapDev::DiskReg_Latch);
+	wrregs_disk[DISKDEVREG_CMD] = &MemMapDev::DiskReg_Cmd;
+	wrregs_disk[DISKDEVREG_STATUS] = &MemMapDev::DiskReg_Status;
+	Device dev_disk(DEVNUM_DISK,
+								 "Disk Controller",
+								 addr_ranges_disk,
+								 NULL,
+								 NULL,
+								 dev_params_disk,
+								 rdregs_disk,
+								 wrregs_disk);
+	mDevices.push_back(dev_disk);
 	mCharIOActive = false;
+
+	mPlugDevs.clear();
+	mPlugDevRegs.clear();
+	mpPlugDevReg = new PlugDevRegistry();
+	if (NULL == mpPlugDevReg)
+		throw MKGenException("MemMapDev::Initialize() : Out of memory - PlugDevRegistry");
+	mpPlugDevHost = new PlugDevMemHost(mpMem);
+	if (NULL == mpPlugDevHost)
+		throw MKGenException("MemMapDev::Initialize() : Out of memory - PlugDevMemHost");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		HandleEvent()
+ * Purpose:		Execute device action scheduled in event scheduler.
+ * Arguments:	evtid - event code (MemMapDevEvents)
+ *            cycle - current CPU cycle
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::HandleEvent(int evtid, unsigned long long cycle)
+{
+	switch (evtid) {
+		case MMDEVEVT_PLUGDEV_TICK:
+			PlugDev_Tick(PLUGDEV_TICK_CYCLES);
+			mpMem->GetEventSched()->Schedule(PLUGDEV_TICK_CYCLES, this,
+																			 MMDEVEVT_PLUGDEV_TICK);
+			break;
+		case MMDEVEVT_VIA_T1:
+			ViaT1Timeout();
+			break;
+		case MMDEVEVT_VIA_T2:
+			mViaRegs.t2evt = 0;
+			if (mViaRegs.t2irq) {
+				mViaRegs.t2irq = false;
+				ViaSetFlags(VIAIRQ_T2);
+			}
+			break;
+		case MMDEVEVT_VIA_SR:
+			mViaRegs.srevt = 0;
+			// CB2 is not connected, it stays high when shifting in
+			if (!(mViaRegs.acr & 0x10)) mViaRegs.sr = 0xFF;
+			ViaSetFlags(VIAIRQ_SR);
+			break;
+		case MMDEVEVT_ACIA_TX:
+			mAciaRegs.txevt = 0;
+			mpAciaLink->TxPut(mAciaRegs.txdata);
+			mAciaRegs.status |= ACIASTAT_TDRE;
+			AciaSetIrq(ACIASTAT_TDRE);
+			break;
+		case MMDEVEVT_ACIA_RX:
+			mAciaRegs.rxevt = 0;
+			if (!(mAciaRegs.cmd & ACIACMD_DTR) || mpAciaLink->RxEmpty()) break;
+			if (mAciaRegs.status & ACIASTAT_RDRF) {
+				// program didn't read previous character yet, host data
+				// waits in the buffer, so nothing is lost
+				AciaStartRx();
+				break;
+			}
+			mAciaRegs.rxdata = mpAciaLink->RxGet();
+			mAciaRegs.status |= ACIASTAT_RDRF;
+			if (mAciaRegs.cmd & ACIACMD_ECHO) mpAciaLink->TxPut(mAciaRegs.rxdata);
+			AciaSetIrq(ACIASTAT_RDRF);
+			AciaStartRx();
+			break;
+		case MMDEVEVT_ACIA_POLL:
+			mAciaRegs.pollevt = 0;
+			if (mpAciaLink->GetType() == SERLINK_NONE) break;
+			mpAciaLink->Poll();
+			AciaStartRx();
+			mAciaRegs.pollevt = mpMem->GetEventSched()->Schedule(ACIA_POLL_CYCLES,
+																			this, MMDEVEVT_ACIA_POLL);
+			break;
+		case MMDEVEVT_DISK_DONE:
+			mDiskRegs.cmdevt = 0;
+			DiskComplete();
+			break;
+		default:
+			break;
+	}
 }
 
 /*
@@ -215,6 +464,8 @@ int MemMapDev::SetupDevice(int devnum,
 	if (dev.num >= 0) {
 		dev.addr_ranges = memranges;
 		dev.params = params;
+		// register tables follow the beginning of the first range
+		if (!memranges.empty()) dev.reg_base = memranges[0].start_addr;
 		MemMappedDevices devices_new;
 		for (MemMappedDevices::iterator it = mDevices.begin();
 				 it != mDevices.end();
@@ -246,6 +497,60 @@ int MemMapDev::SetupDevice(int devnum,
 		} else if (DEVNUM_GRDISP == devnum) {
 			MemAddrRanges::iterator it = memranges.begin();
 			mGraphDispAddr = (*it).start_addr;
+			for (DevParams::iterator it = params.begin();
+					 it != params.end();
+					 ++it
+					) {
+				if (0 == (*it).name.compare("fps")) {
+					// same range as GraphDisp::SetFrameRate(), frame period
+					// is computed from it
+					mGraphDispFps = atoi((*it).value.c_str());
+					if (mGraphDispFps < 1) mGraphDispFps = 1;
+					if (mGraphDispFps > GRDISP_MAXFPS) mGraphDispFps = GRDISP_MAXFPS;
+					if (NULL != mpGraphDisp) mpGraphDisp->SetFrameRate(mGraphDispFps);
+				}
+			}
+		} else if (DEVNUM_VIA == devnum) {
+			MemAddrRanges::iterator it = memranges.begin();
+			mViaAddr = (*it).start_addr;
+		} else if (DEVNUM_INTC == devnum) {
+			MemAddrRanges::iterator it = memranges.begin();
+			mIntcAddr = (*it).start_addr;
+		} else if (DEVNUM_DISK == devnum) {
+			MemAddrRanges::iterator it = memranges.begin();
+			mDiskAddr = (*it).start_addr;
+			for (DevParams::iterator it = params.begin();
+					 it != params.end();
+					 ++it
+					) {
+				if (0 == (*it).name.compare("cycles")) {
+					mDiskCmdCycles = strtoul((*it).value.c_str(), NULL, 10);
+				}
+			}
+		} else if (DEVNUM_ACIA == devnum) {
+			MemAddrRanges::iterator it = memranges.begin();
+			mAciaAddr = (*it).start_addr;
+			for (DevParams::iterator it = params.begin();
+					 it != params.end();
+					 ++it
+					) {
+				if (0 == (*it).name.compare("clock")) {
+					mAciaClock = strtoul((*it).value.c_str(), NULL, 10);
+					if (0 == mAciaClock) mAciaClock = ACIA_CLOCK;
+				}
+			}
+		} else if (DEVNUM_DMA == devnum) {
+			MemAddrRanges::iterator it = memranges.begin();
+			mDmaAddr = (*it).start_addr;
+			for (DevParams::iterator it = params.begin();
+					 it != params.end();
+					 ++it
+					) {
+				if (0 == (*it).name.compare("cycles")) {
+					mDmaByteCycles = atoi((*it).value.c_str());
+					if (mDmaByteCycles < 0) mDmaByteCycles = 0;
+				}
+			}
 		}
 		// finished device specific post-processing
 	} else {
@@ -398,7 +703,9 @@ void MemMapDev::CharIOFlush()
  *            If character I/O device emulation is enabled, print the
  *            character to the standard output, then flush the I/O
  *            FIFO output buffer to the character device screen
- *            buffer.
+ *            buffer. If output capture is enabled, also append the
+ *            character to the capture buffer and update the byte
+ *            counter and hash.
  * Arguments: c - character
  * Returns:   n/a
  *--------------------------------------------------------------------
@@ -408,6 +715,13 @@ void MemMapDev::PutCharIO(char c)
 	mCharIOBufOut[mOutBufDataEnd] = c;
 	mOutBufDataEnd++;
 	if (mOutBufDataEnd >= CHARIO_BUF_SIZE) mOutBufDataEnd = 0;
+	if (mCharIOCaptActive) {
+		// counter and hash cover all output, even past the size limit
+		mCharIOCaptCount++;
+		mCharIOCaptHash = ((mCharIOCaptHash ^ (unsigned char)c) * FNV1A_PRIME)
+											& 0xFFFFFFFFUL;
+		if (mCharIOCapt.length() < mCharIOCaptMax) mCharIOCapt.push_back(c);
+	}
 	if (mCharIOActive) {
 #if defined(LINUX)
     // because ncurses will remove characters if sequence is
@@ -431,36 +745,45 @@ void MemMapDev::PutCharIO(char c)
 
 /*
  *--------------------------------------------------------------------
- * Method:		CharIODevice_Write()
- * Purpose:		Write value to Char I/O device register.
+ * Method:		CharIOReg_PutCh()
+ * Purpose:		Write value to Char I/O device register (both registers
+ *            output the character).
  * Arguments: addr - address, val - value (character)
  * Returns:   n/a
  *--------------------------------------------------------------------
  */
-void MemMapDev::CharIODevice_Write(int addr, int val)
+void MemMapDev::CharIOReg_PutCh(int addr, int val)
 {
-	if ((unsigned int)addr == mCharIOAddr
-			|| (unsigned int)addr == mCharIOAddr+1) {
-		PutCharIO ((char) val);
-	}
+	PutCharIO ((char) val);
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		CharIODevice_Read()
- * Purpose:		Read value from Char I/O device register.
+ * Method:		CharIOReg_GetCh()
+ * Purpose:		Read value from Char I/O device register, blocking mode.
  * Arguments: addr - address
  * Returns:   value
  *--------------------------------------------------------------------
  */
-int MemMapDev::CharIODevice_Read(int addr)
+int MemMapDev::CharIOReg_GetCh(int addr)
 {
-	int ret = 0;
-	if ((unsigned int)addr == mCharIOAddr) {
-		ret = ReadCharKb(false);	// blocking mode input
-	} else if ((unsigned int)addr == mCharIOAddr+1) {
-		ret = ReadCharKb(true);		// non-blocking mode input
-	}
+	int ret = ReadCharKb(false);
+	mpMem->Poke8bitImg((unsigned short)addr, (unsigned char)ret);
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		CharIOReg_GetChNb()
+ * Purpose:		Read value from Char I/O device register, non-blocking
+ *            mode.
+ * Arguments: addr - address
+ * Returns:   value
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::CharIOReg_GetChNb(int addr)
+{
+	int ret = ReadCharKb(true);
 	mpMem->Poke8bitImg((unsigned short)addr, (unsigned char)ret);
 	return ret;
 }
@@ -554,6 +877,105 @@ void MemMapDev::DeactivateCharIO()
 	mCharIOActive = false;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:    	EnableCharIOCapture()
+ * Purpose:   	Start capturing character I/O output. Previously
+ *              captured data is discarded.
+ * Arguments: 	maxlen - maximum # of bytes kept in capture buffer,
+ *                       0 - use default (CHARIO_CAPT_SIZE)
+ * Returns:   	n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::EnableCharIOCapture(unsigned long maxlen)
+{
+	mCharIOCaptMax = ((0 == maxlen) ? CHARIO_CAPT_SIZE : maxlen);
+	ClearCharIOCapture();
+	mCharIOCaptActive = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    	DisableCharIOCapture()
+ * Purpose:   	Stop capturing character I/O output. Captured data,
+ *              byte counter and hash are preserved.
+ * Arguments: 	n/a
+ * Returns:   	n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DisableCharIOCapture()
+{
+	mCharIOCaptActive = false;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    	ClearCharIOCapture()
+ * Purpose:   	Discard captured output, reset byte counter and hash.
+ * Arguments: 	n/a
+ * Returns:   	n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ClearCharIOCapture()
+{
+	mCharIOCapt.clear();
+	mCharIOCaptCount = 0;
+	mCharIOCaptHash = FNV1A_OFFSET;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    	IsCharIOCaptureActive()
+ * Purpose:   	Return status of character I/O output capture.
+ * Arguments: 	n/a
+ * Returns:   	bool - true if output capture is enabled
+ *--------------------------------------------------------------------
+ */
+bool MemMapDev::IsCharIOCaptureActive()
+{
+	return mCharIOCaptActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    	GetCharIOCapture()
+ * Purpose:   	Return captured character I/O output.
+ * Arguments: 	n/a
+ * Returns:   	string - captured output (up to size limit)
+ *--------------------------------------------------------------------
+ */
+string MemMapDev::GetCharIOCapture()
+{
+	return mCharIOCapt;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    	GetCharIOCaptCount()
+ * Purpose:   	Return # of bytes output since capture was enabled.
+ * Arguments: 	n/a
+ * Returns:   	unsigned long - byte count (may exceed size limit)
+ *--------------------------------------------------------------------
+ */
+unsigned long MemMapDev::GetCharIOCaptCount()
+{
+	return mCharIOCaptCount;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:    	GetCharIOCaptHash()
+ * Purpose:   	Return 32-bit FNV-1a hash of all bytes output since
+ *              capture was enabled.
+ * Arguments: 	n/a
+ * Returns:   	unsigned long - hash value
+ *--------------------------------------------------------------------
+ */
+unsigned long MemMapDev::GetCharIOCaptHash()
+{
+	return mCharIOCaptHash;
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		GetGraphDispAddrBase()
@@ -569,166 +991,245 @@ unsigned short MemMapDev::GetGraphDispAddrBase()
 
 /*
  *--------------------------------------------------------------------
- * Method:		GraphDispDevice_Read()
- * Purpose:		Read from specified graphics display device register.
- * Arguments:	int - address of the register in memory.
- * Returns:		int - read value.
+ * Method:		GraphDispReg_Latch()
+ * Purpose:		Write a value to graphics display device register that
+ *            only holds the value for commands (coordinates, colors).
+ * Arguments:	addr - address of the register in memory
+ *						val - value to write
+ * Returns:		n/a
  *--------------------------------------------------------------------
- */
-int MemMapDev::GraphDispDevice_Read(int addr)
+ */	
+void MemMapDev::GraphDispReg_Latch(int addr, int val)
 {
-	// this device has no read registers, return 0
-	GraphDisp_ReadEvents();
-	GraphDisp_Update();
-	return 0;
+	*mGrDevRegPtr[addr - mGraphDispAddr] = (unsigned char)val;
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		GraphDispDevice_Write()
- * Purpose:		Write a value to specified graphics display device
- *						register.
+ * Method:		GraphDispReg_Cmd()
+ * Purpose:		Execute graphics display device command.
  * Arguments:	addr - address of the register in memory
- *						val - value to write
+ *						val - command code
  * Returns:		n/a
  *--------------------------------------------------------------------
  */	
-void MemMapDev::GraphDispDevice_Write(int addr, int val)
-{
-	if (NULL != mpGraphDisp) {	// only if device is active
-		if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_X) {
-			// setup X coordinate of the pixel or beginning of line,
-			// less significant part
-			mGrDevRegs.mGraphDispLoX = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_X + 1) {
-			// setup X coordinate of the pixel, more significant part
-			mGrDevRegs.mGraphDispHiX = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_Y) {
-			// setup Y coordinate of the pixel
-			mGrDevRegs.mGraphDispY = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_PXCOL_R) {
-			// setup pixel RGB color Red component
-			mGrDevRegs.mGraphDispPixColR = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_PXCOL_G) {
-			// setup pixel RGB color Green component
-			mGrDevRegs.mGraphDispPixColG = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_PXCOL_B) {
-			// setup pixel RGB color Blue component
-			mGrDevRegs.mGraphDispPixColB = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_BGCOL_R) {
-			// setup background RGB color Red component
-			mGrDevRegs.mGraphDispBgColR = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_BGCOL_G) {
-			// setup background RGB color Green component
-			mGrDevRegs.mGraphDispBgColG = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_BGCOL_B) {
-			// setup background RGB color Blue component
-			mGrDevRegs.mGraphDispBgColB = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_X2) {
-			// setup X coordinate of the end of line, less significant part
-			mGrDevRegs.mGraphDispLoX2 = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_X2 + 1) {
-			// setup X coordinate of the end of line, more significant part
-			mGrDevRegs.mGraphDispHiX2 = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_Y2) {
-			// setup Y coordinate of the end of line
-			mGrDevRegs.mGraphDispY2 = (unsigned char)val;
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_CHRTBL) {
-			// set new address of the character table, 2 kB bank #0-31
-			mGrDevRegs.mGraphDispChrTbl = (unsigned char)(val & 0x003F);
-			mCharTblAddr = mGrDevRegs.mGraphDispChrTbl * ((MAX_8BIT_ADDR+1) / 0x20);
-			unsigned char char_rom[CHROM_8x8_SIZE];
-			for (unsigned int i=0; i<CHROM_8x8_SIZE; i++) {
-				char_rom[i] = mpMem->Peek8bitImg((unsigned short)((mCharTblAddr + i) & 0xFFFF));
-			}
-			mpGraphDisp->CopyCharRom8x8(char_rom);
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_TXTCURX) {
-			if (val <= TXTCRSR_MAXCOL)
-				mGrDevRegs.mGraphDispTxtCurX = (unsigned char) (val & 0x007F);
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_TXTCURY) {
-			if (val <= TXTCRSR_MAXROW)
-				mGrDevRegs.mGraphDispTxtCurY = (unsigned char) (val & 0x001F);
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_CRSMODE) {
-			if (val < GRAPHDEVCRSMODE_END)
-				mGrDevRegs.mGraphDispCrsMode = (unsigned char) (val & 0x000F);
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_TXTMODE) {
-			if (val < GRAPHDEVTXTMODE_END)
-				mGrDevRegs.mGraphDispTxtMode = (unsigned char) (val & 0x000F);			
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_PUTC) {
-			if (val <= 0xFF) {
-				mpGraphDisp->PrintChar8x8(val, 
-																	mGrDevRegs.mGraphDispTxtCurX,
-																	mGrDevRegs.mGraphDispTxtCurY,
-																	(mGrDevRegs.mGraphDispTxtMode == GRAPHDEVTXTMODE_REVERSE));
-				/***
-				unsigned int n = val * 8;
-				int x = mGrDevRegs.mGraphDispTxtCurX * 8;
-				int y = mGrDevRegs.mGraphDispTxtCurY * 8;				
-				unsigned char chdef[8];
-				for (int i=0; i<8; i++, n++) {
-					chdef[i] = mpMem->Peek8bitImg((unsigned short)((mCharTblAddr + n) & 0xFFFF));
-				}
-				mpGraphDisp->RenderChar8x8(chdef, x, y, (mGrDevRegs.mGraphDispTxtMode == GRAPHDEVTXTMODE_REVERSE));
-				***/
-			}
-		} else if ((unsigned int)addr == mGraphDispAddr + GRAPHDEVREG_CMD) {
-			// execute command
-			switch (val) {
-				
-				case GRAPHDEVCMD_CLRSCR:
-					mpGraphDisp->ClearScreen();
-					break;
-
-				case GRAPHDEVCMD_SETPXL:
-					mpGraphDisp->SetPixel(mGrDevRegs.mGraphDispLoX 
-																	+ 256 * mGrDevRegs.mGraphDispHiX,
-																mGrDevRegs.mGraphDispY);
-					break;
-
-				case GRAPHDEVCMD_CLRPXL:
-					mpGraphDisp->ErasePixel(mGrDevRegs.mGraphDispLoX
-																		+ 256 * mGrDevRegs.mGraphDispHiX,
-																	mGrDevRegs.mGraphDispY);
-					break;
-
-				case GRAPHDEVCMD_SETBGC:
-					mpGraphDisp->SetBgColor(mGrDevRegs.mGraphDispBgColR,
-																	mGrDevRegs.mGraphDispBgColG,
-																	mGrDevRegs.mGraphDispBgColB);				
-					break;
-
-				case GRAPHDEVCMD_SETFGC:
-					mpGraphDisp->SetFgColor(mGrDevRegs.mGraphDispPixColR,
-																	mGrDevRegs.mGraphDispPixColG,
-																	mGrDevRegs.mGraphDispPixColB);				
-					break;					
-
-				case GRAPHDEVCMD_DRAWLN:
-					mpGraphDisp->DrawLine(mGrDevRegs.mGraphDispLoX 
-																		+ 256 * mGrDevRegs.mGraphDispHiX,
-																mGrDevRegs.mGraphDispY,
-																mGrDevRegs.mGraphDispLoX2
-																		+ 256 * mGrDevRegs.mGraphDispHiX2,
-																mGrDevRegs.mGraphDispY2);
-					break;
-
-				case GRAPHDEVCMD_ERASLN:
-					mpGraphDisp->EraseLine(mGrDevRegs.mGraphDispLoX 
-																		+ 256 * mGrDevRegs.mGraphDispHiX,
-																 mGrDevRegs.mGraphDispY,
-																 mGrDevRegs.mGraphDispLoX2
-																		+ 256 * mGrDevRegs.mGraphDispHiX2,
-																 mGrDevRegs.mGraphDispY2);
-					break;					
-
-				default:
-					break;
+void MemMapDev::GraphDispReg_Cmd(int addr, int val)
+{
+	if (NULL == mpGraphDisp) return;	// only if device is active
+	switch (val) {
+		
+		case GRAPHDEVCMD_CLRSCR:
+			mpGraphDisp->ClearScreen();
+			break;
 
-			}
-		}
-		GraphDisp_ReadEvents();
-		GraphDisp_Update();
-	}	// if (NULL != mpGraphDisp)
+		case GRAPHDEVCMD_SETPXL:
+			mpGraphDisp->SetPixel(mGrDevRegs.mGraphDispLoX 
+															+ 256 * mGrDevRegs.mGraphDispHiX,
+														mGrDevRegs.mGraphDispY);
+			break;
+
+		case GRAPHDEVCMD_CLRPXL:
+			mpGraphDisp->ErasePixel(mGrDevRegs.mGraphDispLoX
+																+ 256 * mGrDevRegs.mGraphDispHiX,
+															mGrDevRegs.mGraphDispY);
+			break;
+
+		case GRAPHDEVCMD_SETBGC:
+			mpGraphDisp->SetBgColor(mGrDevRegs.mGraphDispBgColR,
+															mGrDevRegs.mGraphDispBgColG,
+															mGrDevRegs.mGraphDispBgColB);				
+			break;
+
+		case GRAPHDEVCMD_SETFGC:
+			mpGraphDisp->SetFgColor(mGrDevRegs.mGraphDispPixColR,
+															mGrDevRegs.mGraphDispPixColG,
+															mGrDevRegs.mGraphDispPixColB);				
+			break;					
+
+		case GRAPHDEVCMD_DRAWLN:
+			mpGraphDisp->DrawLine(mGrDevRegs.mGraphDispLoX 
+																+ 256 * mGrDevRegs.mGraphDispHiX,
+														mGrDevRegs.mGraphDispY,
+														mGrDevRegs.mGraphDispLoX2
+																+ 256 * mGrDevRegs.mGraphDispHiX2,
+														mGrDevRegs.mGraphDispY2);
+			break;
+
+		case GRAPHDEVCMD_ERASLN:
+			mpGraphDisp->EraseLine(mGrDevRegs.mGraphDispLoX 
+																+ 256 * mGrDevRegs.mGraphDispHiX,
+														 mGrDevRegs.mGraphDispY,
+														 mGrDevRegs.mGraphDispLoX2
+																+ 256 * mGrDevRegs.mGraphDispHiX2,
+														 mGrDevRegs.mGraphDispY2);
+			break;					
+
+		case GRAPHDEVCMD_FILLRC:
+			mpGraphDisp->FillRect(mGrDevRegs.mGraphDispLoX 
+																+ 256 * mGrDevRegs.mGraphDispHiX,
+														mGrDevRegs.mGraphDispY,
+														mGrDevRegs.mGraphDispLoX2
+																+ 256 * mGrDevRegs.mGraphDispHiX2,
+														mGrDevRegs.mGraphDispY2);
+			break;
+
+		case GRAPHDEVCMD_ERASRC:
+			mpGraphDisp->EraseRect(mGrDevRegs.mGraphDispLoX 
+																+ 256 * mGrDevRegs.mGraphDispHiX,
+														 mGrDevRegs.mGraphDispY,
+														 mGrDevRegs.mGraphDispLoX2
+																+ 256 * mGrDevRegs.mGraphDispHiX2,
+														 mGrDevRegs.mGraphDispY2);
+			break;
+
+		case GRAPHDEVCMD_HSPAN:
+			mpGraphDisp->DrawHSpan(mGrDevRegs.mGraphDispLoX 
+																+ 256 * mGrDevRegs.mGraphDispHiX,
+														 mGrDevRegs.mGraphDispLoX2
+																+ 256 * mGrDevRegs.mGraphDispHiX2,
+														 mGrDevRegs.mGraphDispY);
+			break;
+
+		default:
+			break;
+
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_ChrTbl()
+ * Purpose:		Set new address of the character table, 2 kB bank #0-31.
+ * Arguments:	addr - address of the register in memory
+ *						val - bank #
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_ChrTbl(int addr, int val)
+{
+	if (NULL == mpGraphDisp) return;
+	mGrDevRegs.mGraphDispChrTbl = (unsigned char)(val & 0x003F);
+	mCharTblAddr = mGrDevRegs.mGraphDispChrTbl * ((MAX_8BIT_ADDR+1) / 0x20);
+	unsigned char char_rom[CHROM_8x8_SIZE];
+	for (unsigned int i=0; i<CHROM_8x8_SIZE; i++) {
+		char_rom[i] = mpMem->Peek8bitImg((unsigned short)((mCharTblAddr + i) & 0xFFFF));
+	}
+	mpGraphDisp->CopyCharRom8x8(char_rom);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_TxtCurX()
+ * Purpose:		Set text cursor position (column).
+ * Arguments:	addr - address of the register in memory
+ *						val - column
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_TxtCurX(int addr, int val)
+{
+	if (val <= TXTCRSR_MAXCOL)
+		mGrDevRegs.mGraphDispTxtCurX = (unsigned char) (val & 0x007F);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_TxtCurY()
+ * Purpose:		Set text cursor position (row).
+ * Arguments:	addr - address of the register in memory
+ *						val - row
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_TxtCurY(int addr, int val)
+{
+	if (val <= TXTCRSR_MAXROW)
+		mGrDevRegs.mGraphDispTxtCurY = (unsigned char) (val & 0x001F);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_PutC()
+ * Purpose:		Output character at the text cursor position.
+ * Arguments:	addr - address of the register in memory
+ *						val - character code
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_PutC(int addr, int val)
+{
+	if (NULL != mpGraphDisp && val <= 0xFF) {
+		mpGraphDisp->PrintChar8x8(val, 
+															mGrDevRegs.mGraphDispTxtCurX,
+															mGrDevRegs.mGraphDispTxtCurY,
+															(mGrDevRegs.mGraphDispTxtMode == GRAPHDEVTXTMODE_REVERSE));
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_CrsMode()
+ * Purpose:		Set cursor mode.
+ * Arguments:	addr - address of the register in memory
+ *						val - mode
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_CrsMode(int addr, int val)
+{
+	if (val < GRAPHDEVCRSMODE_END)
+		mGrDevRegs.mGraphDispCrsMode = (unsigned char) (val & 0x000F);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_TxtMode()
+ * Purpose:		Set text mode.
+ * Arguments:	addr - address of the register in memory
+ *						val - mode
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_TxtMode(int addr, int val)
+{
+	if (val < GRAPHDEVTXTMODE_END)
+		mGrDevRegs.mGraphDispTxtMode = (unsigned char) (val & 0x000F);			
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_BmpAddr()
+ * Purpose:		Set memory page where bitmap begins.
+ * Arguments:	addr - address of the register in memory
+ *						val - memory page
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_BmpAddr(int addr, int val)
+{
+	if (NULL == mpGraphDisp) return;
+	mGrDevRegs.mGraphDispBmpAddr = (unsigned char) val;
+	if (GRAPHDEVBMP_OFF != mGrDevRegs.mGraphDispBmpMode) {
+		mpMem->EnableDirtyTrack();	// new address, show whole bitmap
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDispReg_BmpMode()
+ * Purpose:		Set bitmap mode.
+ * Arguments:	addr - address of the register in memory
+ *						val - mode
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */	
+void MemMapDev::GraphDispReg_BmpMode(int addr, int val)
+{
+	if (NULL != mpGraphDisp && val < GRAPHDEVBMP_END) {
+		mGrDevRegs.mGraphDispBmpMode = (unsigned char) val;
+		if (GRAPHDEVBMP_OFF == val) mpMem->DisableDirtyTrack();
+		else mpMem->EnableDirtyTrack();
+	}
 }
 
 /*
@@ -742,7 +1243,7 @@ void MemMapDev::GraphDispDevice_Write(int addr, int val)
 void MemMapDev::ActivateGraphDisp()
 {
 	if (NULL == mpGraphDisp) {
-		mpGraphDisp = new GraphDisp();
+		mpGraphDisp = new GraphDisp(mGraphDispBackend);
 		if (NULL == mpGraphDisp)
 			throw MKGenException("Out of memory while initializing Graphics Display Device");
 		mGrDevRegs.mGraphDispBgColR = 0;
@@ -751,13 +1252,20 @@ void MemMapDev::ActivateGraphDisp()
 		mGrDevRegs.mGraphDispPixColR = 0xFF;
 		mGrDevRegs.mGraphDispPixColG = 0xFF;
 		mGrDevRegs.mGraphDispPixColB = 0xFF;
+		mGrDevRegs.mGraphDispBmpAddr = 0;
+		mGrDevRegs.mGraphDispBmpMode = GRAPHDEVBMP_OFF;
+		mBmpLastScan = high_resolution_clock::now();
 		mpGraphDisp->SetBgColor(mGrDevRegs.mGraphDispBgColR,
 														mGrDevRegs.mGraphDispBgColG,
 														mGrDevRegs.mGraphDispBgColB);
 		mpGraphDisp->SetFgColor(mGrDevRegs.mGraphDispPixColR,
 														mGrDevRegs.mGraphDispPixColG,
 														mGrDevRegs.mGraphDispPixColB);
-		GraphDisp_Update();
+		mpGraphDisp->SetFrameRate(mGraphDispFps);
+		if (mGraphDispDumpPrefix.length() > 0)
+			mpGraphDisp->SetFrameDump(mGraphDispDumpPrefix);
+		// render in separate thread, device writes only queue commands
+		mpGraphDisp->Start(mpGraphDisp);
 	}
 }
 
@@ -771,6 +1279,7 @@ void MemMapDev::ActivateGraphDisp()
  */
 void MemMapDev::DeactivateGraphDisp()
 {
+	mpMem->DisableDirtyTrack();
 #if defined(DBG)
 	if (false == mpGraphDisp->IsMainLoopActive()) {
 		cout << "DBG: ERROR: Main Loop is already inactive in Graphics Display." << endl;
@@ -806,4 +1315,1747 @@ void MemMapDev::GraphDisp_Update()
 	if (NULL != mpGraphDisp) mpGraphDisp->Update();
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp_Refresh()
+ * Purpose:		Present pending graphics display changes immediately.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::GraphDisp_Refresh()
+{
+	if (NULL != mpGraphDisp) mpGraphDisp->Refresh();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp_GetPixelCount()
+ * Purpose:		Return # of pixels drawn by graphics display device.
+ * Arguments:	n/a
+ * Returns:		unsigned long - pixel count, 0 if device not active
+ *--------------------------------------------------------------------
+ */
+unsigned long MemMapDev::GraphDisp_GetPixelCount()
+{
+	return ((NULL != mpGraphDisp) ? mpGraphDisp->GetPixelCount() : 0);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp_GetCloseEvent()
+ * Purpose:		Check if graphics display window was closed by user
+ *            since last call.
+ * Arguments:	n/a
+ * Returns:		bool - true if window was closed
+ *--------------------------------------------------------------------
+ */
+bool MemMapDev::GraphDisp_GetCloseEvent()
+{
+	return ((NULL != mpGraphDisp) ? mpGraphDisp->GetCloseEvent() : false);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp_ScanBitmap()
+ * Purpose:		In bitmap mode, send the bitmap blocks written to since
+ *            last scan to the graphics display. Scan is done once
+ *            per frame unless forced.
+ * Arguments:	force - scan regardless of the frame rate
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::GraphDisp_ScanBitmap(bool force)
+{
+	if (NULL == mpGraphDisp
+			|| GRAPHDEVBMP_OFF == mGrDevRegs.mGraphDispBmpMode) return;
+	auto now = high_resolution_clock::now();
+	if (!force && duration_cast<microseconds>(now-mBmpLastScan).count()
+									< 1000000 / mGraphDispFps) return;
+	mBmpLastScan = now;
+	const int blklen = (1 << MEM_DIRTY_SHIFT);
+	unsigned int addr = mGrDevRegs.mGraphDispBmpAddr * MEM_PAGE_SIZE;
+	unsigned char bits[blklen];
+	// rows are multiple of the dirty tracking block, each block is
+	// 8 * blklen pixels of the same row
+	for (int y=0; y < GRDISP_VR_Y; y++) {
+		for (int x=0; x < GRDISP_VR_X; x += 8 * blklen, addr += blklen) {
+			if (mpMem->TestAndClearDirty((unsigned short)(addr & 0xFFFF))) {
+				for (int i=0; i<blklen; i++) {
+					bits[i] = mpMem->Peek8bitImg((unsigned short)((addr + i) & 0xFFFF));
+				}
+				for (int i=0; i<blklen; i += 4) {
+					mpGraphDisp->DrawBitmap32(x + i * 8, y, bits + i, 4);
+				}
+			}
+		}
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetGraphDispBackend()
+ * Purpose:		Select backend of graphics display device.
+ *            Takes effect when device is activated.
+ * Arguments:	backend - GRDISP_BACKEND_SDL or GRDISP_BACKEND_OFFSCREEN
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::SetGraphDispBackend(int backend)
+{
+	mGraphDispBackend = backend;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp_SaveImage()
+ * Purpose:		Save graphics display contents to PPM file.
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, -1 if error or device not active
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::GraphDisp_SaveImage(string fname)
+{
+	return ((NULL != mpGraphDisp) ? mpGraphDisp->SaveImage(fname) : -1);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GraphDisp_SetFrameDump()
+ * Purpose:		Set file name prefix for dumping each presented frame.
+ * Arguments:	prefix - file name prefix, empty string disables dump
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::GraphDisp_SetFrameDump(string prefix)
+{
+	mGraphDispDumpPrefix = prefix;
+	if (NULL != mpGraphDisp) mpGraphDisp->SetFrameDump(prefix);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDmaAddrBase()
+ * Purpose:		Return base address of DMA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::GetDmaAddrBase()
+{
+	return mDmaAddr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DmaReg_Latch()
+ * Purpose:		Write a value to DMA device parameter register.
+ *            Registers read back as written (memory image).
+ * Arguments:	addr - address of the register in memory
+ *						val - value to write
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DmaReg_Latch(int addr, int val)
+{
+	mDmaRegs[addr - mDmaAddr] = (unsigned char) val;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DmaSaveState()
+ * Purpose:		Get DMA device state for memory snapshot.
+ *            Format: registers, cycles per byte (lo, hi).
+ * Arguments:	n/a
+ * Returns:		vector<unsigned char> - DMA_STATE_LEN bytes
+ *--------------------------------------------------------------------
+ */
+vector<unsigned char> MemMapDev::DmaSaveState()
+{
+	vector<unsigned char> state(mDmaRegs, mDmaRegs + DMADEVREG_END);
+	int cycles = (mDmaByteCycles > 0xFFFF) ? 0xFFFF : mDmaByteCycles;
+	state.push_back(cycles & 0xFF);
+	state.push_back((cycles >> 8) & 0xFF);
+	return state;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DmaRestoreState()
+ * Purpose:		Restore DMA device state saved by DmaSaveState().
+ * Arguments:	state - DMA_STATE_LEN bytes, ignored if shorter
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DmaRestoreState(vector<unsigned char> state)
+{
+	if (state.size() < DMA_STATE_LEN) return;
+	memcpy(mDmaRegs, &state[0], DMADEVREG_END);
+	mDmaByteCycles = state[DMADEVREG_END] + 256 * state[DMADEVREG_END + 1];
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DmaReg_Cmd()
+ * Purpose:		Execute DMA device command.
+ *            The transfer is performed at once in native code and
+ *            the CPU is stalled for the number of cycles the transfer
+ *            would take.
+ * Arguments:	addr - address of the register in memory
+ *						val - command code
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DmaReg_Cmd(int addr, int val)
+{
+	mDmaRegs[DMADEVREG_CMD] = (unsigned char) val;
+	unsigned short src = mDmaRegs[DMADEVREG_SRC]
+											 + 256 * mDmaRegs[DMADEVREG_SRC + 1];
+	unsigned short dst = mDmaRegs[DMADEVREG_DST]
+											 + 256 * mDmaRegs[DMADEVREG_DST + 1];
+	unsigned int len = mDmaRegs[DMADEVREG_LEN]
+										 + 256 * mDmaRegs[DMADEVREG_LEN + 1];
+	switch (val) {
+		case DMADEVCMD_COPY:
+			mpMem->CopyBlock(dst, src, len);
+			break;
+		case DMADEVCMD_FILL:
+			mpMem->FillBlock(dst, mDmaRegs[DMADEVREG_VAL], len);
+			break;
+		case DMADEVCMD_BLIT:
+			if (NULL == mpGraphDisp) return;
+			DmaBlit(src, dst, len);
+			break;
+		default:
+			return;
+	}
+	mpMem->AddStallCycles(len * mDmaByteCycles);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DmaBlit()
+ * Purpose:		Draw 1bpp bitmap data from memory on graphics display.
+ *            Destination is a byte offset in 1bpp screen bitmap
+ *            (GRAPHDEVBMP_ROWLEN bytes per row, bit 7 is the leftmost
+ *            pixel), the same layout as in the bitmap mode.
+ * Arguments:	src - source address
+ *            offs - destination byte offset
+ *            len - # of bytes
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DmaBlit(unsigned short src, unsigned int offs, unsigned int len)
+{
+	unsigned char bits[4];
+	const unsigned int scrlen = GRAPHDEVBMP_ROWLEN * GRDISP_VR_Y;
+	while (len > 0 && offs < scrlen) {
+		// up to 4 bytes, not crossing the end of row
+		unsigned int n = GRAPHDEVBMP_ROWLEN - offs % GRAPHDEVBMP_ROWLEN;
+		if (n > 4) n = 4;
+		if (n > len) n = len;
+		for (unsigned int i=0; i<4; i++) {
+			bits[i] = (i < n) ? mpMem->Peek8bitImg((unsigned short)(src + i)) : 0;
+		}
+		mpGraphDisp->DrawBitmap32((offs % GRAPHDEVBMP_ROWLEN) * 8,
+															offs / GRAPHDEVBMP_ROWLEN, bits, n);
+		src += n;
+		offs += n;
+		len -= n;
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetViaAddrBase()
+ * Purpose:		Return base address of VIA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::GetViaAddrBase()
+{
+	return mViaAddr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaReset()
+ * Purpose:		Bring VIA device to power-up state: timers stopped,
+ *            interrupts disabled, ports are inputs.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaReset()
+{
+	if (NULL != mpMem) {
+		EventSched *psched = mpMem->GetEventSched();
+		if (0 != mViaRegs.t1evt) psched->Cancel(mViaRegs.t1evt);
+		if (0 != mViaRegs.t2evt) psched->Cancel(mViaRegs.t2evt);
+		if (0 != mViaRegs.srevt) psched->Cancel(mViaRegs.srevt);
+	}
+	mViaRegs.orb = mViaRegs.ora = 0;
+	mViaRegs.ddrb = mViaRegs.ddra = 0;
+	mViaRegs.sr = mViaRegs.acr = mViaRegs.pcr = 0;
+	mViaRegs.ifr = mViaRegs.ier = 0;
+	mViaRegs.t1latch = mViaRegs.t1start = 0xFFFF;
+	mViaRegs.t1base = 0;
+	mViaRegs.t1irq = false;
+	mViaRegs.pb7 = true;
+	mViaRegs.t2latchlo = 0xFF;
+	mViaRegs.t2start = 0xFFFF;
+	mViaRegs.t2base = 0;
+	mViaRegs.t2irq = false;
+	mViaRegs.t1evt = mViaRegs.t2evt = mViaRegs.srevt = 0;
+	ViaUpdateIrq();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaSaveState()
+ * Purpose:		Get VIA device state for memory snapshot.
+ *            Format: ORB, ORA, DDRB, DDRA, SR, ACR, PCR, IFR, IER,
+ *            T1 latch (lo, hi), T1 counter (lo, hi), T1 reload delay,
+ *            T1 armed, PB7, T2 latch lo, T2 counter (lo, hi),
+ *            T2 armed, cycles until T1, T2 and SR events are due
+ *            (4 bytes each, LSB first, 0 - not scheduled).
+ *            Timers are saved relative to current cycle, so they
+ *            continue from the same point in restored session.
+ * Arguments:	n/a
+ * Returns:		vector<unsigned char> - VIA_STATE_LEN bytes
+ *--------------------------------------------------------------------
+ */
+vector<unsigned char> MemMapDev::ViaSaveState()
+{
+	vector<unsigned char> state;
+	EventSched *psched = mpMem->GetEventSched();
+	unsigned long long now = psched->GetCycles();
+	unsigned short t1cnt = mViaRegs.t1start;
+	int t1delay = 0;
+	if (mViaRegs.t1base > now) {
+		t1delay = (int)(mViaRegs.t1base - now);
+	} else {
+		t1cnt = ViaT1Counter();
+	}
+	unsigned short t2cnt = ViaT2Counter();
+	state.push_back(mViaRegs.orb);
+	state.push_back(mViaRegs.ora);
+	state.push_back(mViaRegs.ddrb);
+	state.push_back(mViaRegs.ddra);
+	state.push_back(mViaRegs.sr);
+	state.push_back(mViaRegs.acr);
+	state.push_back(mViaRegs.pcr);
+	state.push_back(mViaRegs.ifr);
+	state.push_back(mViaRegs.ier);
+	state.push_back(mViaRegs.t1latch & 0xFF);
+	state.push_back((mViaRegs.t1latch >> 8) & 0xFF);
+	state.push_back(t1cnt & 0xFF);
+	state.push_back((t1cnt >> 8) & 0xFF);
+	state.push_back((unsigned char) t1delay);
+	state.push_back(mViaRegs.t1irq ? 1 : 0);
+	state.push_back(mViaRegs.pb7 ? 1 : 0);
+	state.push_back(mViaRegs.t2latchlo);
+	state.push_back(t2cnt & 0xFF);
+	state.push_back((t2cnt >> 8) & 0xFF);
+	state.push_back(mViaRegs.t2irq ? 1 : 0);
+	PushDueIn(state, mViaRegs.t1evt);
+	PushDueIn(state, mViaRegs.t2evt);
+	PushDueIn(state, mViaRegs.srevt);
+	return state;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaRestoreState()
+ * Purpose:		Restore VIA device state saved by ViaSaveState().
+ *            Pending timer and shift register events are scheduled
+ *            again relative to current cycle.
+ * Arguments:	state - VIA_STATE_LEN bytes, ignored if shorter
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaRestoreState(vector<unsigned char> state)
+{
+	if (state.size() < VIA_STATE_LEN) return;
+	EventSched *psched = mpMem->GetEventSched();
+	if (0 != mViaRegs.t1evt) psched->Cancel(mViaRegs.t1evt);
+	if (0 != mViaRegs.t2evt) psched->Cancel(mViaRegs.t2evt);
+	if (0 != mViaRegs.srevt) psched->Cancel(mViaRegs.srevt);
+	unsigned long long now = psched->GetCycles();
+	mViaRegs.orb = state[0];
+	mViaRegs.ora = state[1];
+	mViaRegs.ddrb = state[2];
+	mViaRegs.ddra = state[3];
+	mViaRegs.sr = state[4];
+	mViaRegs.acr = state[5];
+	mViaRegs.pcr = state[6];
+	mViaRegs.ifr = state[7];
+	mViaRegs.ier = state[8];
+	mViaRegs.t1latch = state[9] + 256 * state[10];
+	mViaRegs.t1start = state[11] + 256 * state[12];
+	mViaRegs.t1base = now + state[13];
+	mViaRegs.t1irq = (0 != state[14]);
+	mViaRegs.pb7 = (0 != state[15]);
+	mViaRegs.t2latchlo = state[16];
+	mViaRegs.t2start = state[17] + 256 * state[18];
+	mViaRegs.t2base = now;
+	mViaRegs.t2irq = (0 != state[19]);
+	unsigned long evts[3];
+	int evtids[3] = {MMDEVEVT_VIA_T1, MMDEVEVT_VIA_T2, MMDEVEVT_VIA_SR};
+	for (int i = 0; i < 3; i++) {
+		unsigned long duein = GetDueIn(state, 20 + 4 * i);
+		evts[i] = (duein > 0) ? psched->Schedule(duein, this, evtids[i]) : 0;
+	}
+	mViaRegs.t1evt = evts[0];
+	mViaRegs.t2evt = evts[1];
+	mViaRegs.srevt = evts[2];
+	ViaUpdateIrq();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PushDueIn()
+ * Purpose:		Append to device state number of cycles until event
+ *            is due (4 bytes, LSB first, 0 - not scheduled).
+ * Arguments:	state - device state
+ *            evt - event handle, 0 - none
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::PushDueIn(vector<unsigned char> &state, unsigned long evt)
+{
+	unsigned long duein = 0;
+	if (0 != evt) {
+		EventSched *psched = mpMem->GetEventSched();
+		unsigned long long now = psched->GetCycles();
+		unsigned long long due = psched->GetDueCycle(evt);
+		if (EVTSCHED_NEVER != due && due > now)
+			duein = (unsigned long)(due - now);
+		else if (EVTSCHED_NEVER != due)
+			duein = 1;
+	}
+	for (int j = 0; j < 4; j++) {
+		state.push_back((duein >> (8 * j)) & 0xFF);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDueIn()
+ * Purpose:		Get number of cycles until event is due saved by
+ *            PushDueIn().
+ * Arguments:	state - device state
+ *            offs - offset of the value in state
+ * Returns:		unsigned long - # of cycles, 0 - not scheduled
+ *--------------------------------------------------------------------
+ */
+unsigned long MemMapDev::GetDueIn(vector<unsigned char> &state, int offs)
+{
+	unsigned long duein = 0;
+	for (int j = 0; j < 4; j++) {
+		duein |= (unsigned long) state[offs + j] << (8 * j);
+	}
+	return duein;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaSetFlags()
+ * Purpose:		Set VIA interrupt flags. Request CPU interrupt when
+ *            an enabled flag is set.
+ * Arguments:	flags - interrupt flags (ViaDevIrqFlags)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaSetFlags(unsigned char flags)
+{
+	mViaRegs.ifr |= (flags & 0x7F);
+	ViaUpdateIrq();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaUpdateIrq()
+ * Purpose:		Drive VIA IRQ line: asserted while any enabled flag
+ *            is set.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaUpdateIrq()
+{
+	mpMem->GetIntCtrl()->SetLine(INTSRC_VIA,
+															 0 != (mViaRegs.ifr & mViaRegs.ier & 0x7F));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaT1Counter()
+ * Purpose:		Compute current value of VIA timer 1 counter.
+ *            Counter is not decremented each cycle, its value is
+ *            derived from the cycle it was loaded at.
+ * Arguments:	n/a
+ * Returns:		unsigned short - counter value
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::ViaT1Counter()
+{
+	unsigned long long now = mpMem->GetEventSched()->GetCycles();
+	// 1 cycle after time-out counter reads $FFFF, then latch is reloaded
+	if (now < mViaRegs.t1base) return 0xFFFF;
+	return (unsigned short)(mViaRegs.t1start - (now - mViaRegs.t1base));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaT2Counter()
+ * Purpose:		Compute current value of VIA timer 2 counter.
+ *            Pulse counting mode is not emulated (PB6 is not
+ *            connected), counter holds its value.
+ * Arguments:	n/a
+ * Returns:		unsigned short - counter value
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::ViaT2Counter()
+{
+	if (mViaRegs.acr & VIAACR_T2PULSE) return mViaRegs.t2start;
+	unsigned long long now = mpMem->GetEventSched()->GetCycles();
+	return (unsigned short)(mViaRegs.t2start - (now - mViaRegs.t2base));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaStartT1()
+ * Purpose:		Load VIA timer 1 counter and schedule its time-out
+ *            (count + 1 cycles from now).
+ * Arguments:	count - counter value
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaStartT1(unsigned short count)
+{
+	EventSched *psched = mpMem->GetEventSched();
+	if (0 != mViaRegs.t1evt) psched->Cancel(mViaRegs.t1evt);
+	mViaRegs.t1start = count;
+	mViaRegs.t1base = psched->GetCycles();
+	mViaRegs.t1evt = psched->Schedule((unsigned long)count + 1, this,
+																		MMDEVEVT_VIA_T1);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaT1Timeout()
+ * Purpose:		Handle VIA timer 1 time-out event.
+ *            One-shot mode: set the flag once, counter keeps counting
+ *            down. Free-run mode: set the flag, toggle PB7, reload
+ *            counter from latch (time-out every latch + 2 cycles).
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaT1Timeout()
+{
+	EventSched *psched = mpMem->GetEventSched();
+	mViaRegs.t1evt = 0;
+	if (mViaRegs.acr & VIAACR_T1FREE) {
+		mViaRegs.pb7 = !mViaRegs.pb7;
+		mViaRegs.t1start = mViaRegs.t1latch;
+		mViaRegs.t1base = psched->GetCycles() + 1;
+		mViaRegs.t1evt = psched->Schedule((unsigned long)mViaRegs.t1latch + 2,
+																			this, MMDEVEVT_VIA_T1);
+		ViaSetFlags(VIAIRQ_T1);
+	} else if (mViaRegs.t1irq) {
+		mViaRegs.t1irq = false;
+		mViaRegs.pb7 = true;
+		ViaSetFlags(VIAIRQ_T1);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaStartShift()
+ * Purpose:		Start shifting 8 bits in / out of VIA shift register
+ *            in the mode selected in ACR. Flag is set after 8 bits
+ *            (16 cycles with system clock, 16 * (T2 latch low + 2)
+ *            with T2 clock). External clock (CB1) is not connected,
+ *            free-running output never sets the flag.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaStartShift()
+{
+	EventSched *psched = mpMem->GetEventSched();
+	unsigned long cycles = 0;
+	if (0 != mViaRegs.srevt) psched->Cancel(mViaRegs.srevt);
+	mViaRegs.srevt = 0;
+	mViaRegs.ifr &= ~VIAIRQ_SR;
+	switch ((mViaRegs.acr & VIAACR_SRMODE) >> 2) {
+		case 1:		// in, T2 clock
+		case 5:		// out, T2 clock
+			cycles = 16 * ((unsigned long)mViaRegs.t2latchlo + 2);
+			break;
+		case 2:		// in, system clock
+		case 6:		// out, system clock
+			cycles = 16;
+			break;
+		default:	// disabled, free-run, external clock
+			return;
+	}
+	mViaRegs.srevt = psched->Schedule(cycles, this, MMDEVEVT_VIA_SR);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaReg_Read()
+ * Purpose:		Read VIA device register.
+ *            Port pins are not connected (read as 1 when set as
+ *            input), CA1, CA2, CB1, CB2 never raise their flags.
+ * Arguments:	addr - address of the register in memory
+ * Returns:		int - register value (also placed in memory)
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::ViaReg_Read(int addr)
+{
+	unsigned char val = 0;
+	switch (addr - mViaAddr) {
+		case VIADEVREG_ORB:
+			val = (mViaRegs.orb & mViaRegs.ddrb) | ~mViaRegs.ddrb;
+			if (mViaRegs.acr & VIAACR_T1PB7)
+				val = (val & 0x7F) | (mViaRegs.pb7 ? 0x80 : 0);
+			mViaRegs.ifr &= ~(VIAIRQ_CB1 | VIAIRQ_CB2);
+			break;
+		case VIADEVREG_ORA:
+			val = (mViaRegs.ora & mViaRegs.ddra) | ~mViaRegs.ddra;
+			mViaRegs.ifr &= ~(VIAIRQ_CA1 | VIAIRQ_CA2);
+			break;
+		case VIADEVREG_ORANH:
+			val = (mViaRegs.ora & mViaRegs.ddra) | ~mViaRegs.ddra;
+			break;
+		case VIADEVREG_DDRB:
+			val = mViaRegs.ddrb;
+			break;
+		case VIADEVREG_DDRA:
+			val = mViaRegs.ddra;
+			break;
+		case VIADEVREG_T1CL:
+			val = ViaT1Counter() & 0xFF;
+			mViaRegs.ifr &= ~VIAIRQ_T1;
+			break;
+		case VIADEVREG_T1CH:
+			val = (ViaT1Counter() >> 8) & 0xFF;
+			break;
+		case VIADEVREG_T1LL:
+			val = mViaRegs.t1latch & 0xFF;
+			break;
+		case VIADEVREG_T1LH:
+			val = (mViaRegs.t1latch >> 8) & 0xFF;
+			break;
+		case VIADEVREG_T2CL:
+			val = ViaT2Counter() & 0xFF;
+			mViaRegs.ifr &= ~VIAIRQ_T2;
+			break;
+		case VIADEVREG_T2CH:
+			val = (ViaT2Counter() >> 8) & 0xFF;
+			break;
+		case VIADEVREG_SR:
+			val = mViaRegs.sr;
+			ViaStartShift();
+			break;
+		case VIADEVREG_ACR:
+			val = mViaRegs.acr;
+			break;
+		case VIADEVREG_PCR:
+			val = mViaRegs.pcr;
+			break;
+		case VIADEVREG_IFR:
+			val = mViaRegs.ifr;
+			if (mViaRegs.ifr & mViaRegs.ier) val |= VIAIRQ_ANY;
+			break;
+		case VIADEVREG_IER:
+			val = mViaRegs.ier | VIAIRQ_ANY;
+			break;
+		default:
+			break;
+	}
+	ViaUpdateIrq();
+	mpMem->Poke8bitImg((unsigned short)addr, val);
+
+	return val;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ViaReg_Write()
+ * Purpose:		Write VIA device register.
+ * Arguments:	addr - address of the register in memory
+ *						val - value to write
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::ViaReg_Write(int addr, int val)
+{
+	unsigned char v = (unsigned char) val;
+	switch (addr - mViaAddr) {
+		case VIADEVREG_ORB:
+			mViaRegs.orb = v;
+			mViaRegs.ifr &= ~(VIAIRQ_CB1 | VIAIRQ_CB2);
+			break;
+		case VIADEVREG_ORA:
+			mViaRegs.ora = v;
+			mViaRegs.ifr &= ~(VIAIRQ_CA1 | VIAIRQ_CA2);
+			break;
+		case VIADEVREG_ORANH:
+			mViaRegs.ora = v;
+			break;
+		case VIADEVREG_DDRB:
+			mViaRegs.ddrb = v;
+			break;
+		case VIADEVREG_DDRA:
+			mViaRegs.ddra = v;
+			break;
+		case VIADEVREG_T1CL:
+		case VIADEVREG_T1LL:
+			mViaRegs.t1latch = (mViaRegs.t1latch & 0xFF00) | v;
+			break;
+		case VIADEVREG_T1CH:
+			mViaRegs.t1latch = (mViaRegs.t1latch & 0x00FF) | (v << 8);
+			mViaRegs.ifr &= ~VIAIRQ_T1;
+			mViaRegs.t1irq = true;
+			if (mViaRegs.acr & VIAACR_T1PB7) mViaRegs.pb7 = false;
+			ViaStartT1(mViaRegs.t1latch);
+			break;
+		case VIADEVREG_T1LH:
+			mViaRegs.t1latch = (mViaRegs.t1latch & 0x00FF) | (v << 8);
+			mViaRegs.ifr &= ~VIAIRQ_T1;
+			break;
+		case VIADEVREG_T2CL:
+			mViaRegs.t2latchlo = v;
+			break;
+		case VIADEVREG_T2CH: {
+				EventSched *psched = mpMem->GetEventSched();
+				if (0 != mViaRegs.t2evt) psched->Cancel(mViaRegs.t2evt);
+				mViaRegs.t2evt = 0;
+				mViaRegs.t2start = mViaRegs.t2latchlo | (v << 8);
+				mViaRegs.t2base = psched->GetCycles();
+				mViaRegs.ifr &= ~VIAIRQ_T2;
+				mViaRegs.t2irq = true;
+				if (!(mViaRegs.acr & VIAACR_T2PULSE)) {
+					mViaRegs.t2evt = psched->Schedule((unsigned long)mViaRegs.t2start + 1,
+																						this, MMDEVEVT_VIA_T2);
+				}
+			}
+			break;
+		case VIADEVREG_SR:
+			mViaRegs.sr = v;
+			ViaStartShift();
+			break;
+		case VIADEVREG_ACR:
+			mViaRegs.acr = v;
+			break;
+		case VIADEVREG_PCR:
+			mViaRegs.pcr = v;
+			break;
+		case VIADEVREG_IFR:
+			mViaRegs.ifr &= ~(v & 0x7F);
+			break;
+		case VIADEVREG_IER:
+			if (v & VIAIRQ_ANY) {
+				mViaRegs.ier |= (v & 0x7F);
+			} else {
+				mViaRegs.ier &= ~(v & 0x7F);
+			}
+			break;
+		default:
+			break;
+	}
+	ViaUpdateIrq();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetAciaAddrBase()
+ * Purpose:		Return base address of ACIA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::GetAciaAddrBase()
+{
+	return mAciaAddr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReset()
+ * Purpose:		Bring ACIA device to hardware reset state: transmitter
+ *            empty, receiver and interrupts disabled.
+ *            Host endpoint stays open.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaReset()
+{
+	if (NULL != mpMem) {
+		EventSched *psched = mpMem->GetEventSched();
+		if (0 != mAciaRegs.txevt) psched->Cancel(mAciaRegs.txevt);
+		if (0 != mAciaRegs.rxevt) psched->Cancel(mAciaRegs.rxevt);
+	}
+	mAciaRegs.txevt = mAciaRegs.rxevt = 0;
+	mAciaRegs.rxdata = mAciaRegs.txdata = 0;
+	mAciaRegs.status = ACIASTAT_TDRE;
+	mAciaRegs.cmd = ACIACMD_IRD;
+	mAciaRegs.ctrl = 0;
+	if (NULL != mpMem) mpMem->GetIntCtrl()->SetLine(INTSRC_ACIA, false);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaSaveState()
+ * Purpose:		Get ACIA device state for memory snapshot.
+ *            Format: version (ACIA_STATE_VER), RX data, TX data,
+ *            status, command, control (baud rate, frame), cycles
+ *            until TX and RX events are due (4 bytes each, LSB first,
+ *            0 - not scheduled).
+ *            Host endpoint is not part of the state, its polling
+ *            goes on as set up in restored session.
+ * Arguments:	n/a
+ * Returns:		vector<unsigned char> - ACIA_STATE_LEN bytes
+ *--------------------------------------------------------------------
+ */
+vector<unsigned char> MemMapDev::AciaSaveState()
+{
+	vector<unsigned char> state;
+	state.push_back(ACIA_STATE_VER);
+	state.push_back(mAciaRegs.rxdata);
+	state.push_back(mAciaRegs.txdata);
+	state.push_back(mAciaRegs.status);
+	state.push_back(mAciaRegs.cmd);
+	state.push_back(mAciaRegs.ctrl);
+	PushDueIn(state, mAciaRegs.txevt);
+	PushDueIn(state, mAciaRegs.rxevt);
+	return state;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaRestoreState()
+ * Purpose:		Restore ACIA device state saved by AciaSaveState().
+ *            Character transmission and reception in progress are
+ *            scheduled again relative to current cycle.
+ * Arguments:	state - ACIA_STATE_LEN bytes, ignored if shorter or of
+ *                    unknown version
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaRestoreState(vector<unsigned char> state)
+{
+	if (state.size() < ACIA_STATE_LEN || ACIA_STATE_VER != state[0]) return;
+	EventSched *psched = mpMem->GetEventSched();
+	if (0 != mAciaRegs.txevt) psched->Cancel(mAciaRegs.txevt);
+	if (0 != mAciaRegs.rxevt) psched->Cancel(mAciaRegs.rxevt);
+	mAciaRegs.rxdata = state[1];
+	mAciaRegs.txdata = state[2];
+	mAciaRegs.status = state[3];
+	mAciaRegs.cmd = state[4];
+	mAciaRegs.ctrl = state[5];
+	unsigned long duein = GetDueIn(state, 6);
+	mAciaRegs.txevt = (duein > 0)
+										? psched->Schedule(duein, this, MMDEVEVT_ACIA_TX) : 0;
+	duein = GetDueIn(state, 10);
+	mAciaRegs.rxevt = (duein > 0)
+										? psched->Schedule(duein, this, MMDEVEVT_ACIA_RX) : 0;
+	mpMem->GetIntCtrl()->SetLine(INTSRC_ACIA,
+															 0 != (mAciaRegs.status & ACIASTAT_IRQ));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaCharCycles()
+ * Purpose:		Compute time of transmission of one character for
+ *            current baud rate and frame format.
+ * Arguments:	n/a
+ * Returns:		unsigned long - # of CPU cycles
+ *--------------------------------------------------------------------
+ */
+unsigned long MemMapDev::AciaCharCycles()
+{
+	// baud rates (x100) selected by bits 0-3 of control register,
+	// external clock (0) runs at 115200 baud
+	static const unsigned long baud_tbl[16] = {
+		11520000, 5000, 7500, 10992, 13458, 15000, 30000, 60000,
+		120000, 180000, 240000, 360000, 480000, 720000, 960000, 1920000
+	};
+	// start bit + data bits + stop bit(s) + parity bit
+	unsigned long bits = 1 + (8 - ((mAciaRegs.ctrl >> 5) & 0x03)) + 1;
+	if (mAciaRegs.ctrl & 0x80) bits++;
+	if (mAciaRegs.cmd & ACIACMD_PARITY) bits++;
+	unsigned long long cycles = (unsigned long long) mAciaClock * bits * 100
+															/ baud_tbl[mAciaRegs.ctrl & 0x0F];
+	return (cycles > 0) ? (unsigned long) cycles : 1;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaSetIrq()
+ * Purpose:		Set ACIA interrupt flag and request CPU interrupt when
+ *            interrupt from given source is enabled.
+ * Arguments:	cause - status bit which just became set
+ *                    (ACIASTAT_RDRF or ACIASTAT_TDRE)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaSetIrq(unsigned char cause)
+{
+	bool irq = false;
+	if (cause & ACIASTAT_RDRF) irq = !(mAciaRegs.cmd & ACIACMD_IRD);
+	if (cause & ACIASTAT_TDRE)
+		irq = irq || ((mAciaRegs.cmd & ACIACMD_TIC) == ACIACMD_TXIRQ);
+	if (irq && (mAciaRegs.cmd & ACIACMD_DTR)) {
+		mAciaRegs.status |= ACIASTAT_IRQ;
+		mpMem->GetIntCtrl()->SetLine(INTSRC_ACIA, true);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaStartRx()
+ * Purpose:		Schedule reception of next character from host buffer
+ *            (one character time from now), if receiver is enabled
+ *            and reception is not in progress already.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaStartRx()
+{
+	if (0 != mAciaRegs.rxevt || !(mAciaRegs.cmd & ACIACMD_DTR)
+			|| mpAciaLink->RxEmpty()) return;
+	mAciaRegs.rxevt = mpMem->GetEventSched()->Schedule(AciaCharCycles(),
+																		this, MMDEVEVT_ACIA_RX);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReg_Data()
+ * Purpose:		Read ACIA receive data register.
+ *            Receive data register full flag is cleared.
+ * Arguments:	addr - address of the register in memory
+ * Returns:		int - received character
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::AciaReg_Data(int addr)
+{
+	int ret = mAciaRegs.rxdata;
+	mAciaRegs.status &= ~(ACIASTAT_RDRF | ACIASTAT_OVERRUN);
+	mpMem->Poke8bitImg((unsigned short)addr, (unsigned char)ret);
+	AciaStartRx();
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReg_Status()
+ * Purpose:		Read ACIA status register (also for command and
+ *            control registers, which read back as written).
+ *            Reading status clears the interrupt flag.
+ * Arguments:	addr - address of the register in memory
+ * Returns:		int - register value
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::AciaReg_Status(int addr)
+{
+	int ret = 0;
+	switch (addr - mAciaAddr) {
+		case ACIADEVREG_STATUS:
+			ret = mAciaRegs.status;
+			if (!mpAciaLink->IsConnected()) ret |= (ACIASTAT_DCD | ACIASTAT_DSR);
+			mAciaRegs.status &= ~ACIASTAT_IRQ;
+			mpMem->GetIntCtrl()->SetLine(INTSRC_ACIA, false);
+			break;
+		case ACIADEVREG_CMD:
+			ret = mAciaRegs.cmd;
+			break;
+		case ACIADEVREG_CTRL:
+			ret = mAciaRegs.ctrl;
+			break;
+		default:
+			break;
+	}
+	mpMem->Poke8bitImg((unsigned short)addr, (unsigned char)ret);
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReg_Tx()
+ * Purpose:		Write ACIA transmit data register.
+ *            Character is sent to host after one character time.
+ *            Writing when transmitter is busy replaces the character
+ *            waiting in the register.
+ * Arguments:	addr - address of the register in memory
+ *            val - character to transmit
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaReg_Tx(int addr, int val)
+{
+	mAciaRegs.txdata = (unsigned char) val;
+	mAciaRegs.status &= ~ACIASTAT_TDRE;
+	if (0 == mAciaRegs.txevt) {
+		mAciaRegs.txevt = mpMem->GetEventSched()->Schedule(AciaCharCycles(),
+																			this, MMDEVEVT_ACIA_TX);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReg_Reset()
+ * Purpose:		Write to ACIA status register - programmed reset.
+ *            Command register bits 0-4 and overrun flag are cleared.
+ * Arguments:	addr - address of the register in memory
+ *            val - value (ignored)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaReg_Reset(int addr, int val)
+{
+	mAciaRegs.cmd &= 0xE0;
+	mAciaRegs.status &= ~ACIASTAT_OVERRUN;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReg_Cmd()
+ * Purpose:		Write ACIA command register.
+ * Arguments:	addr - address of the register in memory
+ *            val - value
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaReg_Cmd(int addr, int val)
+{
+	unsigned char prev = mAciaRegs.cmd;
+	mAciaRegs.cmd = (unsigned char) val;
+	// transmitter interrupt just enabled with empty transmit register
+	if ((mAciaRegs.status & ACIASTAT_TDRE)
+			&& (prev & ACIACMD_TIC) != ACIACMD_TXIRQ) {
+		AciaSetIrq(ACIASTAT_TDRE);
+	}
+	AciaStartRx();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaReg_Ctrl()
+ * Purpose:		Write ACIA control register (baud rate, frame format).
+ * Arguments:	addr - address of the register in memory
+ *            val - value
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaReg_Ctrl(int addr, int val)
+{
+	mAciaRegs.ctrl = (unsigned char) val;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaSetLink()
+ * Purpose:		Connect ACIA device to host endpoint.
+ * Arguments:	type - endpoint type (eSerialLinkTypes)
+ *            path - pty: optional symbolic link to created pty,
+ *                   socket: path of Unix domain socket
+ * Returns:		int - 0 if OK, -1 if endpoint couldn't be opened
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::AciaSetLink(int type, string path)
+{
+	int ret = 0;
+	mpAciaLink->Close();
+	if (SERLINK_PTY == type) ret = mpAciaLink->OpenPty(path);
+	else if (SERLINK_SOCKET == type) ret = mpAciaLink->OpenSocket(path);
+	if (0 == ret && SERLINK_NONE != mpAciaLink->GetType()
+			&& 0 == mAciaRegs.pollevt) {
+		mAciaRegs.pollevt = mpMem->GetEventSched()->Schedule(ACIA_POLL_CYCLES,
+																			this, MMDEVEVT_ACIA_POLL);
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetAciaLinkName()
+ * Purpose:		Return name of ACIA host endpoint (pty slave device or
+ *            socket path).
+ * Arguments:	n/a
+ * Returns:		string - name, empty if not connected
+ *--------------------------------------------------------------------
+ */
+string MemMapDev::GetAciaLinkName()
+{
+	return mpAciaLink->GetName();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AciaFlush()
+ * Purpose:		Send data buffered by ACIA device to host.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::AciaFlush()
+{
+	mpAciaLink->Flush();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntcAddrBase()
+ * Purpose:		Return base address of interrupt controller registers.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::GetIntcAddrBase()
+{
+	return mIntcAddr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IntcReg_Read()
+ * Purpose:		Read interrupt controller register.
+ * Arguments:	addr - address of the register in memory
+ * Returns:		int - register value (also placed in memory)
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::IntcReg_Read(int addr)
+{
+	IntCtrl *pintc = mpMem->GetIntCtrl();
+	unsigned char val = 0;
+	switch (addr - mIntcAddr) {
+		case INTCDEVREG_PENDING:
+			val = pintc->GetPending();
+			break;
+		case INTCDEVREG_MASK:
+			val = pintc->GetMask();
+			break;
+		case INTCDEVREG_ACTIVE:
+			val = (unsigned char) pintc->GetActiveSrc();
+			break;
+		default:
+			break;
+	}
+	mpMem->Poke8bitImg((unsigned short)addr, val);
+
+	return val;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IntcReg_Write()
+ * Purpose:		Write interrupt controller register.
+ * Arguments:	addr - address of the register in memory
+ *						val - value to write
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::IntcReg_Write(int addr, int val)
+{
+	IntCtrl *pintc = mpMem->GetIntCtrl();
+	unsigned char v = (unsigned char) val;
+	switch (addr - mIntcAddr) {
+		case INTCDEVREG_PENDING:
+			pintc->ClearTriggered(v);
+			break;
+		case INTCDEVREG_MASK:
+			pintc->SetMask(v);
+			break;
+		case INTCDEVREG_TRIGGER:
+			for (int i = 0; i < INTC_NUM_SRC; i++) {
+				if (v & (1 << i)) pintc->Trigger(i);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskAddrBase()
+ * Purpose:		Return base address of disk controller.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short MemMapDev::GetDiskAddrBase()
+{
+	return mDiskAddr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskStorage()
+ * Purpose:		Return disk images served by disk controller.
+ * Arguments:	n/a
+ * Returns:		MassStorage * - pointer to disk images object
+ *--------------------------------------------------------------------
+ */
+MassStorage *MemMapDev::GetDiskStorage()
+{
+	return mpDiskStorage;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskReg_Latch()
+ * Purpose:		Write a value to disk controller parameter register.
+ * Arguments:	addr - address of the register in memory
+ *            val - value
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DiskReg_Latch(int addr, int val)
+{
+	mDiskRegs.regs[addr - mDiskAddr] = (unsigned char) val;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskReg_Read()
+ * Purpose:		Read disk controller register. Parameter registers
+ *            read back as written, reading status clears the
+ *            interrupt flag.
+ * Arguments:	addr - address of the register in memory
+ * Returns:		int - register value
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::DiskReg_Read(int addr)
+{
+	int ret = 0;
+	int reg = addr - mDiskAddr;
+	if (DISKDEVREG_STATUS == reg) {
+		ret = mDiskRegs.status;
+		mDiskRegs.status &= ~DISKSTAT_IRQ;
+		mpMem->GetIntCtrl()->SetLine(INTSRC_DISK, false);
+	} else {
+		ret = mDiskRegs.regs[reg];
+	}
+	mpMem->Poke8bitImg((unsigned short)addr, (unsigned char)ret);
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskReg_Cmd()
+ * Purpose:		Start disk controller command. Parameters are taken
+ *            from registers now, the command completes (data are
+ *            transferred) after the modeled delay. Command written
+ *            while controller is busy is ignored.
+ * Arguments:	addr - address of the register in memory
+ *            val - command code (DiskDevCmds)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DiskReg_Cmd(int addr, int val)
+{
+	mDiskRegs.regs[DISKDEVREG_CMD] = (unsigned char) val;
+	if (mDiskRegs.status & DISKSTAT_BUSY) return;
+	mDiskRegs.cmd = (unsigned char) val;
+	mDiskRegs.drive = mDiskRegs.regs[DISKDEVREG_DRIVE];
+	mDiskRegs.track = mDiskRegs.regs[DISKDEVREG_TRACK];
+	mDiskRegs.sector = mDiskRegs.regs[DISKDEVREG_SECTOR];
+	mDiskRegs.buf = mDiskRegs.regs[DISKDEVREG_BUF]
+									+ 256 * mDiskRegs.regs[DISKDEVREG_BUF + 1];
+	mDiskRegs.status |= DISKSTAT_BUSY;
+	mDiskRegs.status &= ~DISKSTAT_ERR;
+	if (0 == mDiskCmdCycles) {
+		DiskComplete();
+	} else {
+		mDiskRegs.cmdevt = mpMem->GetEventSched()->Schedule(mDiskCmdCycles,
+																		this, MMDEVEVT_DISK_DONE);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskReg_Status()
+ * Purpose:		Write disk controller status register, only the
+ *            interrupt enable bit is writable.
+ * Arguments:	addr - address of the register in memory
+ *            val - value
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DiskReg_Status(int addr, int val)
+{
+	mDiskRegs.status = (mDiskRegs.status & ~DISKSTAT_IRQEN)
+										 | (val & DISKSTAT_IRQEN);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskComplete()
+ * Purpose:		Execute disk controller command in progress: transfer
+ *            the whole sector between disk image and memory in one
+ *            operation, update status and request interrupt.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DiskComplete()
+{
+	int err = 0;
+	unsigned char buf[MassStorage::sector_size];
+	unsigned char *pdata = NULL;
+	MassStorDirEntry entry;
+	int len = 0;
+
+	switch (mDiskRegs.cmd) {
+		case DISKDEVCMD_READ:
+			pdata = mpDiskStorage->ReadSectorData(mDiskRegs.drive,
+																						mDiskRegs.track,
+																						mDiskRegs.sector);
+			if (NULL == pdata) err = -1;
+			else mpMem->WriteBlock(mDiskRegs.buf, pdata, MassStorage::sector_size);
+			break;
+		case DISKDEVCMD_WRITE:
+			mpMem->ReadBlock(mDiskRegs.buf, buf, MassStorage::sector_size);
+			err = mpDiskStorage->WriteSectorData(mDiskRegs.drive,
+																					 mDiskRegs.track,
+																					 mDiskRegs.sector,
+																					 buf);
+			break;
+		case DISKDEVCMD_FLUSH:
+			err = mpDiskStorage->Flush(mDiskRegs.drive);
+			break;
+		case DISKDEVCMD_FORMAT:
+			err = mpDiskStorage->Format(mDiskRegs.drive,
+																	"DISK" + to_string(mDiskRegs.drive));
+			break;
+		case DISKDEVCMD_SYNC:
+			err = mpDiskStorage->Sync();
+			break;
+		case DISKDEVCMD_FIND:
+			mpMem->ReadBlock(mDiskRegs.buf, buf, 16);
+			while (len < 16 && 0 != buf[len] && 0xA0 != buf[len]) len++;
+			if (mpDiskStorage->FindFile(mDiskRegs.drive,
+																	string((const char *) buf, len), entry)) {
+				mDiskRegs.regs[DISKDEVREG_TRACK] = (unsigned char) entry.track;
+				mDiskRegs.regs[DISKDEVREG_SECTOR] = (unsigned char) entry.sector;
+			} else {
+				err = -1;
+			}
+			break;
+		default:
+			err = -1;
+			break;
+	}
+	mDiskRegs.status &= ~DISKSTAT_BUSY;
+	if (0 > err) mDiskRegs.status |= DISKSTAT_ERR;
+	if (mDiskRegs.status & DISKSTAT_IRQEN) {
+		mDiskRegs.status |= DISKSTAT_IRQ;
+		mpMem->GetIntCtrl()->SetLine(INTSRC_DISK, true);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskReset()
+ * Purpose:		Bring disk controller to reset state, command in
+ *            progress is aborted. Disk images are not affected.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DiskReset()
+{
+	if (NULL != mpMem && 0 != mDiskRegs.cmdevt) {
+		mpMem->GetEventSched()->Cancel(mDiskRegs.cmdevt);
+	}
+	mDiskRegs.cmdevt = 0;
+	memset(mDiskRegs.regs, 0, sizeof(mDiskRegs.regs));
+	mDiskRegs.regs[DISKDEVREG_TRACK] = 1;
+	mDiskRegs.status = 0;
+	mDiskRegs.cmd = 0;
+	mDiskRegs.drive = mDiskRegs.track = mDiskRegs.sector = 0;
+	mDiskRegs.buf = 0;
+	if (NULL != mpMem) mpMem->GetIntCtrl()->SetLine(INTSRC_DISK, false);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskSaveState()
+ * Purpose:		Get disk controller state for memory snapshot.
+ *            Format: version (DISK_STATE_VER), registers, status,
+ *            command in progress (command, drive, track, sector,
+ *            buffer lo, hi), cycles until the command completes
+ *            (4 bytes, LSB first, 0 - none in progress).
+ * Arguments:	n/a
+ * Returns:		vector<unsigned char> - DISK_STATE_LEN bytes
+ *--------------------------------------------------------------------
+ */
+vector<unsigned char> MemMapDev::DiskSaveState()
+{
+	vector<unsigned char> state;
+	state.push_back(DISK_STATE_VER);
+	state.insert(state.end(), mDiskRegs.regs, mDiskRegs.regs + DISKDEVREG_END);
+	state.push_back(mDiskRegs.status);
+	state.push_back(mDiskRegs.cmd);
+	state.push_back(mDiskRegs.drive);
+	state.push_back(mDiskRegs.track);
+	state.push_back(mDiskRegs.sector);
+	state.push_back(mDiskRegs.buf & 0xFF);
+	state.push_back((mDiskRegs.buf >> 8) & 0xFF);
+	PushDueIn(state, mDiskRegs.cmdevt);
+	return state;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskRestoreState()
+ * Purpose:		Restore disk controller state saved by
+ *            DiskSaveState(). Command in progress is scheduled to
+ *            complete relative to current cycle.
+ * Arguments:	state - DISK_STATE_LEN bytes, ignored if shorter or of
+ *                    unknown version
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::DiskRestoreState(vector<unsigned char> state)
+{
+	if (state.size() < DISK_STATE_LEN || DISK_STATE_VER != state[0]) return;
+	EventSched *psched = mpMem->GetEventSched();
+	if (0 != mDiskRegs.cmdevt) psched->Cancel(mDiskRegs.cmdevt);
+	int n = 1 + DISKDEVREG_END;
+	memcpy(mDiskRegs.regs, &state[1], DISKDEVREG_END);
+	mDiskRegs.status = state[n];
+	mDiskRegs.cmd = state[n + 1];
+	mDiskRegs.drive = state[n + 2];
+	mDiskRegs.track = state[n + 3];
+	mDiskRegs.sector = state[n + 4];
+	mDiskRegs.buf = state[n + 5] + 256 * state[n + 6];
+	unsigned long duein = GetDueIn(state, n + 7);
+	// busy controller must complete the command
+	if (0 == duein && (mDiskRegs.status & DISKSTAT_BUSY)) duein = 1;
+	mDiskRegs.cmdevt = (duein > 0)
+										 ? psched->Schedule(duein, this, MMDEVEVT_DISK_DONE) : 0;
+	mpMem->GetIntCtrl()->SetLine(INTSRC_DISK,
+															 0 != (mDiskRegs.status & DISKSTAT_IRQ));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_LoadLib()
+ * Purpose:		Load shared library with pluggable device types.
+ * Arguments:	libpath - path to library file
+ * Returns:		int - PLUGDEVERR_OK or error code (ePlugDevErrors)
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::PlugDev_LoadLib(string libpath)
+{
+	return mpPlugDevReg->LoadLib(libpath);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_RegisterType()
+ * Purpose:		Register pluggable device type implemented in the
+ *            application itself (not loaded from library).
+ * Arguments:	type - name of device type
+ *            pfun - function creating the device object
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::PlugDev_RegisterType(string type, PlugDevCreateFn pfun)
+{
+	mpPlugDevReg->Register(type, pfun);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_Create()
+ * Purpose:		Create pluggable device of registered type and add it
+ *            to the supported devices. Device occupies a contiguous
+ *            range of GetNumRegs() addresses beginning at addr, which
+ *            must not overlap any active device (built-in or
+ *            pluggable). Each address of the range is mapped to the
+ *            device in the register table, so access does not depend
+ *            on the number of devices.
+ * Arguments:	type - name of device type
+ *            addr - base address
+ *            params - device parameters
+ * Returns:		int - device number, -1 if device couldn't be created,
+ *                  -2 if address range overlaps active device
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::PlugDev_Create(string type, unsigned short addr, DevParams params)
+{
+	PlugDevice *pdev = mpPlugDevReg->Create(type, mpPlugDevHost);
+	if (NULL == pdev) return -1;
+	int nregs = pdev->GetNumRegs();
+	if (nregs <= 0 || addr + nregs - 1 > MAX_8BIT_ADDR) {
+		delete pdev;
+		return -1;
+	}
+	if (mPlugDevRegs.empty()) mPlugDevRegs.assign(MAX_8BIT_ADDR + 1, -1);
+	for (int reg = 0; reg < nregs; reg++) {
+		unsigned short regaddr = (unsigned short)(addr + reg);
+		if (0 <= mPlugDevRegs[regaddr] || 0 <= mpMem->GetDeviceAt(regaddr)) {
+			delete pdev;
+			return -2;
+		}
+	}
+	vector<pair<string,string> > setup_params;
+	for (DevParams::iterator it = params.begin(); it != params.end(); ++it) {
+		setup_params.push_back(make_pair(it->name, it->value));
+	}
+	pdev->Setup(setup_params);
+	PlugDevEntry entry;
+	entry.pdev = pdev;
+	entry.type = type;
+	entry.base = addr;
+	entry.nregs = nregs;
+	entry.devnum = DEVNUM_PLUGDEV + (int) mPlugDevs.size();
+	for (int reg = 0; reg < nregs; reg++) {
+		mPlugDevRegs[addr + reg] = (short) mPlugDevs.size();
+	}
+	mPlugDevs.push_back(entry);
+	// first device starts periodic tick event
+	if (1 == mPlugDevs.size()) {
+		mpMem->GetEventSched()->Schedule(PLUGDEV_TICK_CYCLES, this,
+																		 MMDEVEVT_PLUGDEV_TICK);
+	}
+	MemAddrRanges addr_ranges;
+	addr_ranges.push_back(AddrRange(addr, addr + nregs - 1));
+	RegReadFuns rdregs(nregs, &MemMapDev::PlugDev_Read);
+	RegWriteFuns wrregs(nregs, &MemMapDev::PlugDev_Write);
+	Device dev(entry.devnum,
+						 type,
+						 addr_ranges,
+						 NULL,
+						 NULL,
+						 params,
+						 rdregs,
+						 wrregs);
+	mDevices.push_back(dev);
+
+	return entry.devnum;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_Read()
+ * Purpose:		Read pluggable device register.
+ *            Value is placed in memory image at the register address.
+ * Arguments:	addr - address of the register in memory
+ * Returns:		int - register value
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::PlugDev_Read(int addr)
+{
+	int ret = 0;
+	int idx = mPlugDevRegs.empty() ? -1 : mPlugDevRegs[addr & MAX_8BIT_ADDR];
+	if (idx >= 0) {
+		PlugDevEntry &entry = mPlugDevs[idx];
+		ret = entry.pdev->Read(addr - entry.base) & 0xFF;
+		mpMem->Poke8bitImg((unsigned short)addr, (unsigned char)ret);
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_Write()
+ * Purpose:		Write pluggable device register.
+ * Arguments:	addr - address of the register in memory
+ *						val - value to write
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::PlugDev_Write(int addr, int val)
+{
+	int idx = mPlugDevRegs.empty() ? -1 : mPlugDevRegs[addr & MAX_8BIT_ADDR];
+	if (idx >= 0) {
+		PlugDevEntry &entry = mPlugDevs[idx];
+		entry.pdev->Write(addr - entry.base, val);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_Tick()
+ * Purpose:		Let the pluggable devices know how many CPU cycles
+ *            have elapsed.
+ * Arguments:	cycles - # of cycles since previous call
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::PlugDev_Tick(unsigned long cycles)
+{
+	for (vector<PlugDevEntry>::iterator it = mPlugDevs.begin();
+			 it != mPlugDevs.end();
+			 ++it
+			) {
+		it->pdev->Tick(cycles);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_Count()
+ * Purpose:		Get # of pluggable devices.
+ * Arguments:	n/a
+ * Returns:		int - # of devices
+ *--------------------------------------------------------------------
+ */
+int MemMapDev::PlugDev_Count()
+{
+	return (int) mPlugDevs.size();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_SaveState()
+ * Purpose:		Write state of pluggable devices to file.
+ *            Format: PLUGDEV_STATE_MAGIC, # of devices (byte) and for
+ *            each device: base address (lo, hi), length of type name
+ *            (byte), type name, length of state (4 bytes, LSB first)
+ *            and state data.
+ * Arguments:	fp - file pointer (open for writing)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::PlugDev_SaveState(FILE *fp)
+{
+	if (mPlugDevs.empty()) return;
+	fwrite(PLUGDEV_STATE_MAGIC, 1, strlen(PLUGDEV_STATE_MAGIC), fp);
+	fputc((int) mPlugDevs.size() & 0xFF, fp);
+	for (vector<PlugDevEntry>::iterator it = mPlugDevs.begin();
+			 it != mPlugDevs.end();
+			 ++it
+			) {
+		vector<unsigned char> state = it->pdev->SaveState();
+		unsigned long len = state.size();
+		string type = it->type.substr(0, 0xFF);
+		fputc(it->base & 0xFF, fp);
+		fputc((it->base >> 8) & 0xFF, fp);
+		fputc((int) type.length(), fp);
+		fwrite(type.c_str(), 1, type.length(), fp);
+		for (int i = 0; i < 4; i++) fputc((len >> (8 * i)) & 0xFF, fp);
+		if (len > 0) fwrite(&state[0], 1, len, fp);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDev_RestoreState()
+ * Purpose:		Read state of pluggable devices from file (written by
+ *            PlugDev_SaveState()). State is given to the device of
+ *            the same type and base address, states of devices not
+ *            present in current configuration are skipped.
+ * Arguments:	fp - file pointer (open for reading)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void MemMapDev::PlugDev_RestoreState(FILE *fp)
+{
+	char magic[sizeof(PLUGDEV_STATE_MAGIC)];
+	size_t mlen = strlen(PLUGDEV_STATE_MAGIC);
+	if (fread(magic, 1, mlen, fp) != mlen) return;
+	if (0 != strncmp(magic, PLUGDEV_STATE_MAGIC, mlen)) return;
+	int n = fgetc(fp);
+	for (int d = 0; d < n; d++) {
+		int lo = fgetc(fp);
+		int hi = fgetc(fp);
+		int tlen = fgetc(fp);
+		if (EOF == lo || EOF == hi || EOF == tlen) break;
+		unsigned short base = lo + 256 * hi;
+		string type;
+		for (int i = 0; i < tlen; i++) {
+			int c = fgetc(fp);
+			if (EOF == c) return;
+			type.push_back((char) c);
+		}
+		unsigned long len = 0;
+		for (int i = 0; i < 4; i++) {
+			int c = fgetc(fp);
+			if (EOF == c) return;
+			len |= ((unsigned long) c) << (8 * i);
+		}
+		vector<unsigned char> state(len);
+		if (len > 0 && fread(&state[0], 1, len, fp) != len) return;
+		for (vector<PlugDevEntry>::iterator it = mPlugDevs.begin();
+				 it != mPlugDevs.end();
+				 ++it
+				) {
+			if (it->base == base && 0 == it->type.compare(type)) {
+				it->pdev->RestoreState(state);
+				break;
+			}
+		}
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDevMemHost()
+ * Purpose:		Class constructor.
+ * Arguments:	pmem - pointer to memory object
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+PlugDevMemHost::PlugDevMemHost(Memory *pmem)
+{
+	mpMem = pmem;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Peek()
+ * Purpose:		Read memory image.
+ * Arguments:	addr - address
+ * Returns:		unsigned char - value
+ *--------------------------------------------------------------------
+ */
+unsigned char PlugDevMemHost::Peek(unsigned short addr)
+{
+	return mpMem->Peek8bitImg(addr);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Poke()
+ * Purpose:		Write memory image.
+ * Arguments:	addr - address
+ *            val - value
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void PlugDevMemHost::Poke(unsigned short addr, unsigned char val)
+{
+	mpMem->Poke8bitImg(addr, val);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		StallCycles()
+ * Purpose:		Stall CPU for given # of cycles.
+ * Arguments:	cycles - # of cycles
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void PlugDevMemHost::StallCycles(int cycles)
+{
+	mpMem->AddStallCycles(cycles);
+}
+
 } // namespace MKBasic
@@ -40,6 +40,10 @@
 #include "GraphDisp.h"
 #include "Display.h"
 #include "ConsoleIO.h"
+#include "PlugDev.h"
+#include "EventSched.h"
+#include "SerialLink.h"
+#include "MassStorage.h"
 
 #if defined(LINUX)
 #include <unistd.h>
@@ -50,11 +54,31 @@
 // some default definitions
 #define CHARIO_ADDR			0xE000
 #define GRDISP_ADDR			0xE002
+#define DMA_ADDR				0xE020
+#define DMA_BYTECYCLES	1				// CPU cycles taken per byte by DMA
+#define DMA_STATE_LEN		(DMADEVREG_END + 2)	// registers, cycles per byte
+#define VIA_ADDR				0xE030
+#define VIA_STATE_LEN		32			// registers, timers, pending events
+#define ACIA_ADDR				0xE028
+#define ACIA_STATE_VER	1				// version of saved ACIA state format
+#define ACIA_STATE_LEN	14			// version, registers, pending events
+#define INTC_ADDR				0xE02C
+#define DISK_ADDR				0xE040
+#define DISK_CMDCYCLES	2000		// CPU cycles from disk command to completion
+#define DISK_STATE_VER	1				// version of saved disk controller state
+#define DISK_STATE_LEN	(DISKDEVREG_END + 12)	// registers, command, event
+#define ACIA_CLOCK			1000000	// CPU clock (Hz) for ACIA baud rate timing
+#define ACIA_POLL_CYCLES	10000	// ACIA host link service period (cycles)
 #define CHARIO_BUF_SIZE	256
+#define CHARIO_CAPT_SIZE	0x100000	// default output capture limit (1 MB)
+#define FNV1A_OFFSET		2166136261UL	// output capture hash (32-bit FNV-1a)
+#define FNV1A_PRIME			16777619UL
 #define CHARTBL_BANK		0x0B		// $B000
 #define CHARTBL_LEN			0x1000	// 4 kB
 #define TXTCRSR_MAXCOL	79
 #define TXTCRSR_MAXROW	24
+#define PLUGDEV_TICK_CYCLES	256			// period of pluggable devices Tick() calls
+#define PLUGDEV_STATE_MAGIC	"PLUGDEVS"	// pluggable devices state in snapshot
 
 using namespace std;
 
@@ -108,6 +132,10 @@ typedef int (MemMapDev::*ReadFunPtr)(int);
 // device register write,	arguments: address, value
 typedef void (MemMapDev::*WriteFunPtr)(int,int);
 
+// register handler tables, indexed by register offset from device base
+typedef vector<ReadFunPtr>	RegReadFuns;
+typedef vector<WriteFunPtr>	RegWriteFuns;
+
 // Definition of device.
 struct Device {
 	int             num;						// device number
@@ -116,10 +144,14 @@ struct Device {
 	ReadFunPtr			read_fun_ptr;		// pointer to memory register read function
 	WriteFunPtr			write_fun_ptr;	// pointer to memory register write function
 	DevParams				params;					// list of device parameters
+	unsigned short	reg_base;				// address of register #0 (start of 1-st range)
+	RegReadFuns			reg_read;				// per-register read handlers
+	RegWriteFuns		reg_write;			// per-register write handlers
 
 	Device()
 	{
 		num = -1;
+		reg_base = 0;
 	}
 
 	Device(int dnum, 
@@ -135,6 +167,42 @@ struct Device {
 		read_fun_ptr = prdfun;
 		write_fun_ptr = pwrfun;
 		params = parms;
+		reg_base = (addrranges.empty() ? 0 : addrranges[0].start_addr);
+	}
+
+	Device(int dnum, 
+				 string dname, 
+				 MemAddrRanges addrranges, 
+				 ReadFunPtr prdfun, 
+				 WriteFunPtr pwrfun, 
+				 DevParams parms,
+				 RegReadFuns rdregs,
+				 RegWriteFuns wrregs) 
+	{
+		num = dnum;
+		name = dname;
+		addr_ranges = addrranges;
+		read_fun_ptr = prdfun;
+		write_fun_ptr = pwrfun;
+		params = parms;
+		reg_base = (addrranges.empty() ? 0 : addrranges[0].start_addr);
+		reg_read = rdregs;
+		reg_write = wrregs;
+	}
+
+	// Handler of read from address: register handler if address is
+	// covered by the register table, otherwise whole device handler.
+	ReadFunPtr GetReadFun(unsigned short addr)
+	{
+		unsigned int reg = (unsigned int)(addr - reg_base);
+		return ((reg < reg_read.size()) ? reg_read[reg] : read_fun_ptr);
+	}
+
+	// Handler of write to address, see GetReadFun().
+	WriteFunPtr GetWriteFun(unsigned short addr)
+	{
+		unsigned int reg = (unsigned int)(addr - reg_base);
+		return ((reg < reg_write.size()) ? reg_write[reg] : write_fun_ptr);
 	}
 };
 
@@ -143,7 +211,38 @@ typedef vector<Device> MemMappedDevices;
 // currently supported devices
 enum DevNums {
 	DEVNUM_CHARIO = 0,	// character I/O device
-	DEVNUM_GRDISP = 1		// raster graphics display device
+	DEVNUM_GRDISP = 1,	// raster graphics display device
+	DEVNUM_DMA		= 2,	// DMA / blitter device
+	DEVNUM_VIA		= 3,	// VIA (6522) timers / ports device
+	DEVNUM_ACIA		= 4,	// ACIA (6551) serial port device
+	DEVNUM_INTC		= 5,	// interrupt controller registers
+	DEVNUM_DISK		= 6,	// disk controller
+	DEVNUM_PLUGDEV = 16	// 1-st pluggable device, next ones follow
+};
+
+// Emulated system interface given to pluggable devices.
+class PlugDevMemHost : public PlugDevHost {
+
+	public:
+
+		PlugDevMemHost(Memory *pmem);
+		unsigned char Peek(unsigned short addr);
+		void Poke(unsigned short addr, unsigned char val);
+		void StallCycles(int cycles);
+
+	private:
+
+		Memory *mpMem;
+
+};
+
+// Pluggable device instance.
+struct PlugDevEntry {
+	PlugDevice			*pdev;					// device object
+	string					type;						// device type name
+	unsigned short	base;						// base address
+	int							nregs;					// # of registers
+	int							devnum;					// device number
 };
 
 /*
@@ -164,6 +263,13 @@ enum DevNums {
  * etc., device should be setup accordingly by calling SetupDevice method
  * with proper arguments. Device setup is not mandatory, each device that
  * is mainained is initialized wit default parameters.
+ *
+ * Device registers are normally handled by register tables (reg_read,
+ * reg_write) with a handler for each register, indexed by the offset of
+ * the address from the beginning of the first address range. This way
+ * the cost of access does not depend on the number of registers.
+ * Addresses not covered by the tables go to the whole device handlers
+ * (read_fun_ptr, write_fun_ptr), NULL handler means no action.
  */
 
 // offsets of raster graphics device registers
@@ -185,6 +291,8 @@ enum GraphDevRegs {
 	GRAPHDEVREG_PUTC		= 16,	// output char. to current pos. and move cursor
 	GRAPHDEVREG_CRSMODE	= 17,	// set cursor mode (0 - not visible, 1 - block...)
 	GRAPHDEVREG_TXTMODE = 18,	// set text mode (0 - normal, 1 - reverse)
+	GRAPHDEVREG_BMPADDR = 19,	// memory page where bitmap begins
+	GRAPHDEVREG_BMPMODE = 20,	// set bitmap mode (0 - off, 1 - 1bpp 320x200)
 	//---------------------------
 	GRAPHDEVREG_END
 };
@@ -206,7 +314,10 @@ enum GraphDevCmds {
 	GRAPHDEVCMD_SETBGC = 3,
 	GRAPHDEVCMD_SETFGC = 4,
 	GRAPHDEVCMD_DRAWLN = 5,
-	GRAPHDEVCMD_ERASLN = 6
+	GRAPHDEVCMD_ERASLN = 6,
+	GRAPHDEVCMD_FILLRC = 7,	// fill rectangle X,Y - X2,Y2 with pixel color
+	GRAPHDEVCMD_ERASRC = 8,	// erase rectangle X,Y - X2,Y2 (bg color)
+	GRAPHDEVCMD_HSPAN	 = 9	// horizontal span X - X2 in row Y, pixel color
 };
 
 // Cursor modes.
@@ -228,6 +339,19 @@ enum TextModes {
 	GRAPHDEVTXTMODE_END
 };
 
+// Bitmap modes.
+// In bitmap mode the 6502 memory at BMPADDR page is the picture, 1 bit per
+// pixel (bit 7 - leftmost), 40 bytes per row, 200 rows (8000 bytes).
+// Set bits are shown in pixel color, cleared bits in background color.
+enum BitmapModes {
+	GRAPHDEVBMP_OFF		= 0,	// bitmap not shown
+	GRAPHDEVBMP_1BPP	= 1,	// 1 bit per pixel, 320x200
+	//------------------------------------------
+	GRAPHDEVBMP_END
+};
+#define GRAPHDEVBMP_ROWLEN	40	// bytes per bitmap row (1bpp)
+#define GRAPHDEVBMP_STEPS		1024	// check bitmap every 1024 steps (power of 2)
+
 struct GraphDeviceRegs {
 	unsigned char mGraphDispLoX;
 	unsigned char mGraphDispHiX;
@@ -246,10 +370,191 @@ struct GraphDeviceRegs {
 	unsigned char mGraphDispTxtCurY;	// text cursor row
 	unsigned char mGraphDispCrsMode;	// cursor mode
 	unsigned char mGraphDispTxtMode;	// text mode
+	unsigned char mGraphDispBmpAddr;	// bitmap memory page
+	unsigned char mGraphDispBmpMode;	// bitmap mode
+};
+
+// offsets of DMA device registers
+enum DmaDevRegs {
+	DMADEVREG_SRC		= 0,	// source address (lo, hi)
+	DMADEVREG_DST		= 2,	// destination address (lo, hi)
+	DMADEVREG_LEN		= 4,	// # of bytes (lo, hi)
+	DMADEVREG_VAL		= 6,	// fill value
+	DMADEVREG_CMD		= 7,	// command code, writing executes command
+	//---------------------------
+	DMADEVREG_END
+};
+
+// DMA device commands
+enum DmaDevCmds {
+	DMADEVCMD_COPY	= 0,	// copy LEN bytes from SRC to DST (may overlap)
+	DMADEVCMD_FILL	= 1,	// fill LEN bytes at DST with VAL
+	DMADEVCMD_BLIT	= 2		// draw LEN bytes of 1bpp bitmap from SRC on
+												// graphics display at bitmap offset DST
+};
+
+// offsets of VIA (6522) device registers
+enum ViaDevRegs {
+	VIADEVREG_ORB		= 0,	// output/input register B
+	VIADEVREG_ORA		= 1,	// output/input register A
+	VIADEVREG_DDRB	= 2,	// data direction register B
+	VIADEVREG_DDRA	= 3,	// data direction register A
+	VIADEVREG_T1CL	= 4,	// T1 latch low (write), counter low (read)
+	VIADEVREG_T1CH	= 5,	// T1 counter high, write loads and starts T1
+	VIADEVREG_T1LL	= 6,	// T1 latch low
+	VIADEVREG_T1LH	= 7,	// T1 latch high
+	VIADEVREG_T2CL	= 8,	// T2 latch low (write), counter low (read)
+	VIADEVREG_T2CH	= 9,	// T2 counter high, write loads and starts T2
+	VIADEVREG_SR		= 10,	// shift register
+	VIADEVREG_ACR		= 11,	// auxiliary control register
+	VIADEVREG_PCR		= 12,	// peripheral control register
+	VIADEVREG_IFR		= 13,	// interrupt flag register
+	VIADEVREG_IER		= 14,	// interrupt enable register
+	VIADEVREG_ORANH	= 15,	// register A, no handshake
+	//---------------------------
+	VIADEVREG_END
+};
+
+// VIA interrupt flags (IFR, IER bits)
+enum ViaDevIrqFlags {
+	VIAIRQ_CA2	= 0x01,
+	VIAIRQ_CA1	= 0x02,
+	VIAIRQ_SR		= 0x04,		// 8 bits shifted
+	VIAIRQ_CB2	= 0x08,
+	VIAIRQ_CB1	= 0x10,
+	VIAIRQ_T2		= 0x20,		// T2 time-out
+	VIAIRQ_T1		= 0x40,		// T1 time-out
+	VIAIRQ_ANY	= 0x80		// IFR: any enabled flag set, IER: set/clear
+};
+
+// VIA auxiliary control register bits
+enum ViaDevAcrBits {
+	VIAACR_SRMODE		= 0x1C,		// shift register mode (bits 2-4)
+	VIAACR_T2PULSE	= 0x20,		// T2 counts PB6 pulses
+	VIAACR_T1FREE		= 0x40,		// T1 continuous (free-run) mode
+	VIAACR_T1PB7		= 0x80		// T1 drives PB7
+};
+
+// VIA device state
+struct ViaDeviceRegs {
+	unsigned char	orb, ora, ddrb, ddra;
+	unsigned char	sr, acr, pcr, ifr, ier;
+	unsigned short t1latch;			// T1 latch
+	unsigned short t1start;			// T1 counter value at t1base cycle
+	unsigned long long t1base;	// cycle T1 counter was (re)loaded
+	bool					t1irq;				// one-shot T1 interrupt armed
+	bool					pb7;					// T1 PB7 output
+	unsigned char	t2latchlo;		// T2 latch low
+	unsigned short t2start;			// T2 counter value at t2base cycle
+	unsigned long long t2base;	// cycle T2 counter was loaded
+	bool					t2irq;				// T2 interrupt armed
+	unsigned long	t1evt, t2evt, srevt;	// handles of scheduled events
+};
+
+// offsets of ACIA (6551) device registers
+enum AciaDevRegs {
+	ACIADEVREG_DATA		= 0,	// transmit (write) / receive (read) data
+	ACIADEVREG_STATUS	= 1,	// status (read), programmed reset (write)
+	ACIADEVREG_CMD		= 2,	// command register
+	ACIADEVREG_CTRL		= 3,	// control register
+	//---------------------------
+	ACIADEVREG_END
+};
+
+// ACIA status register bits
+enum AciaDevStatusBits {
+	ACIASTAT_OVERRUN	= 0x04,
+	ACIASTAT_RDRF			= 0x08,		// receive data register full
+	ACIASTAT_TDRE			= 0x10,		// transmit data register empty
+	ACIASTAT_DCD			= 0x20,		// 1 - no carrier (host not connected)
+	ACIASTAT_DSR			= 0x40,		// 1 - data set not ready
+	ACIASTAT_IRQ			= 0x80		// interrupt occurred
+};
+
+// ACIA command register bits
+enum AciaDevCmdBits {
+	ACIACMD_DTR				= 0x01,		// 1 - receiver enabled
+	ACIACMD_IRD				= 0x02,		// 1 - receiver interrupt disabled
+	ACIACMD_TIC				= 0x0C,		// transmitter control
+	ACIACMD_TXIRQ			= 0x04,		// TIC value: transmit interrupt enabled
+	ACIACMD_ECHO			= 0x10,		// receiver echo mode
+	ACIACMD_PARITY		= 0x20		// parity enabled
+};
+
+// ACIA device state
+struct AciaDeviceRegs {
+	unsigned char	rxdata, txdata;
+	unsigned char	status, cmd, ctrl;
+	unsigned long	txevt, rxevt, pollevt;	// handles of scheduled events
+};
+
+// offsets of interrupt controller registers
+enum IntcDevRegs {
+	INTCDEVREG_PENDING	= 0,	// read: requesting sources, write: 1-s clear
+													//       triggered requests
+	INTCDEVREG_MASK			= 1,	// enabled sources (1 - enabled)
+	INTCDEVREG_ACTIVE		= 2,	// highest priority enabled source requesting
+													// interrupt ($FF - none)
+	INTCDEVREG_TRIGGER	= 3,	// write: 1-s request interrupt from sources
+	//---------------------------
+	INTCDEVREG_END
+};
+
+// offsets of disk controller registers
+enum DiskDevRegs {
+	DISKDEVREG_DRIVE	= 0,	// disk image # (0 - 9)
+	DISKDEVREG_TRACK	= 1,	// track # (1 - 35)
+	DISKDEVREG_SECTOR	= 2,	// sector # (0 - 20, depends on track)
+	DISKDEVREG_BUF		= 3,	// sector buffer address in memory (lo, hi)
+	DISKDEVREG_CMD		= 5,	// command code, writing starts command
+	DISKDEVREG_STATUS	= 6,	// status (read), bit 0 write: IRQ enable
+	//---------------------------
+	DISKDEVREG_END
+};
+
+// disk controller commands
+enum DiskDevCmds {
+	DISKDEVCMD_READ		= 0,	// read sector into the buffer
+	DISKDEVCMD_WRITE	= 1,	// write sector from the buffer
+	DISKDEVCMD_FLUSH	= 2,	// write back modified data of disk image
+	DISKDEVCMD_FORMAT	= 3,	// format disk image
+	DISKDEVCMD_SYNC		= 4,	// wait until all written data are on disk
+	DISKDEVCMD_FIND		= 5		// find file named in the buffer (16 chars,
+												// ends with 0 or $A0), set TRACK / SECTOR
+												// registers to its first sector
+};
+
+// disk controller status bits
+enum DiskDevStatusBits {
+	DISKSTAT_IRQEN		= 0x01,		// completion interrupt enabled
+	DISKSTAT_ERR			= 0x02,		// last command failed
+	DISKSTAT_IRQ			= 0x40,		// interrupt occurred (cleared by read)
+	DISKSTAT_BUSY			= 0x80		// command in progress
+};
+
+// disk controller state
+struct DiskDeviceRegs {
+	unsigned char	regs[DISKDEVREG_END];	// programmed registers
+	unsigned char	status;
+	unsigned char	cmd, drive, track, sector;	// command in progress
+	unsigned short buf;
+	unsigned long	cmdevt;								// handle of scheduled completion
 };
 
 // Functionality of memory mapped devices
-class MemMapDev {
+// events scheduled by devices
+enum MemMapDevEvents {
+	MMDEVEVT_PLUGDEV_TICK = 0,	// periodic Tick() of pluggable devices
+	MMDEVEVT_VIA_T1,						// VIA timer 1 time-out
+	MMDEVEVT_VIA_T2,						// VIA timer 2 time-out
+	MMDEVEVT_VIA_SR,						// VIA shift register done
+	MMDEVEVT_ACIA_TX,						// ACIA character transmitted
+	MMDEVEVT_ACIA_RX,						// ACIA character received
+	MMDEVEVT_ACIA_POLL,					// ACIA host link service
+	MMDEVEVT_DISK_DONE					// disk controller command completed
+};
+
+class MemMapDev : public EventHandler {
 
 	public:
 
@@ -257,6 +562,8 @@ class MemMapDev {
 		MemMapDev(Memory *pmem);
 		~MemMapDev();
 
+		void HandleEvent(int evtid, unsigned long long cycle);
+
 		Device GetDevice(int devnum);
 		int SetupDevice(int devnum, MemAddrRanges memranges, DevParams params);
 
@@ -269,19 +576,93 @@ class MemMapDev {
 		Display* ActivateCharIO();
 		Display* GetDispPtr();
 		void DeactivateCharIO();
-
-		int CharIODevice_Read(int addr);
-		void CharIODevice_Write(int addr, int val);
+		void EnableCharIOCapture(unsigned long maxlen);
+		void DisableCharIOCapture();
+		void ClearCharIOCapture();
+		bool IsCharIOCaptureActive();
+		string GetCharIOCapture();
+		unsigned long GetCharIOCaptCount();
+		unsigned long GetCharIOCaptHash();
+
+		int CharIOReg_GetCh(int addr);
+		int CharIOReg_GetChNb(int addr);
+		void CharIOReg_PutCh(int addr, int val);
 
 		unsigned short GetGraphDispAddrBase();
 		void ActivateGraphDisp();
 		void DeactivateGraphDisp();
 
-		int GraphDispDevice_Read(int addr);
-		void GraphDispDevice_Write(int addr, int val);
+		void GraphDispReg_Latch(int addr, int val);
+		void GraphDispReg_Cmd(int addr, int val);
+		void GraphDispReg_ChrTbl(int addr, int val);
+		void GraphDispReg_TxtCurX(int addr, int val);
+		void GraphDispReg_TxtCurY(int addr, int val);
+		void GraphDispReg_PutC(int addr, int val);
+		void GraphDispReg_CrsMode(int addr, int val);
+		void GraphDispReg_TxtMode(int addr, int val);
+		void GraphDispReg_BmpAddr(int addr, int val);
+		void GraphDispReg_BmpMode(int addr, int val);
 
 		void GraphDisp_ReadEvents();
 		void GraphDisp_Update();
+		void GraphDisp_Refresh();
+		unsigned long GraphDisp_GetPixelCount();
+		bool GraphDisp_GetCloseEvent();
+		void GraphDisp_ScanBitmap(bool force);
+		void SetGraphDispBackend(int backend);
+		int GraphDisp_SaveImage(string fname);
+		void GraphDisp_SetFrameDump(string prefix);
+
+		unsigned short GetDmaAddrBase();
+		void DmaReg_Latch(int addr, int val);
+		void DmaReg_Cmd(int addr, int val);
+		vector<unsigned char> DmaSaveState();
+		void DmaRestoreState(vector<unsigned char> state);
+
+		unsigned short GetViaAddrBase();
+		int ViaReg_Read(int addr);
+		void ViaReg_Write(int addr, int val);
+		void ViaReset();
+		vector<unsigned char> ViaSaveState();
+		void ViaRestoreState(vector<unsigned char> state);
+
+		unsigned short GetAciaAddrBase();
+		int AciaReg_Data(int addr);
+		int AciaReg_Status(int addr);
+		void AciaReg_Tx(int addr, int val);
+		void AciaReg_Reset(int addr, int val);
+		void AciaReg_Cmd(int addr, int val);
+		void AciaReg_Ctrl(int addr, int val);
+		void AciaReset();
+		void AciaFlush();
+		vector<unsigned char> AciaSaveState();
+		void AciaRestoreState(vector<unsigned char> state);
+		int AciaSetLink(int type, string path);
+		string GetAciaLinkName();
+
+		unsigned short GetIntcAddrBase();
+		int IntcReg_Read(int addr);
+		void IntcReg_Write(int addr, int val);
+
+		unsigned short GetDiskAddrBase();
+		void DiskReg_Latch(int addr, int val);
+		int DiskReg_Read(int addr);
+		void DiskReg_Cmd(int addr, int val);
+		void DiskReg_Status(int addr, int val);
+		void DiskReset();
+		vector<unsigned char> DiskSaveState();
+		void DiskRestoreState(vector<unsigned char> state);
+		MassStorage *GetDiskStorage();
+
+		int PlugDev_LoadLib(string libpath);
+		void PlugDev_RegisterType(string type, PlugDevCreateFn pfun);
+		int PlugDev_Create(string type, unsigned short addr, DevParams params);
+		int PlugDev_Read(int addr);
+		void PlugDev_Write(int addr, int val);
+		void PlugDev_Tick(unsigned long cycles);
+		int PlugDev_Count();
+		void PlugDev_SaveState(FILE *fp);
+		void PlugDev_RestoreState(FILE *fp);
 
 		//void SetCharIODispPtr(Display *p, bool active);
 
@@ -298,17 +679,61 @@ class MemMapDev {
 		unsigned int mCharIOAddr;
 		bool mIOEcho;		
 		unsigned int mGraphDispAddr;
+		int mGraphDispFps;					// graphics display frame rate
+		int mGraphDispBackend;			// graphics display backend type
+		string mGraphDispDumpPrefix;	// frame dump file name prefix
+		time_point<high_resolution_clock> mBmpLastScan;	// last bitmap scan
+		unsigned int mDmaAddr;			// DMA device base address
+		int mDmaByteCycles;					// CPU cycles taken per byte by DMA
+		unsigned char mDmaRegs[DMADEVREG_END];	// DMA device registers
+		unsigned int mViaAddr;			// VIA device base address
+		ViaDeviceRegs mViaRegs;			// VIA device state
+		unsigned int mAciaAddr;			// ACIA device base address
+		AciaDeviceRegs mAciaRegs;		// ACIA device state
+		SerialLink *mpAciaLink;			// ACIA host endpoint
+		unsigned long mAciaClock;		// CPU clock (Hz) for baud rate timing
+		unsigned int mIntcAddr;			// interrupt controller base address
+		unsigned int mDiskAddr;			// disk controller base address
+		unsigned long mDiskCmdCycles;	// CPU cycles taken by disk command
+		DiskDeviceRegs mDiskRegs;		// disk controller state
+		MassStorage *mpDiskStorage;	// disk images
 		GraphDisp *mpGraphDisp;			// pointer to Graphics Device object
 		Display   *mpCharIODisp;		// pointer to character I/O device object
 		bool			mCharIOActive;		// indicate if character I/O is active
 		GraphDeviceRegs mGrDevRegs;	// graphics display device registers
+		unsigned char *mGrDevRegPtr[GRAPHDEVREG_END];	// latch registers storage
 		unsigned int mCharTblAddr;	// start address of characters table
 		ConsoleIO *mpConsoleIO;
+		string    mCharIOCapt;				// captured char I/O output
+		unsigned long mCharIOCaptMax;	// capture size limit (bytes)
+		unsigned long mCharIOCaptCount;	// # of all bytes output
+		unsigned long mCharIOCaptHash;	// FNV-1a hash of all bytes output
+		bool      mCharIOCaptActive;	// indicate if output capture is on
+		PlugDevRegistry *mpPlugDevReg;	// pluggable device types
+		PlugDevMemHost *mpPlugDevHost;	// interface given to pluggable devices
+		vector<PlugDevEntry> mPlugDevs;	// pluggable devices
+		vector<short> mPlugDevRegs;			// device at each address (index in
+																		// mPlugDevs), -1 - none, empty if
+																		// no device was created
 
 		void Initialize();
 
 		unsigned char ReadCharKb(bool nonblock);
 		void PutCharIO(char c);		
+		void DmaBlit(unsigned short src, unsigned int offs, unsigned int len);
+		void ViaSetFlags(unsigned char flags);
+		unsigned short ViaT1Counter();
+		unsigned short ViaT2Counter();
+		void ViaStartT1(unsigned short count);
+		void ViaT1Timeout();
+		void ViaStartShift();
+		void ViaUpdateIrq();
+		unsigned long AciaCharCycles();
+		void AciaSetIrq(unsigned char cause);
+		void AciaStartRx();
+		void DiskComplete();
+		void PushDueIn(vector<unsigned char> &state, unsigned long evt);
+		unsigned long GetDueIn(vector<unsigned char> &state, int offs);
 		//void SetCurses();
 
 };
@@ -37,6 +37,7 @@
 
  *--------------------------------------------------------------------
  */
+#include <cstring>
 #include "Memory.h"
 #include "MKGenException.h"
 
@@ -81,6 +82,8 @@ Memory::Memory()
 Memory::~Memory()
 {
 	if (NULL != mpMemMapDev) delete mpMemMapDev;
+	if (NULL != mpIntCtrl) delete mpIntCtrl;
+	if (NULL != mpEvtSched) delete mpEvtSched;
 }
 
 /*
@@ -97,17 +100,34 @@ void Memory::Initialize()
 	for (int i=0; i < 0xFFFF; i++) {
 		m8bitMem[addr++] = 0;
 	}
-	for (int i=0; i < MEM_PAGE_SIZE; i++) {
+	for (int i=0; i < MEM_NUM_PAGES; i++) {
 		mMemPageDev[i] = -1;
 	}
+	mDevPageIdx.clear();
 	mCharIOAddr = CHARIO_ADDR;
 	mCharIOActive = false;
 	mIOEcho = false;
 	mROMBegin = ROM_BEGIN;
 	mROMEnd = ROM_END;
 	mROMActive = false;
+	mpEvtSched = new EventSched();
+	if (NULL == mpEvtSched)
+		throw MKGenException("Memory::Initialize() : Out of memory - EventSched");
+	mpIntCtrl = new IntCtrl(mpEvtSched);
+	if (NULL == mpIntCtrl)
+		throw MKGenException("Memory::Initialize() : Out of memory - IntCtrl");
 	mpMemMapDev = new MemMapDev(this);
 	mGraphDispActive = false;
+	mDirtyTrack = false;
+	memset(mDirtyBlk, 0, sizeof(mDirtyBlk));
+	mHeatMap = false;
+	memset(mPageStats, 0, sizeof(mPageStats));
+	mDMAActive = false;
+	mStallCycles = 0;
+	mVIAActive = false;
+	mACIAActive = false;
+	mIntCtrlActive = false;
+	mDiskActive = false;
 }
 
 /*
@@ -181,35 +201,36 @@ unsigned char Memory::Peek8bit(unsigned short addr)
 	// if memory address is in range of any active memory mapped
 	// devices, call corresponding device handling function
 	int mempg = addr / MEM_PAGE_SIZE;
+	if (mHeatMap) mPageStats[mempg].reads++;
 	if (mMemPageDev[mempg] >= 0) {
-		bool cont_loop = true;
-		for (vector<Device>::iterator devit = mActiveDeviceVec.begin();
-				 devit != mActiveDeviceVec.end() && cont_loop;
-				 ++devit
-				) {		   
-
-			if (devit->num >= 0) {
-				for (MemAddrRanges::iterator memrangeit = devit->addr_ranges.begin();
-					   memrangeit != devit->addr_ranges.end();
-					   ++memrangeit
-					  ) {				   
-					if (addr >= memrangeit->start_addr && addr <= memrangeit->end_addr) {
-						ReadFunPtr pfun = devit->read_fun_ptr;
-						if (pfun != NULL) {
-							cont_loop = false;
-							(mpMemMapDev->*pfun)((int)addr);
-							break;
-						}
-					}
-				}
-				mDispOp = (DEVNUM_GRDISP == devit->num);
-			}
+		DevPageIndex &pgidx = mDevPageIdx[mMemPageDev[mempg]];
+		int offs = addr % MEM_PAGE_SIZE;
+		ReadFunPtr pfun = pgidx.rdfun[offs];
+		if (pfun != NULL) {
+			if (mHeatMap) mPageStats[mempg].devhits++;
+			(mpMemMapDev->*pfun)((int)addr);
 		}
+		mDispOp = (DEVNUM_GRDISP == pgidx.rddev[offs]);
 	}
 		
 	return m8bitMem[addr];
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		Fetch8bit()
+ * Purpose:		Read op-code from memory. Same as Peek8bit(), but the
+ *            access is also counted as instruction fetch in heat map.
+ * Arguments:	addr - memory address
+ * Returns:		unsigned char value read from specified memory address
+ *--------------------------------------------------------------------
+ */
+unsigned char Memory::Fetch8bit(unsigned short addr)
+{
+	if (mHeatMap) mPageStats[addr / MEM_PAGE_SIZE].fetches++;
+	return Peek8bit(addr);
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		Peek8bitImg()
@@ -242,29 +263,17 @@ unsigned short Memory::Peek16bit(unsigned short addr)
 	// if memory address is in range of any active memory mapped
 	// devices, call corresponding device handling function
 	int mempg = addr / MEM_PAGE_SIZE;
-	if (mMemPageDev[mempg] >= 0) {	
-		bool cont_loop = true;
-		for (vector<Device>::iterator devit = mActiveDeviceVec.begin();
-			   devit != mActiveDeviceVec.end() && cont_loop;
-			   ++devit
-			  ) {		   
-			if (devit->num >= 0) {
-				for (MemAddrRanges::iterator memrangeit = devit->addr_ranges.begin();
-					   memrangeit != devit->addr_ranges.end();
-					   ++memrangeit
-					  ) {				   
-					if (addr >= memrangeit->start_addr && addr <= memrangeit->end_addr) {
-						ReadFunPtr pfun = devit->read_fun_ptr;
-						if (pfun != NULL) {
-							cont_loop = false;
-							(mpMemMapDev->*pfun)((int)addr);
-							break;
-						}
-					}
-				}
-				mDispOp = (DEVNUM_GRDISP == devit->num);
-			}
+	// one access, device handler is called for the low byte address only
+	if (mHeatMap) mPageStats[mempg].reads++;
+	if (mMemPageDev[mempg] >= 0) {
+		DevPageIndex &pgidx = mDevPageIdx[mMemPageDev[mempg]];
+		int offs = addr % MEM_PAGE_SIZE;
+		ReadFunPtr pfun = pgidx.rdfun[offs];
+		if (pfun != NULL) {
+			if (mHeatMap) mPageStats[mempg].devhits++;
+			(mpMemMapDev->*pfun)((int)addr);
 		}
+		mDispOp = (DEVNUM_GRDISP == pgidx.rddev[offs]);
 	}
 
 	ret = m8bitMem[addr++];
@@ -272,6 +281,24 @@ unsigned short Memory::Peek16bit(unsigned short addr)
 
 	return ret;
 }
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Peek16bitImg()
+ * Purpose:		Get/read 16-bit value from memory image only.
+ *            Memory mapped devices are not affected.
+ * Arguments:	addr - memory address
+ * Returns:		unsigned short value read from specified memory address
+ *            and next memory address (16-bit, little endian)
+ *--------------------------------------------------------------------
+ */
+unsigned short Memory::Peek16bitImg(unsigned short addr)
+{
+	unsigned short ret = m8bitMem[addr++];
+	ret += m8bitMem[addr] * 256;
+
+	return ret;
+}
 	
 /*
  *--------------------------------------------------------------------
@@ -291,33 +318,21 @@ void Memory::Poke8bit(unsigned short addr, unsigned char val)
 	// if memory address is in range of any active memory mapped
 	// devices, call corresponding device handling function
 	int mempg = addr / MEM_PAGE_SIZE;
-	if (mMemPageDev[mempg] >= 0) {	
-		bool cont_loop = true;
-		for (vector<Device>::iterator devit = mActiveDeviceVec.begin();
-			   devit != mActiveDeviceVec.end() && cont_loop;
-			   ++devit
-			  ) {			   
-			if (devit->num >= 0) {
-				for (MemAddrRanges::iterator memrangeit = devit->addr_ranges.begin();
-					   memrangeit != devit->addr_ranges.end();
-					   ++memrangeit
-					  ) {				   
-					if (addr >= memrangeit->start_addr && addr <= memrangeit->end_addr) {
-						WriteFunPtr pfun = devit->write_fun_ptr;
-						if (pfun != NULL) {
-							cont_loop = false;
-							(mpMemMapDev->*pfun)((int)addr,(int)val);
-							break;
-						}
-					}
-				}
-				mDispOp = (DEVNUM_GRDISP == devit->num);
-			}
+	if (mHeatMap) mPageStats[mempg].writes++;
+	if (mMemPageDev[mempg] >= 0) {
+		DevPageIndex &pgidx = mDevPageIdx[mMemPageDev[mempg]];
+		int offs = addr % MEM_PAGE_SIZE;
+		WriteFunPtr pfun = pgidx.wrfun[offs];
+		if (pfun != NULL) {
+			if (mHeatMap) mPageStats[mempg].devhits++;
+			(mpMemMapDev->*pfun)((int)addr,(int)val);
 		}
+		mDispOp = (DEVNUM_GRDISP == pgidx.wrdev[offs]);
 	}
 
 	if (!mROMActive || (addr < mROMBegin || addr > mROMEnd)) {
 		m8bitMem[addr] = val;
+		if (mDirtyTrack) mDirtyBlk[addr >> MEM_DIRTY_SHIFT] = 1;
 	}
 }
 
@@ -333,6 +348,7 @@ void Memory::Poke8bit(unsigned short addr, unsigned char val)
 void Memory::Poke8bitImg(unsigned short addr, unsigned char val)
 {
 	m8bitMem[addr] = val;
+	if (mDirtyTrack) mDirtyBlk[addr >> MEM_DIRTY_SHIFT] = 1;
 }
 
 /*
@@ -443,6 +459,56 @@ unsigned short Memory::GetGraphDispAddr()
 	return mpMemMapDev->GetGraphDispAddrBase();
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetDMA()
+ * Purpose:		Setup and activate DMA device.
+ * Arguments:	addr - base address of DMA device
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::SetDMA(unsigned short addr)
+{
+	AddrRange addr_range(addr, addr + DMADEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("nil","nil");
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);	
+
+	SetupDevice(DEVNUM_DMA, memaddr_ranges, dev_params);
+	if (false == mDMAActive) AddDevice(DEVNUM_DMA);
+	mDMAActive = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableDMA()
+ * Purpose:		Inactivate DMA device.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::DisableDMA()
+{
+	mDMAActive = false;
+	DeleteDevice(DEVNUM_DMA);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDMAAddr()
+ * Purpose:		Return base address of DMA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short Memory::GetDMAAddr()
+{
+	return mpMemMapDev->GetDmaAddrBase();
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		GetROMBegin()
@@ -511,20 +577,7 @@ int Memory::AddDevice(int devnum)
 		if (!found) {
 			mActiveDeviceVec.push_back(dev);
 			ret = devnum;
-
-			// update the device usage flag in memory pages devices array mMemPageDev
-			for (MemAddrRanges::iterator memrangeit = dev.addr_ranges.begin();
-				   memrangeit != dev.addr_ranges.end();
-				   ++memrangeit
-				  ) {			
-
-				int pgnum = memrangeit->start_addr / MEM_PAGE_SIZE;
-				while (pgnum < MEM_PAGE_SIZE) {
-					mMemPageDev[pgnum] = devnum;
-					pgnum++;
-					if (pgnum * MEM_PAGE_SIZE > memrangeit->end_addr) break;
-				}
-			}
+			RebuildDevIndex();
 		}
 	}	// END if (dev.num >= 0)
 	// else device with such number is not supported
@@ -532,6 +585,21 @@ int Memory::AddDevice(int devnum)
 	return ret;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDeviceAt()
+ * Purpose:		Find active device mapped at memory address.
+ * Arguments:	addr - memory address
+ * Returns:		int - device number, -1 if no active device uses addr
+ *--------------------------------------------------------------------
+ */
+int Memory::GetDeviceAt(unsigned short addr)
+{
+	int pgidx = mMemPageDev[addr / MEM_PAGE_SIZE];
+	if (pgidx < 0) return -1;
+	return mDevPageIdx[pgidx].devnum[addr % MEM_PAGE_SIZE];
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		DeleteDevice()
@@ -546,9 +614,6 @@ int Memory::DeleteDevice(int devnum)
 	vector<Device> actdev_new;
 	int ret = -1;
 
-	for (int i=0; i < MEM_PAGE_SIZE; i++) {
-		mMemPageDev[i] = -1;
-	}
 	// device is deleted by refreshing local active devices cache
 	// the device to be deleted is skipped and not re-added to refreshed
 	// cache vector
@@ -564,31 +629,76 @@ int Memory::DeleteDevice(int devnum)
 			if (dev.num < 0) 
 				throw MKGenException("Unsupported device in local cache");
 
-			actdev_new.push_back(mpMemMapDev->GetDevice(devit->num));
-
-			// update the device number in memory pages devices array mMemPageDev
-			for (MemAddrRanges::iterator memrangeit = devit->addr_ranges.begin();
-				   memrangeit != devit->addr_ranges.end();
-				   ++memrangeit
-				  ) {			
-
-				int pgnum = memrangeit->start_addr / MEM_PAGE_SIZE;
-				while (pgnum < MEM_PAGE_SIZE) {
-					mMemPageDev[pgnum] = devit->num;
-					pgnum++;
-					if (pgnum * MEM_PAGE_SIZE > memrangeit->end_addr) break;
-				}
-			}			
+			actdev_new.push_back(dev);
 
 		} else ret++;	// indicating that the device was found in cache
 	}
 	// refresh local active devices cache
 	mActiveDeviceVec.clear();
 	mActiveDeviceVec = actdev_new;
+	RebuildDevIndex();
 
 	return ret;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		RebuildDevIndex()
+ * Purpose:		Rebuild device pages array and per address handlers
+ *            of device pages from active devices cache. Must be
+ *            called each time the cache changes (device enabled,
+ *            disabled or moved), Peek/Poke use the index only.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::RebuildDevIndex()
+{
+	for (int i=0; i < MEM_NUM_PAGES; i++) {
+		mMemPageDev[i] = -1;
+	}
+	mDevPageIdx.clear();
+	for (vector<Device>::iterator devit = mActiveDeviceVec.begin();
+			 devit != mActiveDeviceVec.end();
+			 ++devit
+			) {
+		for (MemAddrRanges::iterator memrangeit = devit->addr_ranges.begin();
+				 memrangeit != devit->addr_ranges.end();
+				 ++memrangeit
+				) {
+			for (unsigned int addr = memrangeit->start_addr;
+					 addr <= memrangeit->end_addr;
+					 addr++
+					) {
+				int pgnum = addr / MEM_PAGE_SIZE;
+				if (mMemPageDev[pgnum] < 0) {
+					DevPageIndex pgidx;
+					for (int i=0; i < MEM_PAGE_SIZE; i++) {
+						pgidx.devnum[i] = pgidx.rddev[i] = pgidx.wrdev[i] = -1;
+						pgidx.rdfun[i] = NULL;
+						pgidx.wrfun[i] = NULL;
+					}
+					mMemPageDev[pgnum] = (int)mDevPageIdx.size();
+					mDevPageIdx.push_back(pgidx);
+				}
+				DevPageIndex &pgidx = mDevPageIdx[mMemPageDev[pgnum]];
+				int offs = addr % MEM_PAGE_SIZE;
+				// first device in cache with handler for address wins,
+				// same order as the active devices were searched before
+				if (pgidx.devnum[offs] < 0) pgidx.devnum[offs] = devit->num;
+				if (NULL == pgidx.rdfun[offs]) {
+					pgidx.rdfun[offs] = devit->GetReadFun((unsigned short)addr);
+					if (NULL != pgidx.rdfun[offs]) pgidx.rddev[offs] = devit->num;
+				}
+				if (NULL == pgidx.wrfun[offs]) {
+					pgidx.wrfun[offs] = devit->GetWriteFun((unsigned short)addr);
+					if (NULL != pgidx.wrfun[offs]) pgidx.wrdev[offs] = devit->num;
+				}
+			}
+		}
+	}
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		SetupDevice()
@@ -616,6 +726,256 @@ void Memory::SetupDevice(int devnum,
 	}
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		AddPlugDev()
+ * Purpose:		Create pluggable device and make it active.
+ * Arguments:	type - name of registered device type
+ *            addr - base address
+ *            params - device parameters
+ * Returns:		int - device number, -1 if device couldn't be created,
+ *                  -2 if address range overlaps active device
+ *--------------------------------------------------------------------
+ */
+int Memory::AddPlugDev(string type, unsigned short addr, DevParams params)
+{
+	int devnum = mpMemMapDev->PlugDev_Create(type, addr, params);
+	if (devnum >= 0) AddDevice(devnum);
+	return devnum;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetEventSched()
+ * Purpose:		Get scheduler of events timed in CPU cycles.
+ *            CPU advances its clock, devices schedule their actions.
+ * Arguments:	n/a
+ * Returns:		EventSched * - pointer to scheduler
+ *--------------------------------------------------------------------
+ */
+EventSched *Memory::GetEventSched()
+{
+	return mpEvtSched;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntCtrl()
+ * Purpose:		Get interrupt controller. Devices drive their IRQ
+ *            lines, CPU checks it before each instruction.
+ * Arguments:	n/a
+ * Returns:		IntCtrl * - pointer to interrupt controller
+ *--------------------------------------------------------------------
+ */
+IntCtrl *Memory::GetIntCtrl()
+{
+	return mpIntCtrl;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetVIA()
+ * Purpose:		Setup and activate VIA device.
+ * Arguments:	addr - base address of VIA device registers
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::SetVIA(unsigned short addr)
+{
+	AddrRange addr_range(addr, addr + VIADEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("nil","nil");
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+
+	SetupDevice(DEVNUM_VIA, memaddr_ranges, dev_params);
+	if (false == mVIAActive) AddDevice(DEVNUM_VIA);
+	mVIAActive = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableVIA()
+ * Purpose:		Deactivate VIA device, stop its timers.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::DisableVIA()
+{
+	mVIAActive = false;
+	DeleteDevice(DEVNUM_VIA);
+	mpMemMapDev->ViaReset();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetVIAAddr()
+ * Purpose:		Return base address of VIA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short Memory::GetVIAAddr()
+{
+	return mpMemMapDev->GetViaAddrBase();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetACIA()
+ * Purpose:		Setup and activate ACIA device.
+ * Arguments:	addr - base address of ACIA device registers
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::SetACIA(unsigned short addr)
+{
+	AddrRange addr_range(addr, addr + ACIADEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("nil","nil");
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+
+	SetupDevice(DEVNUM_ACIA, memaddr_ranges, dev_params);
+	if (false == mACIAActive) AddDevice(DEVNUM_ACIA);
+	mACIAActive = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableACIA()
+ * Purpose:		Deactivate ACIA device, abort transmission in progress.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::DisableACIA()
+{
+	mACIAActive = false;
+	DeleteDevice(DEVNUM_ACIA);
+	mpMemMapDev->AciaReset();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetACIAAddr()
+ * Purpose:		Return base address of ACIA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short Memory::GetACIAAddr()
+{
+	return mpMemMapDev->GetAciaAddrBase();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetIntCtrl()
+ * Purpose:		Setup and activate registers of interrupt controller.
+ * Arguments:	addr - base address of interrupt controller registers
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::SetIntCtrl(unsigned short addr)
+{
+	AddrRange addr_range(addr, addr + INTCDEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("nil","nil");
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+
+	SetupDevice(DEVNUM_INTC, memaddr_ranges, dev_params);
+	if (false == mIntCtrlActive) AddDevice(DEVNUM_INTC);
+	mIntCtrlActive = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableIntCtrl()
+ * Purpose:		Deactivate registers of interrupt controller.
+ *            Controller keeps passing interrupt requests to CPU.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::DisableIntCtrl()
+{
+	mIntCtrlActive = false;
+	DeleteDevice(DEVNUM_INTC);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntCtrlAddr()
+ * Purpose:		Return base address of interrupt controller registers.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short Memory::GetIntCtrlAddr()
+{
+	return mpMemMapDev->GetIntcAddrBase();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetDisk()
+ * Purpose:		Setup and activate disk controller.
+ * Arguments:	addr - base address of disk controller registers
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::SetDisk(unsigned short addr)
+{
+	AddrRange addr_range(addr, addr + DISKDEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("nil","nil");
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+
+	SetupDevice(DEVNUM_DISK, memaddr_ranges, dev_params);
+	if (false == mDiskActive) AddDevice(DEVNUM_DISK);
+	mDiskActive = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableDisk()
+ * Purpose:		Deactivate disk controller, abort command in progress.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::DisableDisk()
+{
+	mDiskActive = false;
+	DeleteDevice(DEVNUM_DISK);
+	mpMemMapDev->DiskReset();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskAddr()
+ * Purpose:		Return base address of disk controller.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short Memory::GetDiskAddr()
+{
+	return mpMemMapDev->GetDiskAddrBase();
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		GetCharIn()
@@ -699,4 +1059,273 @@ MemMapDev *Memory::GetMemMapDevPtr()
 	return mpMemMapDev;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableDirtyTrack()
+ * Purpose:		Start tracking of memory writes in blocks of
+ *            2^MEM_DIRTY_SHIFT bytes. All blocks start as dirty.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::EnableDirtyTrack()
+{
+	memset(mDirtyBlk, 1, sizeof(mDirtyBlk));
+	mDirtyTrack = true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableDirtyTrack()
+ * Purpose:		Stop tracking of memory writes.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::DisableDirtyTrack()
+{
+	mDirtyTrack = false;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		TestAndClearDirty()
+ * Purpose:		Check if memory block was written to since last test.
+ * Arguments:	addr - any address within the block
+ * Returns:		bool - true if block is dirty
+ *--------------------------------------------------------------------
+ */
+bool Memory::TestAndClearDirty(unsigned short addr)
+{
+	unsigned char *p = mDirtyBlk + (addr >> MEM_DIRTY_SHIFT);
+	bool ret = (*p != 0);
+	*p = 0;
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableHeatMap()
+ * Purpose:		Enable/disable counting of CPU memory accesses per page
+ *            (reads, writes, device hits, op-code fetches). Counters
+ *            are kept when disabled. Block transfers of devices
+ *            (DMA) are not counted.
+ * Arguments:	enheatmap - true = enable / false = disable
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::EnableHeatMap(bool enheatmap)
+{
+	mHeatMap = enheatmap;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsHeatMapEnabled()
+ * Purpose:		Check if memory accesses are counted.
+ * Arguments:	n/a
+ * Returns:		bool - true if enabled
+ *--------------------------------------------------------------------
+ */
+bool Memory::IsHeatMapEnabled()
+{
+	return mHeatMap;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetHeatMap()
+ * Purpose:		Zero memory access counters of all pages.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::ResetHeatMap()
+{
+	memset(mPageStats, 0, sizeof(mPageStats));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetPageStats()
+ * Purpose:		Get memory access counters of page.
+ * Arguments:	page - memory page # (0..MEM_NUM_PAGES-1)
+ * Returns:		MemPageStats - counters, zeroes if page # is invalid
+ *--------------------------------------------------------------------
+ */
+MemPageStats Memory::GetPageStats(int page)
+{
+	MemPageStats ret;
+	memset(&ret, 0, sizeof(ret));
+	if (page >= 0 && page < MEM_NUM_PAGES) ret = mPageStats[page];
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetDirtyRange()
+ * Purpose:		Mark memory blocks in address range as written to.
+ * Arguments:	addr - start address
+ *            len - # of bytes (wraps around at $FFFF)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::SetDirtyRange(unsigned short addr, unsigned int len)
+{
+	if (!mDirtyTrack || 0 == len) return;
+	unsigned int first = addr >> MEM_DIRTY_SHIFT;
+	unsigned int last = ((addr + len - 1) & MAX_8BIT_ADDR) >> MEM_DIRTY_SHIFT;
+	if (addr + len - 1 > MAX_8BIT_ADDR) {
+		memset(mDirtyBlk + first, 1, MEM_DIRTY_BLKS - first);
+		first = 0;
+	}
+	memset(mDirtyBlk + first, 1, last - first + 1);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		CopyBlock()
+ * Purpose:		Copy block of memory, source and destination may
+ *            overlap. Memory mapped devices are bypassed, ROM is
+ *            not written.
+ * Arguments:	dst - destination address
+ *            src - source address
+ *            len - # of bytes (addresses wrap around at $FFFF)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::CopyBlock(unsigned short dst, unsigned short src, unsigned int len)
+{
+	if (len > MAX_8BIT_ADDR + 1) len = MAX_8BIT_ADDR + 1;
+	bool romhit = mROMActive && dst <= mROMEnd
+								&& dst + len - 1 >= mROMBegin;
+	if (!romhit && src + len <= MAX_8BIT_ADDR + 1
+			&& dst + len <= MAX_8BIT_ADDR + 1) {
+		memmove(m8bitMem + dst, m8bitMem + src, len);
+	} else {
+		// wraps around or overlaps ROM, go through the copy of source
+		unsigned char *pbuf = new unsigned char[len];
+		if (NULL == pbuf)
+			throw MKGenException("Memory::CopyBlock() : Out of memory");
+		for (unsigned int i=0; i<len; i++) {
+			pbuf[i] = m8bitMem[(src + i) & MAX_8BIT_ADDR];
+		}
+		for (unsigned int i=0; i<len; i++) {
+			unsigned short addr = (unsigned short)(dst + i);
+			if (!mROMActive || (addr < mROMBegin || addr > mROMEnd))
+				m8bitMem[addr] = pbuf[i];
+		}
+		delete [] pbuf;
+	}
+	SetDirtyRange(dst, len);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		FillBlock()
+ * Purpose:		Fill block of memory with value. Memory mapped devices
+ *            are bypassed, ROM is not written.
+ * Arguments:	dst - destination address
+ *            val - fill value
+ *            len - # of bytes (addresses wrap around at $FFFF)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::FillBlock(unsigned short dst, unsigned char val, unsigned int len)
+{
+	if (len > MAX_8BIT_ADDR + 1) len = MAX_8BIT_ADDR + 1;
+	bool romhit = mROMActive && dst <= mROMEnd
+								&& dst + len - 1 >= mROMBegin;
+	if (!romhit && dst + len <= MAX_8BIT_ADDR + 1) {
+		memset(m8bitMem + dst, val, len);
+	} else {
+		for (unsigned int i=0; i<len; i++) {
+			unsigned short addr = (unsigned short)(dst + i);
+			if (!mROMActive || (addr < mROMBegin || addr > mROMEnd))
+				m8bitMem[addr] = val;
+		}
+	}
+	SetDirtyRange(dst, len);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ReadBlock()
+ * Purpose:		Copy block of memory to host buffer. Memory mapped
+ *            devices are bypassed.
+ * Arguments:	src - source address
+ *            buf - destination buffer
+ *            len - # of bytes (addresses wrap around at $FFFF)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::ReadBlock(unsigned short src, unsigned char *buf, unsigned int len)
+{
+	if (len > MAX_8BIT_ADDR + 1) len = MAX_8BIT_ADDR + 1;
+	if (src + len <= MAX_8BIT_ADDR + 1) {
+		memcpy(buf, m8bitMem + src, len);
+	} else {
+		for (unsigned int i=0; i<len; i++) {
+			buf[i] = m8bitMem[(src + i) & MAX_8BIT_ADDR];
+		}
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		WriteBlock()
+ * Purpose:		Copy host buffer to block of memory. Memory mapped
+ *            devices are bypassed, ROM is not written.
+ * Arguments:	dst - destination address
+ *            buf - source buffer
+ *            len - # of bytes (addresses wrap around at $FFFF)
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::WriteBlock(unsigned short dst, unsigned char *buf, unsigned int len)
+{
+	if (len > MAX_8BIT_ADDR + 1) len = MAX_8BIT_ADDR + 1;
+	bool romhit = mROMActive && dst <= mROMEnd
+								&& dst + len - 1 >= mROMBegin;
+	if (!romhit && dst + len <= MAX_8BIT_ADDR + 1) {
+		memcpy(m8bitMem + dst, buf, len);
+	} else {
+		for (unsigned int i=0; i<len; i++) {
+			unsigned short addr = (unsigned short)(dst + i);
+			if (!mROMActive || (addr < mROMBegin || addr > mROMEnd))
+				m8bitMem[addr] = buf[i];
+		}
+	}
+	SetDirtyRange(dst, len);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AddStallCycles()
+ * Purpose:		Add CPU cycles taken by a device from the bus (DMA).
+ *            CPU takes them after the current opcode.
+ * Arguments:	cycles - # of cycles
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void Memory::AddStallCycles(int cycles)
+{
+	mStallCycles += cycles;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		TakeStallCycles()
+ * Purpose:		Return and clear CPU cycles taken by devices.
+ * Arguments:	n/a
+ * Returns:		int - # of cycles
+ *--------------------------------------------------------------------
+ */
+int Memory::TakeStallCycles()
+{
+	int ret = mStallCycles;
+	mStallCycles = 0;
+	return ret;
+}
+
 } // namespace MKBasic
@@ -35,17 +35,43 @@
 
 #include "system.h"
 #include "MemMapDev.h"
+#include "EventSched.h"
+#include "IntCtrl.h"
 
 #define MAX_8BIT_ADDR 	0xFFFF
 #define MEM_PAGE_SIZE		0x100
 #define ROM_BEGIN				0xD000
 #define ROM_END					0xDFFF
 #define MIN_ROM_BEGIN		0x0200
+#define MEM_DIRTY_SHIFT	3				// dirty tracking granularity: 8 bytes
+#define MEM_DIRTY_BLKS	((MAX_8BIT_ADDR+1) >> MEM_DIRTY_SHIFT)
+#define MEM_NUM_PAGES		((MAX_8BIT_ADDR+1) / MEM_PAGE_SIZE)
 
 using namespace std;
 
 namespace MKBasic {
 
+// Memory access counters of one page (heat map cell).
+struct MemPageStats {
+	unsigned long long	reads;		// CPU reads (incl. op-code fetches, 16-bit
+																// read counts once, on page of low byte)
+	unsigned long long	writes;		// CPU writes
+	unsigned long long	devhits;	// reads/writes handled by memory mapped device
+	unsigned long long	fetches;	// op-code fetches
+};
+
+// Handlers of one memory page with active memory mapped devices,
+// indexed by address offset within the page. Built from the active
+// devices list by Memory::RebuildDevIndex(), first device in the list
+// wins where address ranges overlap.
+struct DevPageIndex {
+	int					devnum[MEM_PAGE_SIZE];	// device mapped at address or -1
+	int					rddev[MEM_PAGE_SIZE];		// device handling read or -1
+	ReadFunPtr	rdfun[MEM_PAGE_SIZE];		// read handler or NULL
+	int					wrdev[MEM_PAGE_SIZE];		// device handling write or -1
+	WriteFunPtr	wrfun[MEM_PAGE_SIZE];		// write handler or NULL
+};
+
 class Memory
 {
 	public:
@@ -56,7 +82,9 @@ class Memory
 		void	Initialize();
 		unsigned char Peek8bit(unsigned short addr);
 		unsigned char Peek8bitImg(unsigned short addr);
+		unsigned char Fetch8bit(unsigned short addr);		// read op-code
 		unsigned short Peek16bit(unsigned short addr);
+		unsigned short Peek16bitImg(unsigned short addr);
 		void Poke8bit(unsigned short addr, unsigned char val);		// write to memory and call memory mapped device handle
 		void Poke8bitImg(unsigned short addr, unsigned char val);	// write to memory image only
 		void SetCharIO(unsigned short addr, bool echo);
@@ -72,6 +100,7 @@ class Memory
 		unsigned short GetROMEnd();
 		bool IsROMEnabled();
 		int AddDevice(int devnum);
+		int GetDeviceAt(unsigned short addr);
 		int DeleteDevice(int devnum);
 		void SetupDevice(int devnum, MemAddrRanges memranges, DevParams params);
 
@@ -82,6 +111,37 @@ class Memory
 		void GraphDisp_Update();
 		bool GraphDispOp();
 		MemMapDev *GetMemMapDevPtr();
+		void EnableDirtyTrack();
+		void DisableDirtyTrack();
+		bool TestAndClearDirty(unsigned short addr);
+		void EnableHeatMap(bool enheatmap);
+		bool IsHeatMapEnabled();
+		void ResetHeatMap();
+		MemPageStats GetPageStats(int page);
+		void SetDMA(unsigned short addr);
+		void DisableDMA();
+		unsigned short GetDMAAddr();
+		void CopyBlock(unsigned short dst, unsigned short src, unsigned int len);
+		void FillBlock(unsigned short dst, unsigned char val, unsigned int len);
+		void ReadBlock(unsigned short src, unsigned char *buf, unsigned int len);
+		void WriteBlock(unsigned short dst, unsigned char *buf, unsigned int len);
+		void AddStallCycles(int cycles);
+		int TakeStallCycles();
+		int AddPlugDev(string type, unsigned short addr, DevParams params);
+		EventSched *GetEventSched();
+		IntCtrl *GetIntCtrl();
+		void SetVIA(unsigned short addr);
+		void DisableVIA();
+		unsigned short GetVIAAddr();
+		void SetACIA(unsigned short addr);
+		void DisableACIA();
+		unsigned short GetACIAAddr();
+		void SetIntCtrl(unsigned short addr);
+		void DisableIntCtrl();
+		unsigned short GetIntCtrlAddr();
+		void SetDisk(unsigned short addr);
+		void DisableDisk();
+		unsigned short GetDiskAddr();
 		
 	protected:
 		
@@ -91,8 +151,10 @@ class Memory
 		// array of device usage for each memory page
 		// this is performance optimization array that keeps values >= 0 under the
 		// indexes of memory pages where the memory mapped device is active or -1
-		// if there is no active device on given memory page
-		int mMemPageDev[MEM_PAGE_SIZE];
+		// if there is no active device on given memory page, the value is the
+		// index of the page handlers table in mDevPageIdx
+		int mMemPageDev[MEM_NUM_PAGES];
+		vector<DevPageIndex> mDevPageIdx;	// handlers of device pages
 		unsigned short mCharIOAddr;
 		bool mCharIOActive;
 		bool mIOEcho;
@@ -103,9 +165,23 @@ class Memory
 		MemMapDev *mpMemMapDev;						// pointer to MemMapDev object
 		bool mGraphDispActive;
 		bool mDispOp;
+		bool mDirtyTrack;									// tracking of written memory blocks
+		unsigned char mDirtyBlk[MEM_DIRTY_BLKS];	// written since last test
+		bool mHeatMap;										// counting of accesses per page
+		MemPageStats mPageStats[MEM_NUM_PAGES];	// heat map
+		bool mDMAActive;
+		int mStallCycles;									// CPU cycles taken by DMA
+		EventSched *mpEvtSched;						// events timed in CPU cycles
+		IntCtrl *mpIntCtrl;								// interrupt requests of devices
+		bool mVIAActive;
+		bool mACIAActive;
+		bool mIntCtrlActive;
+		bool mDiskActive;
 		
 		unsigned char ReadCharKb(bool nonblock);
 		void PutCharIO(char c);
+		void SetDirtyRange(unsigned short addr, unsigned int len);
+		void RebuildDevIndex();
 };
 
 } // namespace MKBasic
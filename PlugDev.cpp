@@ -0,0 +1,171 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			PlugDev.cpp
+ *
+ * Purpose: 		Implementation of PlugDevRegistry class.
+ *							Registry maps the names of pluggable device types to
+ *							the functions creating the device objects and loads
+ *							device types from shared libraries.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#include "PlugDev.h"
+#include "system.h"
+
+#if defined(WINDOWS)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace MKBasic {
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		PlugDevRegistry()
+ * Purpose:		Class default constructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+PlugDevRegistry::PlugDevRegistry()
+{
+	mCreateFuns.clear();
+	mLibs.clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~PlugDevRegistry()
+ * Purpose:		Class destructor. Unload libraries.
+ *            Devices created from loaded libraries must be deleted
+ *            before.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+PlugDevRegistry::~PlugDevRegistry()
+{
+	for (vector<void *>::iterator it = mLibs.begin(); it != mLibs.end(); ++it) {
+#if defined(WINDOWS)
+		FreeLibrary((HMODULE)*it);
+#else
+		dlclose(*it);
+#endif
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Register()
+ * Purpose:		Add device type to the registry. Type registered again
+ *            replaces the previous definition.
+ * Arguments:	type - name of device type
+ *            pfun - function creating the device object
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void PlugDevRegistry::Register(string type, PlugDevCreateFn pfun)
+{
+	mCreateFuns[type] = pfun;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsRegistered()
+ * Purpose:		Check if device type is known.
+ * Arguments:	type - name of device type
+ * Returns:		bool - true if registered
+ *--------------------------------------------------------------------
+ */
+bool PlugDevRegistry::IsRegistered(string type)
+{
+	return (mCreateFuns.find(type) != mCreateFuns.end());
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Create()
+ * Purpose:		Create device object of given type.
+ * Arguments:	type - name of device type
+ *            phost - interface to emulated system for the device
+ * Returns:		PlugDevice * - new device, NULL if type is unknown
+ *--------------------------------------------------------------------
+ */
+PlugDevice *PlugDevRegistry::Create(string type, PlugDevHost *phost)
+{
+	map<string, PlugDevCreateFn>::iterator it = mCreateFuns.find(type);
+	if (it == mCreateFuns.end() || NULL == it->second) return NULL;
+	return (it->second)(phost);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		LoadLib()
+ * Purpose:		Load shared library with device types. Library must
+ *            export PLUGDEV_VERSION_FN returning PLUGDEV_API_VERSION
+ *            and PLUGDEV_INIT_FN registering its device types.
+ * Arguments:	libpath - path to library file
+ * Returns:		int - PLUGDEVERR_OK or error code (ePlugDevErrors)
+ *--------------------------------------------------------------------
+ */
+int PlugDevRegistry::LoadLib(string libpath)
+{
+	PlugDevVersionFn pverfun = NULL;
+	PlugDevInitFn pinitfun = NULL;
+#if defined(WINDOWS)
+	HMODULE plib = LoadLibrary(libpath.c_str());
+	if (NULL == plib) return PLUGDEVERR_OPEN;
+	pverfun = (PlugDevVersionFn) GetProcAddress(plib, PLUGDEV_VERSION_FN);
+	pinitfun = (PlugDevInitFn) GetProcAddress(plib, PLUGDEV_INIT_FN);
+#else
+	void *plib = dlopen(libpath.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (NULL == plib) return PLUGDEVERR_OPEN;
+	pverfun = (PlugDevVersionFn) dlsym(plib, PLUGDEV_VERSION_FN);
+	pinitfun = (PlugDevInitFn) dlsym(plib, PLUGDEV_INIT_FN);
+#endif
+	int ret = PLUGDEVERR_OK;
+	// types registered by library that failed to initialize are dropped
+	map<string, PlugDevCreateFn> prev_funs = mCreateFuns;
+	if (NULL == pverfun || NULL == pinitfun) {
+		ret = PLUGDEVERR_SYMBOL;
+	} else if (PLUGDEV_API_VERSION != pverfun()) {
+		ret = PLUGDEVERR_VERSION;
+	} else if (0 != pinitfun(this)) {
+		ret = PLUGDEVERR_INIT;
+		mCreateFuns = prev_funs;
+	}
+	if (PLUGDEVERR_OK == ret) {
+		mLibs.push_back((void *)plib);
+	} else {
+#if defined(WINDOWS)
+		FreeLibrary(plib);
+#else
+		dlclose(plib);
+#endif
+	}
+	return ret;
+}
+
+} // namespace MKBasic
@@ -0,0 +1,131 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			PlugDev.h
+ *
+ * Purpose: 		Prototype of PlugDevice interface of pluggable memory
+ *							mapped devices, PlugDevHost interface through which
+ *							the device accesses emulated system and
+ *							PlugDevRegistry of device types (built-in or loaded
+ *							from shared libraries).
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#ifndef PLUGDEV_H
+#define PLUGDEV_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+// Version of the interface, device library built against different
+// version is not loaded.
+#define PLUGDEV_API_VERSION	1
+// Functions exported by device library (extern "C"):
+//   int VM65PlugDevApiVersion() - return PLUGDEV_API_VERSION
+//   int VM65PlugDevInit(PlugDevRegistry *preg) - register device types,
+//                                                return 0 if OK
+#define PLUGDEV_VERSION_FN	"VM65PlugDevApiVersion"
+#define PLUGDEV_INIT_FN			"VM65PlugDevInit"
+
+using namespace std;
+
+namespace MKBasic {
+
+// Emulated system as seen by the device.
+class PlugDevHost {
+
+	public:
+
+		virtual ~PlugDevHost() {}
+		// access memory image (memory mapped devices are not triggered)
+		virtual unsigned char Peek(unsigned short addr) = 0;
+		virtual void Poke(unsigned short addr, unsigned char val) = 0;
+		// take CPU cycles (e.g.: bus taken by DMA transfer)
+		virtual void StallCycles(int cycles) = 0;
+
+};
+
+// Pluggable memory mapped device.
+// Registers are addressed by offset from the device base address.
+class PlugDevice {
+
+	public:
+
+		virtual ~PlugDevice() {}
+		// # of registers (memory locations) the device occupies
+		virtual int GetNumRegs() = 0;
+		// parameters from memory definition file (name=value)
+		virtual void Setup(vector<pair<string,string> > params) {}
+		// register read, returned value is placed in memory
+		virtual int Read(int reg) = 0;
+		// register write
+		virtual void Write(int reg, int val) = 0;
+		// called periodically with # of CPU cycles elapsed
+		virtual void Tick(unsigned long cycles) {}
+		// state for the memory snapshot
+		virtual vector<unsigned char> SaveState() { return vector<unsigned char>(); }
+		virtual void RestoreState(vector<unsigned char> state) {}
+
+};
+
+typedef PlugDevice *(*PlugDevCreateFn)(PlugDevHost *phost);
+typedef int (*PlugDevVersionFn)();
+
+class PlugDevRegistry;
+typedef int (*PlugDevInitFn)(PlugDevRegistry *preg);
+
+// Types of pluggable devices.
+class PlugDevRegistry {
+
+	public:
+
+		PlugDevRegistry();
+		virtual ~PlugDevRegistry();
+
+		// virtual, so device library calls it with no link time
+		// dependency on the emulator executable
+		virtual void Register(string type, PlugDevCreateFn pfun);
+		bool IsRegistered(string type);
+		PlugDevice *Create(string type, PlugDevHost *phost);
+		int LoadLib(string libpath);
+
+	private:
+
+		map<string, PlugDevCreateFn> mCreateFuns;	// device type factories
+		vector<void *> mLibs;											// loaded libraries handles
+
+};
+
+// Plugin load errors
+enum ePlugDevErrors {
+	PLUGDEVERR_OK = 0,			// all is good
+	PLUGDEVERR_OPEN,				// unable to open library
+	PLUGDEVERR_SYMBOL,			// library does not export entry functions
+	PLUGDEVERR_VERSION,			// interface version mismatch
+	PLUGDEVERR_INIT					// library initialization failed
+};
+
+} // namespace MKBasic
+
+#endif
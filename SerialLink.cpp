@@ -0,0 +1,369 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			SerialLink.cpp
+ *
+ * Purpose: 		Implementation of SerialLink class.
+ *							Data is exchanged with host in chunks during Poll(),
+ *							emulated device only accesses the buffers.
+ *							Host endpoints are supported on Linux only.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#include <string.h>
+#include "SerialLink.h"
+
+#if defined(LINUX)
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace MKBasic {
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SerialLink()
+ * Purpose:		Class default constructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+SerialLink::SerialLink()
+{
+	mType = SERLINK_NONE;
+	mFd = mConnFd = -1;
+	mName.clear();
+	mLinkPath.clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~SerialLink()
+ * Purpose:		Class destructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+SerialLink::~SerialLink()
+{
+	Close();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		OpenPty()
+ * Purpose:		Create pseudo-terminal in raw mode. Host programs use
+ *            its slave device (see GetName()).
+ * Arguments:	linkpath - if not empty, symbolic link to the slave
+ *                       device is created under this path
+ * Returns:		int - 0 if OK, -1 if error
+ *--------------------------------------------------------------------
+ */
+int SerialLink::OpenPty(string linkpath)
+{
+	Close();
+#if defined(LINUX)
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fd < 0) return -1;
+	if (grantpt(fd) < 0 || unlockpt(fd) < 0 || NULL == ptsname(fd)) {
+		close(fd);
+		return -1;
+	}
+	mName = ptsname(fd);
+	// slave stays open, so the master doesn't fail when host side closes
+	int sfd = open(mName.c_str(), O_RDWR | O_NOCTTY);
+	if (sfd < 0) {
+		close(fd);
+		return -1;
+	}
+	struct termios tio;
+	if (0 == tcgetattr(sfd, &tio)) {
+		cfmakeraw(&tio);
+		tcsetattr(sfd, TCSANOW, &tio);
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	mFd = fd;
+	mConnFd = sfd;
+	mType = SERLINK_PTY;
+	if (linkpath.length() > 0) {
+		unlink(linkpath.c_str());
+		if (0 == symlink(mName.c_str(), linkpath.c_str())) mLinkPath = linkpath;
+	}
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		OpenSocket()
+ * Purpose:		Listen on Unix domain socket. One client at a time is
+ *            connected, next one is accepted when it disconnects.
+ * Arguments:	path - socket path (existing file is replaced)
+ * Returns:		int - 0 if OK, -1 if error
+ *--------------------------------------------------------------------
+ */
+int SerialLink::OpenSocket(string path)
+{
+	Close();
+#if defined(LINUX)
+	struct sockaddr_un addr;
+	if (path.length() == 0 || path.length() >= sizeof(addr.sun_path)) return -1;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	unlink(path.c_str());
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+			|| listen(fd, 1) < 0) {
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	mFd = fd;
+	mConnFd = -1;
+	mName = path;
+	mType = SERLINK_SOCKET;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Close()
+ * Purpose:		Send buffered data and close host endpoint.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SerialLink::Close()
+{
+#if defined(LINUX)
+	if (SERLINK_NONE != mType) Flush();
+	if (mConnFd >= 0) close(mConnFd);
+	if (mFd >= 0) close(mFd);
+	if (SERLINK_SOCKET == mType) unlink(mName.c_str());
+	if (mLinkPath.length() > 0) unlink(mLinkPath.c_str());
+#endif
+	mFd = mConnFd = -1;
+	mType = SERLINK_NONE;
+	mName.clear();
+	mLinkPath.clear();
+	mRxBuf.clear();
+	mTxBuf.clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetType()
+ * Purpose:		Get type of host endpoint.
+ * Arguments:	n/a
+ * Returns:		int - eSerialLinkTypes
+ *--------------------------------------------------------------------
+ */
+int SerialLink::GetType()
+{
+	return mType;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsConnected()
+ * Purpose:		Check if there is a host side peer (pty is always
+ *            considered connected).
+ * Arguments:	n/a
+ * Returns:		bool - true if connected
+ *--------------------------------------------------------------------
+ */
+bool SerialLink::IsConnected()
+{
+	return (SERLINK_PTY == mType || (SERLINK_SOCKET == mType && mConnFd >= 0));
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetName()
+ * Purpose:		Get name of host endpoint.
+ * Arguments:	n/a
+ * Returns:		string - pty slave device or socket path
+ *--------------------------------------------------------------------
+ */
+string SerialLink::GetName()
+{
+	return mName;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Poll()
+ * Purpose:		Exchange data with host: accept client, send TX
+ *            buffer, read available data to RX buffer.
+ * Arguments:	n/a
+ * Returns:		int - # of bytes in RX buffer
+ *--------------------------------------------------------------------
+ */
+int SerialLink::Poll()
+{
+#if defined(LINUX)
+	if (SERLINK_SOCKET == mType && mConnFd < 0) {
+		int cfd = accept(mFd, NULL, NULL);
+		if (cfd >= 0) {
+			fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+			mConnFd = cfd;
+		}
+	}
+	WriteHost();
+	ReadHost();
+#endif
+	return (int) mRxBuf.size();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		RxEmpty()
+ * Purpose:		Check if there is received data.
+ * Arguments:	n/a
+ * Returns:		bool - true if RX buffer is empty
+ *--------------------------------------------------------------------
+ */
+bool SerialLink::RxEmpty()
+{
+	return mRxBuf.empty();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		RxGet()
+ * Purpose:		Take byte from RX buffer.
+ * Arguments:	n/a
+ * Returns:		unsigned char - byte, 0 if buffer is empty
+ *--------------------------------------------------------------------
+ */
+unsigned char SerialLink::RxGet()
+{
+	unsigned char ret = 0;
+	if (!mRxBuf.empty()) {
+		ret = mRxBuf.front();
+		mRxBuf.pop_front();
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		TxPut()
+ * Purpose:		Put byte to TX buffer, buffer is sent to host when
+ *            it reaches SERLINK_TXFLUSH bytes or during Poll().
+ *            Bytes over SERLINK_BUFMAX are dropped.
+ * Arguments:	c - byte
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SerialLink::TxPut(unsigned char c)
+{
+	if (mTxBuf.size() < SERLINK_BUFMAX) mTxBuf.push_back(c);
+	if (mTxBuf.size() >= SERLINK_TXFLUSH) WriteHost();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Flush()
+ * Purpose:		Send as much of TX buffer to host as it accepts.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SerialLink::Flush()
+{
+	WriteHost();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ReadHost()
+ * Purpose:		Read available data from host to RX buffer.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SerialLink::ReadHost()
+{
+#if defined(LINUX)
+	int fd = (SERLINK_PTY == mType) ? mFd : mConnFd;
+	unsigned char buf[SERLINK_CHUNK];
+	while (fd >= 0 && mRxBuf.size() < SERLINK_BUFMAX) {
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n > 0) {
+			mRxBuf.insert(mRxBuf.end(), buf, buf + n);
+			if (n < (ssize_t) sizeof(buf)) break;
+		} else {
+			// client disconnected, wait for next one
+			if (SERLINK_SOCKET == mType
+					&& (0 == n || (EAGAIN != errno && EWOULDBLOCK != errno))) {
+				close(mConnFd);
+				mConnFd = -1;
+			}
+			break;
+		}
+	}
+#endif
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		WriteHost()
+ * Purpose:		Write TX buffer to host, data not accepted stays in
+ *            the buffer. Without socket client the data is kept.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SerialLink::WriteHost()
+{
+#if defined(LINUX)
+	int fd = (SERLINK_PTY == mType) ? mFd : mConnFd;
+	size_t sent = 0;
+	while (fd >= 0 && sent < mTxBuf.size()) {
+		size_t len = mTxBuf.size() - sent;
+		if (len > SERLINK_CHUNK) len = SERLINK_CHUNK;
+		ssize_t n = (SERLINK_SOCKET == mType)
+								? send(fd, &mTxBuf[sent], len, MSG_NOSIGNAL)
+								: write(fd, &mTxBuf[sent], len);
+		if (n <= 0) break;
+		sent += n;
+	}
+	if (sent > 0) mTxBuf.erase(mTxBuf.begin(), mTxBuf.begin() + sent);
+#endif
+}
+
+} // namespace MKBasic
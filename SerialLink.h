@@ -0,0 +1,91 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			SerialLink.h
+ *
+ * Purpose: 		Prototype of SerialLink class - host side endpoint of
+ *							emulated serial port: pseudo-terminal or Unix domain
+ *							socket, with buffered non-blocking I/O.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#ifndef SERIALLINK_H
+#define SERIALLINK_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include "system.h"
+
+#define SERLINK_CHUNK		4096			// max. # of bytes per host read/write
+#define SERLINK_TXFLUSH	4096			// write to host when TX buffer reaches
+#define SERLINK_BUFMAX	0x100000	// limit of each buffer (1 MB)
+
+using namespace std;
+
+namespace MKBasic {
+
+// Types of host endpoint
+enum eSerialLinkTypes {
+	SERLINK_NONE = 0,			// not connected
+	SERLINK_PTY,					// pseudo-terminal
+	SERLINK_SOCKET				// Unix domain socket (server)
+};
+
+class SerialLink {
+
+	public:
+
+		SerialLink();
+		~SerialLink();
+
+		int OpenPty(string linkpath);
+		int OpenSocket(string path);
+		void Close();
+		int GetType();
+		bool IsConnected();
+		string GetName();
+		int Poll();
+		bool RxEmpty();
+		unsigned char RxGet();
+		void TxPut(unsigned char c);
+		void Flush();
+
+	private:
+
+		int mType;									// eSerialLinkTypes
+		int mFd;										// pty master or listening socket
+		int mConnFd;								// pty slave (kept open) or connected client
+		string mName;								// pty slave device or socket path
+		string mLinkPath;						// symbolic link to pty slave
+		deque<unsigned char> mRxBuf;	// received from host
+		vector<unsigned char> mTxBuf;	// to be sent to host
+
+		void ReadHost();
+		void WriteHost();
+
+};
+
+} // namespace MKBasic
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			SymTab.cpp
+ *
+ * Purpose: 		Implementation of SymTab class.
+ *							Symbols (labels) are read from assembler listings
+ *							or label files and kept sorted by address, so the
+ *							nearest symbol at or below an address is found by
+ *							binary search.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include "SymTab.h"
+
+namespace MKBasic {
+
+// Column of source text in ca65 and AS65 listings.
+#define LST_SRC_COL	24
+
+static bool SymbolAddrLess(const Symbol &a, const Symbol &b)
+{
+	return (a.addr < b.addr);
+}
+
+static bool IsIdentChar(char c)
+{
+	return (isalnum((unsigned char)c) || '_' == c || '.' == c || '@' == c);
+}
+
+// Check if text starts with n hexadecimal digits.
+static bool IsHexField(const char *p, int n)
+{
+	for (int i = 0; i < n; i++) {
+		if (!isxdigit((unsigned char)p[i])) return false;
+	}
+	return true;
+}
+
+// Copy identifier at p to name, return pointer past it.
+static const char *GetIdent(const char *p, string &name)
+{
+	const char *start = p;
+	while (IsIdentChar(*p)) p++;
+	name.assign(start, p - start);
+	return p;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SymTab()
+ * Purpose:		Class default constructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+SymTab::SymTab()
+{
+	mSymbols.clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		~SymTab()
+ * Purpose:		Class destructor.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+SymTab::~SymTab()
+{
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ParseLine()
+ * Purpose:		Extract symbol from line of listing or label file.
+ *            Only labels bound to addresses are taken, constants
+ *            (e.g.: AS65 "0001 = flag = 1") and ca65 relocatable
+ *            addresses ("000000r") are skipped, as well as ca65
+ *            cheap local labels (@name).
+ * Arguments:	line - text line
+ *            sym - symbol found
+ * Returns:		bool - true if line defines symbol
+ *--------------------------------------------------------------------
+ */
+bool SymTab::ParseLine(const char *line, Symbol &sym)
+{
+	const char *p = NULL;
+	unsigned int addr = 0;
+	int len = (int) strlen(line);
+
+	sym.name.clear();
+	if (0 == strncmp(line, "al ", 3)) {
+		// VICE label file: al 00C000 .LABEL
+		p = line + 3;
+		while (isspace((unsigned char)*p)) p++;
+		if (1 != sscanf(p, "%x", &addr)) return false;
+		while (isxdigit((unsigned char)*p)) p++;
+		while (isspace((unsigned char)*p)) p++;
+		if ('.' == *p) p++;
+		GetIdent(p, sym.name);
+	} else if (len > LST_SRC_COL && IsHexField(line, 6) && ' ' == line[6]) {
+		// ca65 listing, label followed by ':' anywhere in source column
+		sscanf(line, "%6x", &addr);
+		p = line + LST_SRC_COL;
+		while (' ' == *p || '\t' == *p) p++;
+		if ('@' == *p) return false;
+		p = GetIdent(p, sym.name);
+		if (':' != *p) return false;
+	} else if (len > LST_SRC_COL && IsHexField(line, 4)
+							&& 0 == strncmp(line + 4, " : ", 3)) {
+		// AS65 listing, label starts in source column
+		sscanf(line, "%4x", &addr);
+		p = line + LST_SRC_COL;
+		if (!isalpha((unsigned char)*p) && '_' != *p) return false;
+		GetIdent(p, sym.name);
+	} else {
+		// assignment: LABEL = $C000 (also := )
+		p = line;
+		while (isspace((unsigned char)*p)) p++;
+		if (!isalpha((unsigned char)*p) && '_' != *p) return false;
+		p = GetIdent(p, sym.name);
+		while (' ' == *p || '\t' == *p) p++;
+		if (':' == *p) p++;
+		if ('=' != *p++) return false;
+		while (' ' == *p || '\t' == *p) p++;
+		if ('$' != *p || 1 != sscanf(p + 1, "%x", &addr)) return false;
+	}
+	if (sym.name.empty() || addr > 0xFFFF) return false;
+	if (!isalpha((unsigned char)sym.name[0]) && '_' != sym.name[0]) return false;
+	if (sym.name.length() > SYMTAB_NAME_LEN) sym.name.resize(SYMTAB_NAME_LEN);
+	sym.addr = (unsigned short) addr;
+
+	return true;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Sort()
+ * Purpose:		Sort symbols by address. Of the symbols defined at the
+ *            same address the one loaded first is kept.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SymTab::Sort()
+{
+	stable_sort(mSymbols.begin(), mSymbols.end(), SymbolAddrLess);
+	vector<Symbol>::iterator it = unique(mSymbols.begin(), mSymbols.end(),
+		[](const Symbol &a, const Symbol &b) { return a.addr == b.addr; });
+	mSymbols.erase(it, mSymbols.end());
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Load()
+ * Purpose:		Add symbols from assembler listing or label file to
+ *            the table. Symbols of addresses already in the table
+ *            are ignored.
+ * Arguments:	fname - file name
+ * Returns:		int - # of symbols in file, -1 if file can't be opened
+ *--------------------------------------------------------------------
+ */
+int SymTab::Load(string fname)
+{
+	char line[512];
+	int ret = 0;
+
+	FILE *fp = fopen(fname.c_str(), "r");
+	if (NULL == fp) return -1;
+	while (NULL != fgets(line, sizeof(line), fp)) {
+		Symbol sym;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (ParseLine(line, sym)) {
+			mSymbols.push_back(sym);
+			ret++;
+		}
+	}
+	fclose(fp);
+	Sort();
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Clear()
+ * Purpose:		Remove all symbols.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void SymTab::Clear()
+{
+	mSymbols.clear();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetCount()
+ * Purpose:		Get # of symbols in the table.
+ * Arguments:	n/a
+ * Returns:		int - # of symbols
+ *--------------------------------------------------------------------
+ */
+int SymTab::GetCount()
+{
+	return (int) mSymbols.size();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Label()
+ * Purpose:		Get symbol defined exactly at address.
+ * Arguments:	addr - address
+ * Returns:		string - symbol name, empty if none
+ *--------------------------------------------------------------------
+ */
+string SymTab::Label(unsigned short addr)
+{
+	Symbol key;
+	key.addr = addr;
+	vector<Symbol>::iterator it = lower_bound(mSymbols.begin(), mSymbols.end(),
+																						key, SymbolAddrLess);
+	if (it == mSymbols.end() || it->addr != addr) return "";
+	return it->name;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AddrName()
+ * Purpose:		Name address after the nearest symbol at or below it,
+ *            e.g.: LABEL, LABEL+$1A. Addresses more than
+ *            SYMTAB_MAX_OFFS bytes past the symbol are not named.
+ * Arguments:	addr - address
+ * Returns:		string - label+offset, empty if no symbol is near
+ *--------------------------------------------------------------------
+ */
+string SymTab::AddrName(unsigned short addr)
+{
+	Symbol key;
+	char offs[8];
+	key.addr = addr;
+	vector<Symbol>::iterator it = upper_bound(mSymbols.begin(), mSymbols.end(),
+																						key, SymbolAddrLess);
+	if (it == mSymbols.begin()) return "";
+	--it;
+	int diff = addr - it->addr;
+	if (diff > SYMTAB_MAX_OFFS) return "";
+	if (0 == diff) return it->name;
+	sprintf(offs, "+$%X", diff);
+	return it->name + offs;
+}
+
+} // namespace MKBasic
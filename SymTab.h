@@ -0,0 +1,82 @@
+/*
+ *--------------------------------------------------------------------
+ * Project:     VM65 - Virtual Machine/CPU emulator programming
+ *                     framework.
+ *
+ * File:   			SymTab.h
+ *
+ * Purpose: 		Prototype of SymTab class - table of program symbols
+ *							(labels) loaded from assembler listings or label
+ *							files, used to show addresses as label+offset.
+ *
+ * Date:      	10/19/2026
+ *
+ * Copyright:  (C) by VM65 contributors 2026. All rights reserved.
+ *
+ * License Agreement and Warranty:
+
+   This software is provided with No Warranty.
+   The authors will not be held responsible for any damage to
+   computer systems, data or user's health resulting from use.
+   Please proceed responsibly and apply common sense.
+   This software is provided in hope that it will be useful.
+   It is free of charge for non-commercial and educational use.
+   Distribution of this software in non-commercial and educational
+   derivative work is permitted under condition that original
+   copyright notices and comments are preserved. Some 3-rd party work
+   included with this project may require separate application for
+   permission from their respective authors/copyright owners.
+
+ *--------------------------------------------------------------------
+ */
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include <string>
+#include <vector>
+
+// address farther than this from the nearest symbol below is not named
+#define SYMTAB_MAX_OFFS	0x100
+#define SYMTAB_NAME_LEN	32		// longer symbol names are truncated
+
+using namespace std;
+
+namespace MKBasic {
+
+// Program symbol.
+struct Symbol {
+	unsigned short	addr;			// address
+	string					name;			// label
+};
+
+// Table of symbols, kept sorted by address.
+// Recognized input (format detected per line):
+//   ca65 listing (cl65 -l):     "00C000  1  A9 00     LABEL: lda #0"
+//   AS65 listing:               "c000 : a900          label   lda #0"
+//   VICE label file (ld65 -Ln): "al 00C000 .LABEL"
+//   label assignment:           "LABEL = $C000"
+class SymTab {
+
+	public:
+
+		SymTab();
+		~SymTab();
+
+		int Load(string fname);
+		void Clear();
+		int GetCount();
+		string Label(unsigned short addr);
+		string AddrName(unsigned short addr);
+
+	private:
+
+		vector<Symbol>	mSymbols;			// sorted by address, no duplicates
+
+		bool ParseLine(const char *line, Symbol &sym);
+		void Sort();
+
+};
+
+} // namespace MKBasic
+
+#endif
@@ -38,6 +38,7 @@
 #include <iostream>
 #include <sstream>
 #include <string.h>
+#include <math.h>
 #include "system.h"
 #include "VMachine.h"
 #include "MKGenException.h"
@@ -89,6 +90,7 @@ VMachine::~VMachine()
 	delete mpROM;
 	delete mpRAM;
 	delete mpConIO;
+	delete mpSymTab;
 }
 
 /*
@@ -108,6 +110,9 @@ void VMachine::InitVM()
 	mPerfStats.perf_onemhz = 0;
 	mPerfStats.prev_cycles = 0;
 	mPerfStats.prev_usec = 0;
+	mPerfStats.gr_pixels = 0;
+	mPerfStats.gr_usec = 0;
+	mPerfStats.gr_pixrate = 0;
 	mOldStyleHeader = false;
 	mError = VMERR_OK;
 	mAutoExec = false;	
@@ -115,6 +120,12 @@ void VMachine::InitVM()
 	mCharIOAddr = CHARIO_ADDR;
 	mCharIOActive = mCharIO = false;
 	mGraphDispActive = false;
+	mDMAActive = false;
+	mVIAActive = false;
+	mACIAActive = false;
+	mIntCtrlActive = false;
+	mDiskActive = false;
+	mPlugDevActive = false;
 	mPerfStatsActive = false;
 	mDebugTraceActive = false;
 	if (NULL == mpRAM) {
@@ -133,6 +144,10 @@ void VMachine::InitVM()
 	if (NULL == mpConIO) {
 		throw MKGenException("Unable to initialize VM (ConsoleIO)");
 	}
+	mpSymTab = new SymTab();
+	if (NULL == mpSymTab) {
+		throw MKGenException("Unable to initialize VM (SymTab)");
+	}
 	mBeginTime = high_resolution_clock::now();
 }
 
@@ -223,6 +238,34 @@ int VMachine::CalcCurrPerf()
 	return mPerfStats.perf_onemhz;
 } 
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		CalcGraphPerf()
+ * Purpose:		Present pending graphics display changes and calculate
+ *            graphics throughput (pixels/sec) of the last run.
+ * Arguments:	pixbegin - # of pixels drawn before the run
+ *            begin - the moment when the run started
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::CalcGraphPerf(unsigned long pixbegin,
+														 time_point<high_resolution_clock> begin)
+{
+	if (!mGraphDispActive) return;
+
+	MemMapDev *pdev = mpRAM->GetMemMapDevPtr();
+	pdev->GraphDisp_ScanBitmap(true);
+	pdev->GraphDisp_Refresh();
+	mPerfStats.gr_pixels = pdev->GraphDisp_GetPixelCount() - pixbegin;
+	mPerfStats.gr_usec = duration_cast<microseconds>
+												(high_resolution_clock::now()-begin).count();
+	mPerfStats.gr_pixrate = 0;
+	if (mPerfStats.gr_usec > 0) {
+		mPerfStats.gr_pixrate = (long)(((double)mPerfStats.gr_pixels * 1000000.0)
+																	/ (double)mPerfStats.gr_usec);
+	}
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		PERFSTAT_LAP (macro)
@@ -244,6 +287,30 @@ int VMachine::CalcCurrPerf()
 	}	\
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		GRAPHEVT_CHECK (macro)
+ * Purpose:		Check events of graphics display window, read by the
+ *            render thread, every GRAPHEVT_STEPS steps. Closing the
+ *            window interrupts the emulation, like operator interrupt.
+ *            Every GRAPHDEVBMP_STEPS steps let the device scan the
+ *            bitmap (bitmap mode, once per frame).
+ * Arguments:	steps - long : number of steps executed so far
+ * Returns:		n/a
+ * Remarks:		Call inside emulation execute loop.
+ *--------------------------------------------------------------------
+ */
+#define GRAPHEVT_CHECK(steps) \
+{	\
+	if (mGraphDispActive && ((steps) & (GRAPHDEVBMP_STEPS-1)) == 0) {	\
+		MemMapDev *pmmd = mpRAM->GetMemMapDevPtr();	\
+		pmmd->GraphDisp_ScanBitmap(false);	\
+		if (((steps) & (GRAPHEVT_STEPS-1)) == 0	\
+				&& pmmd->GraphDisp_GetCloseEvent())	\
+			mOpInterrupt = true;	\
+	}	\
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		Run()
@@ -256,21 +323,26 @@ Regs *VMachine::Run()
 {
 	Regs *cpureg = NULL;
 
-	AddDebugTrace("Running code at: $" + Addr2HexStr(mRunAddr));
+	AddDebugTrace("Running code at: $" + Addr2SymStr(mRunAddr));
 	mOpInterrupt = false;
 	mpConIO->InitCursesScr();
 	ClearScreen();
 	ShowDisp();
 	mPerfStats.cycles = 0;
 	mPerfStats.begin_time = high_resolution_clock::now();	
+	auto begin = mPerfStats.begin_time;
+	unsigned long pixbegin = mpRAM->GetMemMapDevPtr()->GraphDisp_GetPixelCount();
 	while (true) {
 		mPerfStats.cycles++;		
 		cpureg = Step();
 		if (cpureg->CyclesLeft == 0 && mCharIO)	ShowDisp();
+		GRAPHEVT_CHECK(mPerfStats.cycles);
 		if (cpureg->SoftIrq || mOpInterrupt) break;
 		PERFSTAT_LAP(mPerfStats.cycles,mPerfStats.begin_time);
 	}
 	CalcCurrPerf();
+	CalcGraphPerf(pixbegin, begin);
+	if (mACIAActive) mpRAM->GetMemMapDevPtr()->AciaFlush();
 
 	ShowDisp();	
 	mpConIO->CloseCursesScr();
@@ -306,20 +378,25 @@ Regs *VMachine::Exec()
 {
 	Regs *cpureg = NULL;
 
-	AddDebugTrace("Executing code at: $" + Addr2HexStr(mRunAddr));
+	AddDebugTrace("Executing code at: $" + Addr2SymStr(mRunAddr));
 	mOpInterrupt = false;
 	mpConIO->InitCursesScr();
 	ClearScreen();
 	ShowDisp();
 	mPerfStats.cycles = 0;
 	mPerfStats.begin_time = high_resolution_clock::now();
+	auto begin = mPerfStats.begin_time;
+	unsigned long pixbegin = mpRAM->GetMemMapDevPtr()->GraphDisp_GetPixelCount();
 	while (true) {
 		mPerfStats.cycles++;
 		cpureg = Step();
+		GRAPHEVT_CHECK(mPerfStats.cycles);
 		if (cpureg->LastRTS || mOpInterrupt) break;
 		PERFSTAT_LAP(mPerfStats.cycles,mPerfStats.begin_time);
 	}
 	CalcCurrPerf();
+	CalcGraphPerf(pixbegin, begin);
+	if (mACIAActive) mpRAM->GetMemMapDevPtr()->AciaFlush();
 
 	ShowDisp();	
 	mpConIO->CloseCursesScr();
@@ -327,6 +404,58 @@ Regs *VMachine::Exec()
 	return cpureg;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		RunBatch()
+ * Purpose:		Run VM non-interactively (no console screen refresh)
+ *            until last RTS, software break instruction, operator
+ *            interrupt or cycles limit, whichever comes first.
+ *            Intended for automated (regression) runs.
+ *            Exit at last RTS is enabled for the run, unless the
+ *            CPU is reset (reset code runs like after power on),
+ *            previous setting is restored when the run ends.
+ * Arguments:	reset - if true, perform CPU reset before running,
+ *                    otherwise start at current address
+ *            maxcycles - limit of executed clock ticks, 0 - no limit
+ * Returns:		Pointer to CPU registers and flags.
+ *--------------------------------------------------------------------
+ */
+Regs *VMachine::RunBatch(bool reset, unsigned long maxcycles)
+{
+	Regs *cpureg = NULL;
+	unsigned long cycles = 0;
+	bool exitrts = mpCPU->mExitAtLastRTS;
+
+	if (reset) {
+		mpCPU->Reset();
+		mRunAddr = mpCPU->GetRegs()->PtrAddr;
+		AddDebugTrace("*** CPU RESET ***");
+	} else {
+		mpCPU->mExitAtLastRTS = true;
+	}
+	AddDebugTrace("Batch run of code at: $" + Addr2SymStr(mRunAddr));
+	mOpInterrupt = false;
+	mPerfStats.cycles = 0;
+	mPerfStats.begin_time = high_resolution_clock::now();
+	auto begin = mPerfStats.begin_time;
+	unsigned long pixbegin = mpRAM->GetMemMapDevPtr()->GraphDisp_GetPixelCount();
+	while (true) {
+		mPerfStats.cycles++;
+		cycles++;
+		cpureg = Step();
+		GRAPHEVT_CHECK(mPerfStats.cycles);
+		if (cpureg->LastRTS || cpureg->SoftIrq || mOpInterrupt) break;
+		if (maxcycles > 0 && cycles >= maxcycles) break;
+		PERFSTAT_LAP(mPerfStats.cycles,mPerfStats.begin_time);
+	}
+	CalcCurrPerf();
+	CalcGraphPerf(pixbegin, begin);
+	if (mACIAActive) mpRAM->GetMemMapDevPtr()->AciaFlush();
+	mpCPU->mExitAtLastRTS = exitrts;
+
+	return cpureg;
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		GetPerfStats()
@@ -367,9 +496,6 @@ Regs *VMachine::Step()
 	Regs *cpureg = NULL;	
 	
 	cpureg = mpCPU->ExecOpcode(mRunAddr);
-	if (mGraphDispActive && cpureg->CyclesLeft == 0) {
-		mpRAM->GraphDisp_ReadEvents();
-	}
 	mRunAddr = cpureg->PtrAddr;
 	
 	return cpureg;
@@ -476,7 +602,24 @@ eMemoryImageTypes VMachine::GetMemoryImageType(string ramfname)
 				|| !strncmp(pc, "EXEC", 4)
 				|| !strncmp(pc, "RESET", 5)
 				|| !strncmp(pc, "ENGRAPH", 7)
-				|| !strncmp(pc, "GRAPHADDR", 9))
+				|| !strncmp(pc, "GRAPHADDR", 9)
+				|| !strncmp(pc, "GRAPHFPS", 8)
+				|| !strncmp(pc, "ENDMA", 5)
+				|| !strncmp(pc, "DMAADDR", 7)
+				|| !strncmp(pc, "DMACYCLES", 9)
+				|| !strncmp(pc, "ENVIA", 5)
+				|| !strncmp(pc, "VIAADDR", 7)
+				|| !strncmp(pc, "ENACIA", 6)
+				|| !strncmp(pc, "ACIAADDR", 8)
+				|| !strncmp(pc, "ACIALINK", 8)
+				|| !strncmp(pc, "ENINTC", 6)
+				|| !strncmp(pc, "INTCADDR", 8)
+				|| !strncmp(pc, "ENDISK", 6)
+				|| !strncmp(pc, "DISKADDR", 8)
+				|| !strncmp(pc, "DISKCYCLES", 10)
+				|| !strncmp(pc, "DEVLIB", 6)
+				|| !strncmp(pc, "SYMFILE", 7)
+				|| !strncmp(pc, "PLUGDEV", 7))
 			 )
 		{
 			ret = MEMIMG_VM65DEF;
@@ -585,7 +728,7 @@ bool VMachine::HasOldHdrData(FILE *fp)
  * It has following format:
  *
  * MAGIC_KEYWORD
- * aabbccddefghijklmm[remaining unused bytes]
+ * aabbccddefghijklmmnoopqqrsstuuvwwx[devices state][remaining unused bytes]
  *
  * Where:
  *    MAGIC_KEYWORD - text string indicating header, may vary between
@@ -614,6 +757,32 @@ bool VMachine::HasOldHdrData(FILE *fp)
  *    l - 0 if generic graphics display device is disabled,
  *        1 if graphics display is enabled
  *    mm - low and hi bytes of graphics display base address
+ *    n - 0 if DMA device is disabled, 1 if enabled
+ *    oo - low and hi bytes of DMA device base address
+ *    p - 0 if VIA device is disabled, 1 if enabled
+ *    qq - low and hi bytes of VIA device base address
+ *    r - 0 if ACIA device is disabled, 1 if enabled
+ *    ss - low and hi bytes of ACIA device base address
+ *    t - 0 if interrupt controller registers are disabled, 1 if enabled
+ *    uu - low and hi bytes of interrupt controller base address
+ *    v - 0 if disk controller is disabled, 1 if enabled
+ *    ww - low and hi bytes of disk controller base address
+ *    x - flags of devices state that follows (HDR_DEVST_DMA,
+ *        HDR_DEVST_VIA, HDR_DEVST_INTC, HDR_DEVST_ACIA,
+ *        HDR_DEVST_DISK), 0 in snapshots saved without it
+ *    devices state, block is present only if its flag is set:
+ *        DMA device (DMA_STATE_LEN bytes, see
+ *        MemMapDev::DmaSaveState())
+ *        VIA device (VIA_STATE_LEN bytes, see
+ *        MemMapDev::ViaSaveState())
+ *        interrupt controller (INTC_STATE_LEN bytes, see
+ *        IntCtrl::SaveState())
+ *        ACIA device (ACIA_STATE_LEN bytes, see
+ *        MemMapDev::AciaSaveState())
+ *        disk controller (DISK_STATE_LEN bytes, see
+ *        MemMapDev::DiskSaveState())
+ *    Blocks added after VIA state begin with version of their
+ *    format, block of unknown version is skipped.
  *
  * NOTE:
  *   If magic keyword was detected, this part is already read and file
@@ -626,11 +795,14 @@ bool VMachine::LoadHdrData(FILE *fp)
 	int n = 0, l = 0, hdrdtlen = HDRDATALEN;
 	unsigned short rb = 0, re = 0;
 	Regs r;
-	bool ret = false;
+	bool ret = false, dmaactive = false, viaactive = false;
+	bool aciaactive = false, intcactive = false, diskactive = false;
+	unsigned char hdr[HDRDATALEN] = {0};
 
 	if (mOldStyleHeader) hdrdtlen = HDRDATALEN_OLD;
 	while (0 == feof(fp) && 0 == ferror(fp) && n < hdrdtlen) {
 		unsigned char val = fgetc(fp);
+		hdr[n] = val;
 		switch (n)
 		{
 			case 1:		mRunAddr = l + 256 * val;
@@ -673,6 +845,41 @@ bool VMachine::LoadHdrData(FILE *fp)
 								else DisableGraphDisp();
 								ADD_DBG_LDMEMPARHEX("LoadHdrData : Graph. Disp. addr",(l + 256 * val));
 								break;
+			case 18:	dmaactive = (val != 0);
+								ADD_DBG_LDMEMPARVAL("LoadHdrData : mDMAActive",dmaactive);
+								break;
+			case 20:	if (dmaactive) SetDMA(l + 256 * val);
+								else if (mDMAActive) DisableDMA();
+								ADD_DBG_LDMEMPARHEX("LoadHdrData : DMA addr",(l + 256 * val));
+								break;
+			case 21:	viaactive = (val != 0);
+								ADD_DBG_LDMEMPARVAL("LoadHdrData : mVIAActive",viaactive);
+								break;
+			case 23:	if (viaactive) SetVIA(l + 256 * val);
+								else if (mVIAActive) DisableVIA();
+								ADD_DBG_LDMEMPARHEX("LoadHdrData : VIA addr",(l + 256 * val));
+								break;
+			case 24:	aciaactive = (val != 0);
+								ADD_DBG_LDMEMPARVAL("LoadHdrData : mACIAActive",aciaactive);
+								break;
+			case 26:	if (aciaactive) SetACIA(l + 256 * val);
+								else if (mACIAActive) DisableACIA();
+								ADD_DBG_LDMEMPARHEX("LoadHdrData : ACIA addr",(l + 256 * val));
+								break;
+			case 27:	intcactive = (val != 0);
+								ADD_DBG_LDMEMPARVAL("LoadHdrData : mIntCtrlActive",intcactive);
+								break;
+			case 29:	if (intcactive) SetIntCtrl(l + 256 * val);
+								else if (mIntCtrlActive) DisableIntCtrl();
+								ADD_DBG_LDMEMPARHEX("LoadHdrData : Int. Ctrl. addr",(l + 256 * val));
+								break;
+			case 30:	diskactive = (val != 0);
+								ADD_DBG_LDMEMPARVAL("LoadHdrData : mDiskActive",diskactive);
+								break;
+			case 32:	if (diskactive) SetDisk(l + 256 * val);
+								else if (mDiskActive) DisableDisk();
+								ADD_DBG_LDMEMPARHEX("LoadHdrData : Disk Ctrl. addr",(l + 256 * val));
+								break;
 			default: 	break;
 		}
 		l = val;
@@ -682,6 +889,40 @@ bool VMachine::LoadHdrData(FILE *fp)
 		r.PtrAddr = mRunAddr;
 		mpCPU->SetRegs(r);
 	}
+	// devices state, restored after the devices are set up
+	unsigned char devst = (n == HDRDATALEN) ? hdr[HDR_DEVSTATE] : 0;
+	MemMapDev *pdev = mpRAM->GetMemMapDevPtr();
+	int offs = HDR_DEVSTDATA;
+	if ((devst & HDR_DEVST_DMA) && offs + DMA_STATE_LEN <= HDRDATALEN) {
+		pdev->DmaRestoreState(vector<unsigned char>(hdr + offs,
+																								hdr + offs + DMA_STATE_LEN));
+		offs += DMA_STATE_LEN;
+		ADD_DBG_LDMEMPARVAL("LoadHdrData : DMA state restored",1);
+	}
+	if ((devst & HDR_DEVST_VIA) && offs + VIA_STATE_LEN <= HDRDATALEN) {
+		pdev->ViaRestoreState(vector<unsigned char>(hdr + offs,
+																								hdr + offs + VIA_STATE_LEN));
+		offs += VIA_STATE_LEN;
+		ADD_DBG_LDMEMPARVAL("LoadHdrData : VIA state restored",1);
+	}
+	if ((devst & HDR_DEVST_INTC) && offs + INTC_STATE_LEN <= HDRDATALEN) {
+		mpRAM->GetIntCtrl()->RestoreState(vector<unsigned char>(hdr + offs,
+																								hdr + offs + INTC_STATE_LEN));
+		offs += INTC_STATE_LEN;
+		ADD_DBG_LDMEMPARVAL("LoadHdrData : Int. Ctrl. state restored",1);
+	}
+	if ((devst & HDR_DEVST_ACIA) && offs + ACIA_STATE_LEN <= HDRDATALEN) {
+		pdev->AciaRestoreState(vector<unsigned char>(hdr + offs,
+																								 hdr + offs + ACIA_STATE_LEN));
+		offs += ACIA_STATE_LEN;
+		ADD_DBG_LDMEMPARVAL("LoadHdrData : ACIA state restored",1);
+	}
+	if ((devst & HDR_DEVST_DISK) && offs + DISK_STATE_LEN <= HDRDATALEN) {
+		pdev->DiskRestoreState(vector<unsigned char>(hdr + offs,
+																								 hdr + offs + DISK_STATE_LEN));
+		offs += DISK_STATE_LEN;
+		ADD_DBG_LDMEMPARVAL("LoadHdrData : Disk Ctrl. state restored",1);
+	}
 
 	return ret;
 }
@@ -739,6 +980,50 @@ void VMachine::SaveHdrData(FILE *fp)
 	hi = (unsigned char) ((GetGraphDispAddr() & 0xFF00) >> 8);
 	SAVE_HDR_DATA(lo,fp,n);
 	SAVE_HDR_DATA(hi,fp,n);		
+	lo = (mDMAActive ? 1 : 0);
+	SAVE_HDR_DATA(lo,fp,n);
+	lo = (unsigned char) (GetDMAAddr() & 0x00FF);
+	hi = (unsigned char) ((GetDMAAddr() & 0xFF00) >> 8);
+	SAVE_HDR_DATA(lo,fp,n);
+	SAVE_HDR_DATA(hi,fp,n);
+	lo = (mVIAActive ? 1 : 0);
+	SAVE_HDR_DATA(lo,fp,n);
+	lo = (unsigned char) (GetVIAAddr() & 0x00FF);
+	hi = (unsigned char) ((GetVIAAddr() & 0xFF00) >> 8);
+	SAVE_HDR_DATA(lo,fp,n);
+	SAVE_HDR_DATA(hi,fp,n);
+	lo = (mACIAActive ? 1 : 0);
+	SAVE_HDR_DATA(lo,fp,n);
+	lo = (unsigned char) (GetACIAAddr() & 0x00FF);
+	hi = (unsigned char) ((GetACIAAddr() & 0xFF00) >> 8);
+	SAVE_HDR_DATA(lo,fp,n);
+	SAVE_HDR_DATA(hi,fp,n);
+	lo = (mIntCtrlActive ? 1 : 0);
+	SAVE_HDR_DATA(lo,fp,n);
+	lo = (unsigned char) (GetIntCtrlAddr() & 0x00FF);
+	hi = (unsigned char) ((GetIntCtrlAddr() & 0xFF00) >> 8);
+	SAVE_HDR_DATA(lo,fp,n);
+	SAVE_HDR_DATA(hi,fp,n);
+	lo = (mDiskActive ? 1 : 0);
+	SAVE_HDR_DATA(lo,fp,n);
+	lo = (unsigned char) (GetDiskAddr() & 0x00FF);
+	hi = (unsigned char) ((GetDiskAddr() & 0xFF00) >> 8);
+	SAVE_HDR_DATA(lo,fp,n);
+	SAVE_HDR_DATA(hi,fp,n);
+	// devices state
+	SAVE_HDR_DATA(HDR_DEVST_DMA | HDR_DEVST_VIA | HDR_DEVST_INTC
+								| HDR_DEVST_ACIA | HDR_DEVST_DISK,fp,n);
+	MemMapDev *pdev = mpRAM->GetMemMapDevPtr();
+	vector<unsigned char> st = pdev->DmaSaveState();
+	for (unsigned int i = 0; i < st.size(); i++) SAVE_HDR_DATA(st[i],fp,n);
+	st = pdev->ViaSaveState();
+	for (unsigned int i = 0; i < st.size(); i++) SAVE_HDR_DATA(st[i],fp,n);
+	st = mpRAM->GetIntCtrl()->SaveState();
+	for (unsigned int i = 0; i < st.size(); i++) SAVE_HDR_DATA(st[i],fp,n);
+	st = pdev->AciaSaveState();
+	for (unsigned int i = 0; i < st.size(); i++) SAVE_HDR_DATA(st[i],fp,n);
+	st = pdev->DiskSaveState();
+	for (unsigned int i = 0; i < st.size(); i++) SAVE_HDR_DATA(st[i],fp,n);
 	// fill up the unused slots of header data with 0-s
 	for (int i = n; i > 0; i--) fputc(0, fp);
 }
@@ -769,6 +1054,8 @@ int VMachine::SaveSnapshot(string fname)
 				else break;
 			}
 		}
+		// state of pluggable devices follows memory image
+		if (0 == ret) mpRAM->GetMemMapDevPtr()->PlugDev_SaveState(fp);
 		fclose(fp);
 	}
 	if (0 != ret) mError = VMERR_SAVE_SNAPSHOT;
@@ -835,11 +1122,14 @@ int VMachine::LoadRAMBin(string ramfname)
 		bool tmp1 = mCharIOActive, tmp2 = mpRAM->IsROMEnabled();
 		DisableCharIO();
 		DisableROM();
-		while (0 == feof(fp) && 0 == ferror(fp)) {
-			unsigned char val = fgetc(fp);
-			pm->Poke8bitImg(addr, val);
+		while (n <= MAX_8BIT_ADDR) {
+			int val = fgetc(fp);
+			if (EOF == val) break;
+			pm->Poke8bitImg(addr, (unsigned char)val);
 			addr++; n++;
 		}
+		// state of pluggable devices (if saved with snapshot)
+		pm->GetMemMapDevPtr()->PlugDev_RestoreState(fp);
 		fclose(fp);
 		// restore emulation facilities status
 		if (tmp1) SetCharIO(mCharIOAddr, false);
@@ -991,6 +1281,33 @@ int VMachine::LoadRAMDef(string memfname)
  * [ENGRAPH]
  * [GRAPHADDR
  * address]
+ * [GRAPHFPS
+ * value]
+ * [ENDMA]
+ * [DMAADDR
+ * address]
+ * [DMACYCLES
+ * value]
+ * [ENVIA]
+ * [VIAADDR
+ * address]
+ * [ENACIA]
+ * [ACIAADDR
+ * address]
+ * [ACIALINK
+ * pty [path] | socket path]
+ * [ENINTC]
+ * [INTCADDR
+ * address]
+ * [ENDISK]
+ * [DISKADDR
+ * address]
+ * [DISKCYCLES
+ * value]
+ * [DEVLIB
+ * path]
+ * [PLUGDEV
+ * type address [name=value ...]]
  * [RESET]
  *
  * Where:
@@ -1015,6 +1332,47 @@ int VMachine::LoadRAMDef(string memfname)
  *             display device will follow in next line,
  *             also enables generic graphics device emulation, but
  *             with the customized base address
+ * GRAPHFPS  - label indicating that the frame rate (decimal, frames
+ *             per second) of graphics display device will follow in
+ *             next line
+ * ENDMA     - enable DMA / blitter device emulation with default base
+ *             address
+ * DMAADDR   - label indicating that base address for DMA device will
+ *             follow in next line, also enables DMA device emulation
+ * DMACYCLES - label indicating that the number of CPU cycles (decimal)
+ *             taken per each byte transferred by DMA device will follow
+ *             in next line
+ * ENVIA     - enable VIA (6522) timers / ports device emulation with
+ *             default base address
+ * VIAADDR   - label indicating that base address for VIA device will
+ *             follow in next line, also enables VIA device emulation
+ * ENACIA    - enable ACIA (6551) serial port device emulation with
+ *             default base address
+ * ACIAADDR  - label indicating that base address for ACIA device will
+ *             follow in next line, also enables ACIA device emulation
+ * ACIALINK  - label indicating that the host endpoint of ACIA device
+ *             will follow in next line: "pty" with optional path of
+ *             symbolic link to created pseudo-terminal or "socket" with
+ *             path of Unix domain socket, also enables ACIA device
+ *             emulation
+ * ENINTC    - enable registers of interrupt controller with default
+ *             base address
+ * INTCADDR  - label indicating that base address of interrupt controller
+ *             registers will follow in next line, also enables them
+ * ENDISK    - enable disk controller emulation with default base
+ *             address
+ * DISKADDR  - label indicating that base address of disk controller
+ *             will follow in next line, also enables disk controller
+ * DISKCYCLES - label indicating that the number of CPU cycles (decimal)
+ *             from disk command start to its completion will follow
+ *             in next line
+ * DEVLIB    - label indicating that the path of shared library with
+ *             pluggable device types will follow in next line, the
+ *             library is loaded immediately
+ * PLUGDEV   - label indicating that the definition of pluggable device
+ *             will follow in next line: registered device type name,
+ *             base address and optional parameters, separated with
+ *             spaces, e.g.: adder $E040 seed=5
  * RESET     - initiate CPU reset sequence after loading memory definition file
  * address - decimal or hexadecimal (prefix $) address in memory
  * E.g:
@@ -1061,10 +1419,21 @@ int VMachine::LoadMEM(string memfname, Memory *pmem)
 	char line[256] = "\0";
 	int lc = 0, errc = 0;
 	unsigned short addr = 0, rombegin = 0, romend = 0;
-	unsigned int nAddr, graphaddr = GRDISP_ADDR;
+	unsigned int nAddr, graphaddr = GRDISP_ADDR, dmaaddr = DMA_ADDR;
+	unsigned int viaaddr = VIA_ADDR, aciaaddr = ACIA_ADDR;
+	unsigned int intcaddr = INTC_ADDR, diskaddr = DISK_ADDR;
 	bool enrom = false, enio = false, runset = false;
 	bool ioset = false, execset = false, rombegset = false;
 	bool romendset = false, engraph = false, graphset = false;
+	bool endma = false, dmaset = false;
+	bool envia = false, viaset = false;
+	bool enacia = false, aciaset = false;
+	bool enintc = false, intcset = false;
+	bool endisk = false, diskset = false;
+	int diskcycles = -1;
+	string acialink;
+	vector<string> plugdevs;
+	int graphfps = 0, dmacycles = -1;
 	Memory *pm = pmem;
 	int err = MEMIMGERR_OK;
 
@@ -1161,6 +1530,215 @@ int VMachine::LoadMEM(string memfname, Memory *pmem)
 				ADD_DBG_LDMEMPARHEX("GRAPHADDR",graphaddr);
 				continue;
 			}			
+			// define graphics display frame rate
+			if (0 == strncmp(line, "GRAPHFPS", 8)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				graphfps = atoi(line);
+				ADD_DBG_LDMEMPARVAL("GRAPHFPS",graphfps);
+				continue;
+			}
+			// define DMA device base address (once)
+			if (0 == strncmp(line, "DMAADDR", 7)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				if (!dmaset) {
+					if (*line == '$') {
+						sscanf(line+1, "%04x", &nAddr);
+						dmaaddr = nAddr;
+					} else {
+						dmaaddr = (unsigned short) atoi(line);
+					}
+					dmaset = true;
+				} else {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: DMA device base address was already set. Ignoring...");
+				}
+				ADD_DBG_LDMEMPARHEX("DMAADDR",dmaaddr);
+				continue;
+			}
+			// define # of CPU cycles per byte transferred by DMA
+			if (0 == strncmp(line, "DMACYCLES", 9)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				dmacycles = atoi(line);
+				ADD_DBG_LDMEMPARVAL("DMACYCLES",dmacycles);
+				continue;
+			}
+			// define VIA device base address (once)
+			if (0 == strncmp(line, "VIAADDR", 7)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				if (!viaset) {
+					if (*line == '$') {
+						sscanf(line+1, "%04x", &nAddr);
+						viaaddr = nAddr;
+					} else {
+						viaaddr = (unsigned short) atoi(line);
+					}
+					viaset = true;
+				} else {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: VIA device base address was already set. Ignoring...");
+				}
+				ADD_DBG_LDMEMPARHEX("VIAADDR",viaaddr);
+				continue;
+			}
+			// enable VIA device emulation
+			if (0 == strncmp(line, "ENVIA", 5)) {
+				envia = true;
+				ADD_DBG_LDMEMPARVAL("ENVIA",envia);
+				continue;
+			}
+			// define ACIA device base address (once)
+			if (0 == strncmp(line, "ACIAADDR", 8)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				if (!aciaset) {
+					if (*line == '$') {
+						sscanf(line+1, "%04x", &nAddr);
+						aciaaddr = nAddr;
+					} else {
+						aciaaddr = (unsigned short) atoi(line);
+					}
+					aciaset = true;
+				} else {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: ACIA device base address was already set. Ignoring...");
+				}
+				ADD_DBG_LDMEMPARHEX("ACIAADDR",aciaaddr);
+				continue;
+			}
+			// define ACIA device host endpoint
+			if (0 == strncmp(line, "ACIALINK", 8)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				acialink = line;
+				acialink.erase(acialink.find_last_not_of(" \t\r\n") + 1);
+				enacia = true;
+				if (mDebugTraceActive) AddDebugTrace("ACIALINK = " + acialink);
+				continue;
+			}
+			// enable ACIA device emulation
+			if (0 == strncmp(line, "ENACIA", 6)) {
+				enacia = true;
+				ADD_DBG_LDMEMPARVAL("ENACIA",enacia);
+				continue;
+			}
+			// define interrupt controller base address (once)
+			if (0 == strncmp(line, "INTCADDR", 8)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				if (!intcset) {
+					if (*line == '$') {
+						sscanf(line+1, "%04x", &nAddr);
+						intcaddr = nAddr;
+					} else {
+						intcaddr = (unsigned short) atoi(line);
+					}
+					intcset = true;
+				} else {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: Interrupt controller base address was already set. Ignoring...");
+				}
+				ADD_DBG_LDMEMPARHEX("INTCADDR",intcaddr);
+				continue;
+			}
+			// enable interrupt controller registers
+			if (0 == strncmp(line, "ENINTC", 6)) {
+				enintc = true;
+				ADD_DBG_LDMEMPARVAL("ENINTC",enintc);
+				continue;
+			}
+			// define disk controller base address (once)
+			if (0 == strncmp(line, "DISKADDR", 8)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				if (!diskset) {
+					if (*line == '$') {
+						sscanf(line+1, "%04x", &nAddr);
+						diskaddr = nAddr;
+					} else {
+						diskaddr = (unsigned short) atoi(line);
+					}
+					diskset = true;
+				} else {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: Disk controller base address was already set. Ignoring...");
+				}
+				ADD_DBG_LDMEMPARHEX("DISKADDR",diskaddr);
+				continue;
+			}
+			// define # of CPU cycles taken by disk command
+			if (0 == strncmp(line, "DISKCYCLES", 10)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				diskcycles = atoi(line);
+				ADD_DBG_LDMEMPARVAL("DISKCYCLES",diskcycles);
+				continue;
+			}
+			// enable disk controller
+			if (0 == strncmp(line, "ENDISK", 6)) {
+				endisk = true;
+				ADD_DBG_LDMEMPARVAL("ENDISK",endisk);
+				continue;
+			}
+			// load library with pluggable device types
+			if (0 == strncmp(line, "DEVLIB", 6)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				string libpath = line;
+				libpath.erase(libpath.find_last_not_of(" \t\r\n") + 1);
+				if (PLUGDEVERR_OK != LoadPlugDevLib(libpath)) {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: unable to load device library. Ignoring...");
+				}
+				continue;
+			}
+			// load program symbols from listing or label file
+			if (0 == strncmp(line, "SYMFILE", 7)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				string symfile = line;
+				symfile.erase(symfile.find_last_not_of(" \t\r\n") + 1);
+				if (0 > LoadSymbols(symfile)) {
+					err = MEMIMGERR_VM65_IGNPROCWRN;
+					errc++;
+					ADD_DBG_LOADMEM(lc," WARNING: unable to load symbols. Ignoring...");
+				}
+				continue;
+			}
+			// define pluggable device (created after file is processed)
+			if (0 == strncmp(line, "PLUGDEV", 7)) {
+				line[0] = '\0';
+				fgets(line, 256, fp);
+				lc++;
+				plugdevs.push_back(line);
+				continue;
+			}
+			// enable DMA device emulation
+			if (0 == strncmp(line, "ENDMA", 5)) {
+				endma = true;
+				ADD_DBG_LDMEMPARVAL("ENDMA",endma);
+				continue;
+			}
 			// enable character I/O emulation
 			if (0 == strncmp(line, "ENIO", 4)) {
 				enio = true;
@@ -1279,6 +1857,67 @@ int VMachine::LoadMEM(string memfname, Memory *pmem)
 		}
 		if (engraph || graphset) {
 			SetGraphDisp(graphaddr);
+			if (graphfps > 0) SetGraphDispFrameRate(graphfps);
+		}
+		if (endma || dmaset) {
+			SetDMA(dmaaddr);
+			if (dmacycles >= 0) SetDMACycles(dmacycles);
+		}
+		if (envia || viaset) {
+			SetVIA(viaaddr);
+		}
+		if (enintc || intcset) {
+			SetIntCtrl(intcaddr);
+		}
+		if (endisk || diskset) {
+			SetDisk(diskaddr);
+			if (diskcycles >= 0) SetDiskCycles(diskcycles);
+		}
+		if (enacia || aciaset) {
+			SetACIA(aciaaddr);
+			stringstream ss(acialink);
+			string type, path;
+			ss >> type >> path;
+			int linktype = SERLINK_NONE;
+			if (0 == type.compare("pty")) linktype = SERLINK_PTY;
+			else if (0 == type.compare("socket")) linktype = SERLINK_SOCKET;
+			if (SERLINK_NONE != linktype && 0 != SetACIALink(linktype, path)) {
+				err = MEMIMGERR_VM65_IGNPROCWRN;
+				errc++;
+				AddDebugTrace("WARNING: Unable to open ACIA host endpoint: " + acialink);
+			}
+		}
+		for (vector<string>::iterator it = plugdevs.begin();
+				 it != plugdevs.end();
+				 ++it
+				) {
+			stringstream ss(*it);
+			string type, saddr, par;
+			DevParams dev_params;
+			ss >> type >> saddr;
+			while (ss >> par) {
+				size_t eq = par.find('=');
+				if (eq == string::npos) continue;
+				dev_params.push_back(DevPar(par.substr(0, eq), par.substr(eq + 1)));
+			}
+			unsigned short devaddr = 0;
+			if (saddr[0] == '$') {
+				sscanf(saddr.c_str()+1, "%04x", &nAddr);
+				devaddr = nAddr;
+			} else {
+				devaddr = (unsigned short) atoi(saddr.c_str());
+			}
+			int plugdev = -1;
+			if (!type.empty() && !saddr.empty()) {
+				plugdev = AddPlugDev(type, devaddr, dev_params);
+			}
+			if (0 > plugdev) {
+				err = MEMIMGERR_VM65_IGNPROCWRN;
+				errc++;
+				ADD_DBG_LOADMEM(lc," WARNING: unable to create pluggable device " + type
+												+ ((-2 == plugdev) ? " (address overlaps other device)" : "")
+												+ ". Ignoring...");
+			}
 		}
 	}
 	else {
@@ -1302,6 +1941,8 @@ int VMachine::LoadMEM(string memfname, Memory *pmem)
  *--------------------------------------------------------------------
  * Method:		MemPeek8bit()
  * Purpose:		Read value from specified RAM address.
+ *            Access is not counted in memory heat map (it is not
+ *            done by the CPU).
  * Arguments:	addr - RAM address (0..0xFFFF)
  * Returns:		unsigned short - value read from specified RAM address
  *--------------------------------------------------------------------
@@ -1309,8 +1950,11 @@ int VMachine::LoadMEM(string memfname, Memory *pmem)
 unsigned short VMachine::MemPeek8bit(unsigned short addr)
 {
 	unsigned short ret = 0;
+	bool heatmap = mpRAM->IsHeatMapEnabled();
 	
+	mpRAM->EnableHeatMap(false);
 	ret = (unsigned short)mpRAM->Peek8bit(addr);
+	mpRAM->EnableHeatMap(heatmap);
 	
 	return ret;
 }
@@ -1319,6 +1963,7 @@ unsigned short VMachine::MemPeek8bit(unsigned short addr)
  *--------------------------------------------------------------------
  * Method:		MemPoke8bit()
  * Purpose:		Write value to specified RAM address.
+ *            Access is not counted in memory heat map.
  * Arguments:	addr - RAM address (0..0xFFFF)
  *            v - 8-bit byte value
  * Returns:		n/a
@@ -1326,7 +1971,11 @@ unsigned short VMachine::MemPeek8bit(unsigned short addr)
  */
 void VMachine::MemPoke8bit(unsigned short addr, unsigned char v)
 {
+	bool heatmap = mpRAM->IsHeatMapEnabled();
+
+	mpRAM->EnableHeatMap(false);
 	mpRAM->Poke8bit(addr, v);
+	mpRAM->EnableHeatMap(heatmap);
 }
 
 /*
@@ -1426,6 +2075,74 @@ void VMachine::SetGraphDisp(unsigned short addr)
 	}
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetGraphDispFrameRate()
+ * Purpose:		Set the frame presentation rate of graphics device.
+ * Arguments:	fps - int : frames per second (1 .. GRDISP_MAXFPS),
+ *                  values out of range are clamped
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetGraphDispFrameRate(int fps)
+{
+	if (fps < 1) fps = 1;
+	if (fps > GRDISP_MAXFPS) fps = GRDISP_MAXFPS;
+	unsigned short addr = GetGraphDispAddr();
+	AddrRange addr_range(addr, addr + GRAPHDEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("fps", to_string(fps));
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+	mpRAM->SetupDevice(DEVNUM_GRDISP, memaddr_ranges, dev_params);
+	if (mDebugTraceActive) {
+		AddDebugTrace("Graphics Device frame rate: " + to_string(fps) + " fps.");
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetGraphDispBackend()
+ * Purpose:		Select graphics display backend (SDL window or
+ *            offscreen). Must be called before memory definition
+ *            enabling graphics device is loaded.
+ * Arguments:	backend - GRDISP_BACKEND_SDL or GRDISP_BACKEND_OFFSCREEN
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetGraphDispBackend(int backend)
+{
+	mpRAM->GetMemMapDevPtr()->SetGraphDispBackend(backend);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SaveGraphDispImage()
+ * Purpose:		Save graphics display contents to PPM image file.
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, -1 if error
+ *--------------------------------------------------------------------
+ */
+int VMachine::SaveGraphDispImage(string fname)
+{
+	return mpRAM->GetMemMapDevPtr()->GraphDisp_SaveImage(fname);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetGraphDispFrameDump()
+ * Purpose:		Dump each presented graphics frame to PPM file.
+ * Arguments:	prefix - file name prefix, empty string disables dump
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetGraphDispFrameDump(string prefix)
+{
+	mpRAM->GetMemMapDevPtr()->GraphDisp_SetFrameDump(prefix);
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:
@@ -1469,294 +2186,1356 @@ bool VMachine::GetGraphDispActive()
 
 /*
  *--------------------------------------------------------------------
- * Method:		ShowIO()
- * Purpose:		Show contents of emulated char I/O.
- * Arguments:	n/a
+ * Method:		SetDMA()
+ * Purpose:		Set DMA device address and enable.
+ * Arguments:	addr - unsigned short : device base address.
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
-void VMachine::ShowIO()
+void VMachine::SetDMA(unsigned short addr)
 {
-	if (mCharIOActive && NULL != mpDisp)
-		mpDisp->ShowScr();
+	mDMAActive = true;
+	mpRAM->SetDMA(addr);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "DMA Device set at: $" + Addr2HexStr(addr) + ".";
+		AddDebugTrace(msg);
+	}
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		IsAutoExec()
- * Purpose:		Return status of auto-execute flag.
+ * Method:		DisableDMA()
+ * Purpose:		Inactivate DMA device.
  * Arguments:	n/a
- * Returns:		bool - true if auto-exec flag is enabled.
+ * Returns:		n/a
  *--------------------------------------------------------------------
  */
-bool VMachine::IsAutoExec()
+void VMachine::DisableDMA()
+{
+	mDMAActive = false;
+	mpRAM->DisableDMA();
+	AddDebugTrace("DMA Device DISABLED.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDMAAddr()
+ * Purpose:		Return base address of DMA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::GetDMAAddr()
+{
+	return mpRAM->GetDMAAddr();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDMAActive()
+ * Purpose:		Returns status of DMA device emulation.
+ * Arguments:	n/a
+ * Returns:		true if DMA device emulation is active
+ *--------------------------------------------------------------------
+ */
+bool VMachine::GetDMAActive()
+{
+	return mDMAActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetDMACycles()
+ * Purpose:		Set # of CPU cycles taken per each byte transferred by
+ *            DMA device (0 - transfers take no CPU time).
+ * Arguments:	cycles - int : cycles per byte
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetDMACycles(int cycles)
+{
+	unsigned short addr = GetDMAAddr();
+	AddrRange addr_range(addr, addr + DMADEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("cycles", to_string(cycles));
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+	mpRAM->SetupDevice(DEVNUM_DMA, memaddr_ranges, dev_params);
+	if (mDebugTraceActive) {
+		AddDebugTrace("DMA Device: " + to_string(cycles) + " cycles per byte.");
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetVIA()
+ * Purpose:		Set VIA device address and enable.
+ * Arguments:	addr - unsigned short : device base address.
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetVIA(unsigned short addr)
+{
+	mVIAActive = true;
+	mpRAM->SetVIA(addr);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "VIA Device set at: $" + Addr2HexStr(addr) + ".";
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableVIA()
+ * Purpose:		Inactivate VIA device.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::DisableVIA()
+{
+	mVIAActive = false;
+	mpRAM->DisableVIA();
+	AddDebugTrace("VIA Device DISABLED.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetVIAAddr()
+ * Purpose:		Return base address of VIA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::GetVIAAddr()
+{
+	return mpRAM->GetVIAAddr();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetVIAActive()
+ * Purpose:		Returns status of VIA device emulation.
+ * Arguments:	n/a
+ * Returns:		true if VIA device emulation is active
+ *--------------------------------------------------------------------
+ */
+bool VMachine::GetVIAActive()
+{
+	return mVIAActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetACIA()
+ * Purpose:		Set ACIA device address and enable.
+ * Arguments:	addr - unsigned short : device base address.
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetACIA(unsigned short addr)
+{
+	mACIAActive = true;
+	mpRAM->SetACIA(addr);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "ACIA Device set at: $" + Addr2HexStr(addr) + ".";
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableACIA()
+ * Purpose:		Inactivate ACIA device.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::DisableACIA()
+{
+	mACIAActive = false;
+	mpRAM->DisableACIA();
+	AddDebugTrace("ACIA Device DISABLED.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetACIAAddr()
+ * Purpose:		Return base address of ACIA device.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::GetACIAAddr()
+{
+	return mpRAM->GetACIAAddr();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetACIAActive()
+ * Purpose:		Returns status of ACIA device emulation.
+ * Arguments:	n/a
+ * Returns:		true if ACIA device emulation is active
+ *--------------------------------------------------------------------
+ */
+bool VMachine::GetACIAActive()
+{
+	return mACIAActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetACIALink()
+ * Purpose:		Connect ACIA device to host pseudo-terminal or Unix
+ *            domain socket.
+ * Arguments:	type - int : endpoint type (eSerialLinkTypes)
+ *            path - string : pty - optional path of symbolic link
+ *                   to created pty, socket - path of the socket
+ * Returns:		int - 0 if OK, -1 if endpoint couldn't be opened
+ *--------------------------------------------------------------------
+ */
+int VMachine::SetACIALink(int type, string path)
+{
+	int ret = mpRAM->GetMemMapDevPtr()->AciaSetLink(type, path);
+	if (0 == ret && mDebugTraceActive) {
+		AddDebugTrace("ACIA Device linked to: "
+									+ mpRAM->GetMemMapDevPtr()->GetAciaLinkName());
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetACIALinkName()
+ * Purpose:		Return name of ACIA host endpoint (pty slave device
+ *            or socket path), to show user where to connect.
+ * Arguments:	n/a
+ * Returns:		string - name, empty if not linked
+ *--------------------------------------------------------------------
+ */
+string VMachine::GetACIALinkName()
+{
+	return mpRAM->GetMemMapDevPtr()->GetAciaLinkName();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetIntCtrl()
+ * Purpose:		Set interrupt controller registers address and enable.
+ * Arguments:	addr - unsigned short : registers base address.
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetIntCtrl(unsigned short addr)
+{
+	mIntCtrlActive = true;
+	mpRAM->SetIntCtrl(addr);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "Interrupt Controller set at: $" + Addr2HexStr(addr) + ".";
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableIntCtrl()
+ * Purpose:		Inactivate interrupt controller registers.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::DisableIntCtrl()
+{
+	mIntCtrlActive = false;
+	mpRAM->DisableIntCtrl();
+	AddDebugTrace("Interrupt Controller registers DISABLED.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntCtrlAddr()
+ * Purpose:		Return base address of interrupt controller registers.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::GetIntCtrlAddr()
+{
+	return mpRAM->GetIntCtrlAddr();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetDisk()
+ * Purpose:		Set disk controller address and enable.
+ * Arguments:	addr - unsigned short : base address.
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetDisk(unsigned short addr)
+{
+	mDiskActive = true;
+	mpRAM->SetDisk(addr);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "Disk Controller set at: $" + Addr2HexStr(addr) + ".";
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableDisk()
+ * Purpose:		Inactivate disk controller.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::DisableDisk()
+{
+	mDiskActive = false;
+	mpRAM->DisableDisk();
+	AddDebugTrace("Disk Controller DISABLED.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskAddr()
+ * Purpose:		Return base address of disk controller.
+ * Arguments:	n/a
+ * Returns:		unsigned short - address ($0000 - $FFFF)
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::GetDiskAddr()
+{
+	return mpRAM->GetDiskAddr();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskActive()
+ * Purpose:		Returns status of disk controller emulation.
+ * Arguments:	n/a
+ * Returns:		true if disk controller emulation is active
+ *--------------------------------------------------------------------
+ */
+bool VMachine::GetDiskActive()
+{
+	return mDiskActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetDiskCycles()
+ * Purpose:		Set # of CPU cycles from disk controller command start
+ *            to its completion (0 - command completes immediately).
+ * Arguments:	cycles - unsigned long : cycles per command
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetDiskCycles(unsigned long cycles)
+{
+	unsigned short addr = GetDiskAddr();
+	AddrRange addr_range(addr, addr + DISKDEVREG_END - 1);
+	MemAddrRanges memaddr_ranges;
+	DevPar dev_par("cycles", to_string(cycles));
+	DevParams dev_params;
+
+	dev_params.push_back(dev_par);
+	memaddr_ranges.push_back(addr_range);
+	mpRAM->SetupDevice(DEVNUM_DISK, memaddr_ranges, dev_params);
+	if (mDebugTraceActive) {
+		AddDebugTrace("Disk Controller: " + to_string(cycles) + " cycles per command.");
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SyncDisk()
+ * Purpose:		Flush disk images and wait until background writer puts
+ *            all written data on disk.
+ * Arguments:	n/a
+ * Returns:		int - 0 if OK, less than 0 if any write failed
+ *--------------------------------------------------------------------
+ */
+int VMachine::SyncDisk()
+{
+	return mpRAM->GetMemMapDevPtr()->GetDiskStorage()->Sync();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskFlushStats()
+ * Purpose:		Return statistics of disk images background writer.
+ * Arguments:	n/a
+ * Returns:		MassStorFlushStats - counters and latencies (usec)
+ *--------------------------------------------------------------------
+ */
+MassStorFlushStats VMachine::GetDiskFlushStats()
+{
+	return mpRAM->GetMemMapDevPtr()->GetDiskStorage()->GetFlushStats();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskNumOpen()
+ * Purpose:		Return number of disk images mapped to memory.
+ * Arguments:	n/a
+ * Returns:		int - # of open images
+ *--------------------------------------------------------------------
+ */
+int VMachine::GetDiskNumOpen()
+{
+	return mpRAM->GetMemMapDevPtr()->GetDiskStorage()->GetNumOpen();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetDiskMappedSize()
+ * Purpose:		Return address space taken by open disk images.
+ * Arguments:	n/a
+ * Returns:		size_t - # of bytes mapped
+ *--------------------------------------------------------------------
+ */
+size_t VMachine::GetDiskMappedSize()
+{
+	return mpRAM->GetMemMapDevPtr()->GetDiskStorage()->GetMappedSize();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntCtrlActive()
+ * Purpose:		Returns status of interrupt controller registers.
+ * Arguments:	n/a
+ * Returns:		true if registers are mapped in memory
+ *--------------------------------------------------------------------
+ */
+bool VMachine::GetIntCtrlActive()
+{
+	return mIntCtrlActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntStats()
+ * Purpose:		Return interrupt statistics of IRQ source.
+ * Arguments:	src - int : source (eIntSources)
+ * Returns:		IntSrcStats - # of requests, # serviced, latencies
+ *--------------------------------------------------------------------
+ */
+IntSrcStats VMachine::GetIntStats(int src)
+{
+	return mpRAM->GetIntCtrl()->GetStats(src);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetNmiStats()
+ * Purpose:		Return interrupt statistics of NMI.
+ * Arguments:	n/a
+ * Returns:		IntSrcStats - # of requests, # serviced, latencies
+ *--------------------------------------------------------------------
+ */
+IntSrcStats VMachine::GetNmiStats()
+{
+	return mpRAM->GetIntCtrl()->GetNmiStats();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetIntSrcName()
+ * Purpose:		Return name of IRQ source.
+ * Arguments:	src - int : source (eIntSources)
+ * Returns:		string - name
+ *--------------------------------------------------------------------
+ */
+string VMachine::GetIntSrcName(int src)
+{
+	return mpRAM->GetIntCtrl()->GetSrcName(src);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetIntStats()
+ * Purpose:		Clear interrupt statistics.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::ResetIntStats()
+{
+	mpRAM->GetIntCtrl()->ResetStats();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		LoadPlugDevLib()
+ * Purpose:		Load shared library with pluggable device types.
+ * Arguments:	libpath - string : path to library file
+ * Returns:		int - PLUGDEVERR_OK or error code (ePlugDevErrors)
+ *--------------------------------------------------------------------
+ */
+int VMachine::LoadPlugDevLib(string libpath)
+{
+	int ret = mpRAM->GetMemMapDevPtr()->PlugDev_LoadLib(libpath);
+	if (mDebugTraceActive) {
+		AddDebugTrace("Device library " + libpath + " load status: "
+									+ to_string(ret) + ".");
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		RegisterPlugDevType()
+ * Purpose:		Register pluggable device type implemented by the
+ *            application embedding the emulator.
+ * Arguments:	type - string : device type name
+ *            pfun - function creating the device object
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::RegisterPlugDevType(string type, PlugDevCreateFn pfun)
+{
+	mpRAM->GetMemMapDevPtr()->PlugDev_RegisterType(type, pfun);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		AddPlugDev()
+ * Purpose:		Create pluggable device of registered type and enable
+ *            it at given base address.
+ * Arguments:	type - string : device type name
+ *            addr - unsigned short : device base address
+ *            params - device parameters
+ * Returns:		int - device number, -1 if device couldn't be created,
+ *                  -2 if address range overlaps active device
+ *--------------------------------------------------------------------
+ */
+int VMachine::AddPlugDev(string type, unsigned short addr, DevParams params)
+{
+	int ret = mpRAM->AddPlugDev(type, addr, params);
+	if (ret >= 0) mPlugDevActive = true;
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "Pluggable device " + type + ((ret >= 0) ? " set at: $" : " FAILED at: $")
+					+ Addr2HexStr(addr) + ((-2 == ret) ? " (overlaps other device)." : ".");
+		AddDebugTrace(msg);
+	}
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetPlugDevActive()
+ * Purpose:		Returns status of pluggable devices emulation.
+ * Arguments:	n/a
+ * Returns:		true if at least one pluggable device is active
+ *--------------------------------------------------------------------
+ */
+bool VMachine::GetPlugDevActive()
+{
+	return mPlugDevActive;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ShowIO()
+ * Purpose:		Show contents of emulated char I/O.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::ShowIO()
+{
+	if (mCharIOActive && NULL != mpDisp)
+		mpDisp->ShowScr();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsAutoExec()
+ * Purpose:		Return status of auto-execute flag.
+ * Arguments:	n/a
+ * Returns:		bool - true if auto-exec flag is enabled.
+ *--------------------------------------------------------------------
+ */
+bool VMachine::IsAutoExec()
 {
 	return mAutoExec;
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		IsAutoReset()
- * Purpose:		Return status of auto-reset flag.
+ * Method:		IsAutoReset()
+ * Purpose:		Return status of auto-reset flag.
+ * Arguments:	n/a
+ * Returns:		bool - true if auto-exec flag is enabled.
+ *--------------------------------------------------------------------
+ */
+bool VMachine::IsAutoReset()
+{
+	return mAutoReset;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableROM()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void VMachine::EnableROM()
+{
+	mpRAM->EnableROM();
+	AddDebugTrace("ROM ENABLED.");
+}
+		
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableROM()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */		
+void VMachine::DisableROM()
+{
+	mpRAM->DisableROM();
+	AddDebugTrace("ROM DISABLED.");
+}
+		
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetROM()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */		
+void VMachine::SetROM(unsigned short start, unsigned short end)
+{
+	mpRAM->SetROM(start, end);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "ROM SET, Start: $" + Addr2HexStr(start) + ", End: $";
+		msg += Addr2HexStr(end) + ".";		
+		AddDebugTrace(msg);
+	}	
+}
+		
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableROM()
+ * Purpose:		Sets and enables Read Only Memory range.
+ * Arguments:	start, end - unsigned short : start and end addresses
+ *												 of the ROM.
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */		
+void VMachine::EnableROM(unsigned short start, unsigned short end)
+{
+	mpRAM->EnableROM(start, end);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "ROM ENABLED, Start: $" + Addr2HexStr(start) + ", End: $";
+		msg += Addr2HexStr(end) + ".";		
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetROMBegin()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::GetROMBegin()
+{
+	return mpRAM->GetROMBegin();
+}
+		
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetROMEnd()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */		
+unsigned short VMachine::GetROMEnd()
+{
+	return mpRAM->GetROMEnd();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsROMEnabled()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */		
+bool VMachine::IsROMEnabled()
+{
+	return mpRAM->IsROMEnabled();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetRunAddr()
+ * Purpose:
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */		
+unsigned short VMachine::GetRunAddr()
+{
+	return mRunAddr;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SetOpInterrupt()
+ * Purpose:		Set the flag indicating operator interrupt.
+ * Arguments:	bool - new value of the flag
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::SetOpInterrupt(bool opint)
+{
+	mOpInterrupt = opint;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsOpInterrupt()
+ * Purpose:		Return the flag indicating operator interrupt status.
  * Arguments:	n/a
- * Returns:		bool - true if auto-exec flag is enabled.
+ * Returns:		bool - true if operator interrupt flag was set
  *--------------------------------------------------------------------
  */
-bool VMachine::IsAutoReset()
+bool VMachine::IsOpInterrupt()
 {
-	return mAutoReset;
+	return mOpInterrupt;
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		EnableROM()
+ * Method:		GetExecHistory()
+ * Purpose:		Return history of executed opcodes (last 20).
+ * Arguments:	n/a
+ * Returns:		queue<string>
+ *--------------------------------------------------------------------
+ */
+queue<string> VMachine::GetExecHistory()
+{
+	return mpCPU->GetExecHistory();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Disassemble()
+ * Purpose:		Disassemble code in memory. Return next instruction
+ *            address.
+ * Arguments:	addr - address in memory
+ *            buf - character buffer for disassembled instruction
+ * Returns:		unsigned short - address of next instruction
+ *--------------------------------------------------------------------
+ */
+unsigned short VMachine::Disassemble(unsigned short addr, char *buf)
+{
+	return mpCPU->Disassemble(addr, buf);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Reset()
+ * Purpose:		Reset VM and CPU (should never return except operator
+ *            induced interrupt).
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::Reset()
+{
+	if (mVIAActive) mpRAM->GetMemMapDevPtr()->ViaReset();
+	if (mACIAActive) mpRAM->GetMemMapDevPtr()->AciaReset();
+	if (mDiskActive) mpRAM->GetMemMapDevPtr()->DiskReset();
+	mpRAM->GetIntCtrl()->Reset();
+	mpCPU->Reset();
+	Exec(mpCPU->GetRegs()->PtrAddr);
+	mpCPU->mExitAtLastRTS = true;
+	AddDebugTrace("*** CPU RESET ***");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		Interrupt()
+ * Purpose:		Send Interrupt ReQuest to CPU (set the IRQ line LOW).
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::Interrupt()
+{
+	mpCPU->Interrupt();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		NMInterrupt()
+ * Purpose:		Send Non-Maskable Interrupt to CPU (NMI line edge).
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::NMInterrupt()
+{
+	mpCPU->NMInterrupt();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetLastError()
+ * Purpose:		Return error code set by last operation. Reset error
+ *            code to OK.
+ * Arguments: n/a
+ * Returns:   n/a
+ *--------------------------------------------------------------------
+ */
+int VMachine::GetLastError()
+{
+	int ret = mError;
+	mError = MEMIMGERR_OK;
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableExecHistory()
  * Purpose:
  * Arguments:
  * Returns:
  *--------------------------------------------------------------------
  */
-void VMachine::EnableROM()
+void VMachine::EnableExecHistory(bool enexehist)
 {
-	mpRAM->EnableROM();
-	AddDebugTrace("ROM ENABLED.");
+	mpCPU->EnableExecHistory(enexehist);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "The op-code execute history " 
+					+ (string)((enexehist) ? "ENABLED" : "DISABLED");
+		msg += ".";
+		AddDebugTrace(msg);
+	}
 }
 		
 /*
  *--------------------------------------------------------------------
- * Method:		DisableROM()
+ * Method:		IsExecHistoryActive()
  * Purpose:
  * Arguments:
  * Returns:
  *--------------------------------------------------------------------
- */		
-void VMachine::DisableROM()
+ */		
+bool VMachine::IsExecHistoryActive()
+{
+	return mpCPU->IsExecHistoryEnabled();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableProfiler()
+ * Purpose:		Enable/disable execution profiler (per address
+ *            instruction and cycle counters).
+ * Arguments:	enprof - true = enable / false = disable
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::EnableProfiler(bool enprof)
+{
+	mpCPU->EnableProfiler(enprof);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "The execution profiler "
+					+ (string)((enprof) ? "ENABLED" : "DISABLED");
+		msg += ".";
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsProfilerActive()
+ * Purpose:		Check if execution profiler is enabled.
+ * Arguments:	n/a
+ * Returns:		bool - true if enabled
+ *--------------------------------------------------------------------
+ */
+bool VMachine::IsProfilerActive()
+{
+	return mpCPU->IsProfilerEnabled();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetProfiler()
+ * Purpose:		Zero execution profiler counters.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::ResetProfiler()
+{
+	mpCPU->ResetProfiler();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetProfile()
+ * Purpose:		Get execution profiler report.
+ * Arguments:	maxn - maximum # of hot-spots in report
+ * Returns:		ProfReport - totals and hot-spots, most cycles first
+ *--------------------------------------------------------------------
+ */
+ProfReport VMachine::GetProfile(int maxn)
+{
+	return mpCPU->GetProfile(maxn);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableCallGraph()
+ * Purpose:		Enable/disable call graph profiler (cycles per call
+ *            path, tracked through JSR/RTS, BRK, IRQ/NMI and RTI).
+ * Arguments:	encallgr - true = enable / false = disable
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::EnableCallGraph(bool encallgr)
+{
+	mpCPU->EnableCallGraph(encallgr);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "The call graph profiler "
+					+ (string)((encallgr) ? "ENABLED" : "DISABLED");
+		msg += ".";
+		AddDebugTrace(msg);
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsCallGraphActive()
+ * Purpose:		Check if call graph profiler is enabled.
+ * Arguments:	n/a
+ * Returns:		bool - true if enabled
+ *--------------------------------------------------------------------
+ */
+bool VMachine::IsCallGraphActive()
+{
+	return mpCPU->IsCallGraphEnabled();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ResetCallGraph()
+ * Purpose:		Drop call paths collected by call graph profiler.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::ResetCallGraph()
 {
-	mpRAM->DisableROM();
-	AddDebugTrace("ROM DISABLED.");
+	mpCPU->ResetCallGraph();
 }
-		
+
 /*
  *--------------------------------------------------------------------
- * Method:		SetROM()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		SaveCallGraph()
+ * Purpose:		Save call paths and cycles to text file in folded
+ *            stacks format (input of flame graph tools).
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, -1 if error
  *--------------------------------------------------------------------
- */		
-void VMachine::SetROM(unsigned short start, unsigned short end)
+ */
+int VMachine::SaveCallGraph(string fname)
 {
-	mpRAM->SetROM(start, end);
-	if (mDebugTraceActive) {
-		string msg;
-		msg = "ROM SET, Start: $" + Addr2HexStr(start) + ", End: $";
-		msg += Addr2HexStr(end) + ".";		
-		AddDebugTrace(msg);
-	}	
+	FILE *fp = fopen(fname.c_str(), "w");
+	if (NULL == fp) return -1;
+	vector<string> stacks = mpCPU->GetCallGraph();
+	for (vector<string>::iterator it = stacks.begin(); it != stacks.end(); ++it) {
+		fprintf(fp, "%s\n", it->c_str());
+	}
+	return (0 == fclose(fp)) ? 0 : -1;
 }
-		
+
 /*
  *--------------------------------------------------------------------
- * Method:		EnableROM()
- * Purpose:		Sets and enables Read Only Memory range.
- * Arguments:	start, end - unsigned short : start and end addresses
- *												 of the ROM.
+ * Method:		EnableOpStats()
+ * Purpose:		Enable/disable instruction mix statistics (executions
+ *            and cycles per op-code and addressing mode, taken and
+ *            not taken branches, page crossing penalties).
+ * Arguments:	enopstats - true = enable / false = disable
  * Returns:		n/a
  *--------------------------------------------------------------------
- */		
-void VMachine::EnableROM(unsigned short start, unsigned short end)
+ */
+void VMachine::EnableOpStats(bool enopstats)
 {
-	mpRAM->EnableROM(start, end);
+	mpCPU->EnableOpStats(enopstats);
 	if (mDebugTraceActive) {
 		string msg;
-		msg = "ROM ENABLED, Start: $" + Addr2HexStr(start) + ", End: $";
-		msg += Addr2HexStr(end) + ".";		
+		msg = "The instruction mix statistics "
+					+ (string)((enopstats) ? "ENABLED" : "DISABLED");
+		msg += ".";
 		AddDebugTrace(msg);
 	}
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		GetROMBegin()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		IsOpStatsActive()
+ * Purpose:		Check if instruction mix statistics are enabled.
+ * Arguments:	n/a
+ * Returns:		bool - true if enabled
  *--------------------------------------------------------------------
  */
-unsigned short VMachine::GetROMBegin()
+bool VMachine::IsOpStatsActive()
 {
-	return mpRAM->GetROMBegin();
+	return mpCPU->IsOpStatsEnabled();
 }
-		
+
 /*
  *--------------------------------------------------------------------
- * Method:		GetROMEnd()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		ResetOpStats()
+ * Purpose:		Zero instruction mix statistics.
+ * Arguments:	n/a
+ * Returns:		n/a
  *--------------------------------------------------------------------
- */		
-unsigned short VMachine::GetROMEnd()
+ */
+void VMachine::ResetOpStats()
 {
-	return mpRAM->GetROMEnd();
+	mpCPU->ResetOpStats();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		IsROMEnabled()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		GetOpStats()
+ * Purpose:		Get instruction mix counters.
+ * Arguments:	n/a
+ * Returns:		OpStats - counters per op-code
  *--------------------------------------------------------------------
- */		
-bool VMachine::IsROMEnabled()
+ */
+OpStats VMachine::GetOpStats()
 {
-	return mpRAM->IsROMEnabled();
+	return mpCPU->GetOpStats();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		GetRunAddr()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		SaveOpStats()
+ * Purpose:		Save instruction mix statistics to file.
+ *            Only op-codes and addressing modes executed at least
+ *            once are listed, counts per addressing mode are sums
+ *            over op-codes of the mode.
+ *            CSV: one row per op-code (kind=op), addressing mode
+ *            (kind=mode) and the total (kind=total).
+ *            JSON: object with totals and arrays "opcodes" and
+ *            "modes".
+ * Arguments:	fname - file name
+ *            format - OPSTATS_CSV or OPSTATS_JSON
+ * Returns:		int - 0 if OK, -1 if error
  *--------------------------------------------------------------------
- */		
-unsigned short VMachine::GetRunAddr()
-{
-	return mRunAddr;
+ */
+int VMachine::SaveOpStats(string fname, int format)
+{
+	OpStats st = mpCPU->GetOpStats();
+	unsigned long long mcount[ADDRMODE_LENGTH], mcycles[ADDRMODE_LENGTH];
+	unsigned long long totcount = 0, totcycles = 0;
+	bool json = (OPSTATS_JSON == format);
+	const char *sep = "";
+
+	memset(mcount, 0, sizeof(mcount));
+	memset(mcycles, 0, sizeof(mcycles));
+	for (int op = 0; op < 256; op++) {
+		int mode = mpCPU->GetAddrMode((unsigned char)op);
+		mcount[mode] += st.count[op];
+		mcycles[mode] += st.cycles[op];
+		totcount += st.count[op];
+		totcycles += st.cycles[op];
+	}
+	FILE *fp = fopen(fname.c_str(), "w");
+	if (NULL == fp) return -1;
+	if (json) {
+		fprintf(fp, "{\n  \"instructions\": %llu,\n  \"cycles\": %llu,\n",
+						totcount, totcycles);
+		fprintf(fp, "  \"opcodes\": [\n");
+	} else {
+		fprintf(fp, "kind,opcode,mnemonic,mode,count,cycles,taken,not_taken,"
+								"page_cross\n");
+	}
+	for (int op = 0; op < 256; op++) {
+		if (0 == st.count[op]) continue;
+		unsigned char opc = (unsigned char)op;
+		string mnem = mpCPU->GetMnemonic(opc);
+		string mode = mpCPU->GetAddrModeName(mpCPU->GetAddrMode(opc));
+		bool branch = (ADDRMODE_REL == mpCPU->GetAddrMode(opc));
+		if (json) {
+			fprintf(fp, "%s    {\"opcode\": \"%02X\", \"mnemonic\": \"%s\", "
+									"\"mode\": \"%s\", \"count\": %llu, \"cycles\": %llu, "
+									"\"page_cross\": %llu",
+							sep, op, mnem.c_str(), mode.c_str(), st.count[op],
+							st.cycles[op], st.pagecross[op]);
+			if (branch) {
+				fprintf(fp, ", \"taken\": %llu, \"not_taken\": %llu",
+								st.taken[op], st.count[op] - st.taken[op]);
+			}
+			fprintf(fp, "}");
+			sep = ",\n";
+		} else if (branch) {
+			fprintf(fp, "op,%02X,%s,%s,%llu,%llu,%llu,%llu,%llu\n",
+							op, mnem.c_str(), mode.c_str(), st.count[op], st.cycles[op],
+							st.taken[op], st.count[op] - st.taken[op], st.pagecross[op]);
+		} else {
+			fprintf(fp, "op,%02X,%s,%s,%llu,%llu,,,%llu\n",
+							op, mnem.c_str(), mode.c_str(), st.count[op], st.cycles[op],
+							st.pagecross[op]);
+		}
+	}
+	if (json) {
+		fprintf(fp, "\n  ],\n  \"modes\": [\n");
+		sep = "";
+	}
+	for (int mode = 0; mode < ADDRMODE_LENGTH; mode++) {
+		if (0 == mcount[mode]) continue;
+		string name = mpCPU->GetAddrModeName(mode);
+		if (json) {
+			fprintf(fp, "%s    {\"mode\": \"%s\", \"count\": %llu, \"cycles\": %llu}",
+							sep, name.c_str(), mcount[mode], mcycles[mode]);
+			sep = ",\n";
+		} else {
+			fprintf(fp, "mode,,,%s,%llu,%llu,,,\n", name.c_str(), mcount[mode],
+							mcycles[mode]);
+		}
+	}
+	if (json) {
+		fprintf(fp, "\n  ]\n}\n");
+	} else {
+		fprintf(fp, "total,,,,%llu,%llu,,,\n", totcount, totcycles);
+	}
+	return (0 == fclose(fp)) ? 0 : -1;
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		SetOpInterrupt()
- * Purpose:		Set the flag indicating operator interrupt.
- * Arguments:	bool - new value of the flag
+ * Method:		EnableHeatMap()
+ * Purpose:		Enable/disable memory heat map (CPU reads, writes,
+ *            device hits and op-code fetches per memory page).
+ * Arguments:	enheatmap - true = enable / false = disable
  * Returns:		n/a
  *--------------------------------------------------------------------
  */
-void VMachine::SetOpInterrupt(bool opint)
+void VMachine::EnableHeatMap(bool enheatmap)
 {
-	mOpInterrupt = opint;
+	mpRAM->EnableHeatMap(enheatmap);
+	if (mDebugTraceActive) {
+		string msg;
+		msg = "The memory heat map "
+					+ (string)((enheatmap) ? "ENABLED" : "DISABLED");
+		msg += ".";
+		AddDebugTrace(msg);
+	}
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		IsOpInterrupt()
- * Purpose:		Return the flag indicating operator interrupt status.
+ * Method:		IsHeatMapActive()
+ * Purpose:		Check if memory heat map is enabled.
  * Arguments:	n/a
- * Returns:		bool - true if operator interrupt flag was set
+ * Returns:		bool - true if enabled
  *--------------------------------------------------------------------
  */
-bool VMachine::IsOpInterrupt()
+bool VMachine::IsHeatMapActive()
 {
-	return mOpInterrupt;
+	return mpRAM->IsHeatMapEnabled();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		GetExecHistory()
- * Purpose:		Return history of executed opcodes (last 20).
+ * Method:		ResetHeatMap()
+ * Purpose:		Zero memory heat map counters.
  * Arguments:	n/a
- * Returns:		queue<string>
+ * Returns:		n/a
  *--------------------------------------------------------------------
  */
-queue<string> VMachine::GetExecHistory()
+void VMachine::ResetHeatMap()
 {
-	return mpCPU->GetExecHistory();
+	mpRAM->ResetHeatMap();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		Disassemble()
- * Purpose:		Disassemble code in memory. Return next instruction
- *            address.
- * Arguments:	addr - address in memory
- *            buf - character buffer for disassembled instruction
- * Returns:		unsigned short - address of next instruction
+ * Method:		GetPageStats()
+ * Purpose:		Get memory heat map counters of page.
+ * Arguments:	page - memory page # (0..255)
+ * Returns:		MemPageStats - counters
  *--------------------------------------------------------------------
  */
-unsigned short VMachine::Disassemble(unsigned short addr, char *buf)
+MemPageStats VMachine::GetPageStats(int page)
 {
-	return mpCPU->Disassemble(addr, buf);
+	return mpRAM->GetPageStats(page);
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		Reset()
- * Purpose:		Reset VM and CPU (should never return except operator
- *            induced interrupt).
- * Arguments: n/a
- * Returns:   n/a
+ * Method:		SaveHeatMap()
+ * Purpose:		Save memory heat map to file.
+ *            CSV: one row per page with reads, writes, device hits
+ *            and op-code fetches.
+ *            PPM: image of 16 x 16 cells (page $00 top left, $FF
+ *            bottom right), red - writes, green - data reads,
+ *            blue - op-code fetches, brightness in logarithmic scale
+ *            relative to the busiest page, white frame marks pages
+ *            with device hits.
+ * Arguments:	fname - file name
+ *            format - HEATMAP_CSV or HEATMAP_PPM
+ * Returns:		int - 0 if OK, -1 if error
  *--------------------------------------------------------------------
  */
-void VMachine::Reset()
+int VMachine::SaveHeatMap(string fname, int format)
 {
-	mpCPU->Reset();
-	Exec(mpCPU->GetRegs()->PtrAddr);
-	mpCPU->mExitAtLastRTS = true;
-	AddDebugTrace("*** CPU RESET ***");
+	MemPageStats st[MEM_NUM_PAGES];
+	for (int pg = 0; pg < MEM_NUM_PAGES; pg++) {
+		st[pg] = mpRAM->GetPageStats(pg);
+	}
+	if (HEATMAP_PPM != format) {
+		FILE *fp = fopen(fname.c_str(), "w");
+		if (NULL == fp) return -1;
+		fprintf(fp, "page,reads,writes,device,fetches\n");
+		for (int pg = 0; pg < MEM_NUM_PAGES; pg++) {
+			fprintf(fp, "%02X,%llu,%llu,%llu,%llu\n", pg, st[pg].reads,
+							st[pg].writes, st[pg].devhits, st[pg].fetches);
+		}
+		return (0 == fclose(fp)) ? 0 : -1;
+	}
+	// image, reads shown without op-code fetches
+	unsigned long long maxw = 0, maxr = 0, maxf = 0;
+	for (int pg = 0; pg < MEM_NUM_PAGES; pg++) {
+		if (st[pg].writes > maxw) maxw = st[pg].writes;
+		if (st[pg].reads - st[pg].fetches > maxr) maxr = st[pg].reads - st[pg].fetches;
+		if (st[pg].fetches > maxf) maxf = st[pg].fetches;
+	}
+	int size = 16 * HEATMAP_CELL;
+	Uint32 *pimg = new Uint32[size * size];
+	if (NULL == pimg) return -1;
+	for (int pg = 0; pg < MEM_NUM_PAGES; pg++) {
+		unsigned long long v[3] = {st[pg].writes, st[pg].reads - st[pg].fetches,
+															 st[pg].fetches};
+		unsigned long long vmax[3] = {maxw, maxr, maxf};
+		Uint32 col = 0;
+		for (int i = 0; i < 3; i++) {
+			int c = 0;
+			if (v[i] > 0) c = 32 + (int)(223.0 * log(1.0 + v[i]) / log(1.0 + vmax[i]));
+			col = (col << 8) | (Uint32)c;
+		}
+		Uint32 frame = (st[pg].devhits > 0) ? 0x00FFFFFF : col;
+		int x0 = (pg % 16) * HEATMAP_CELL, y0 = (pg / 16) * HEATMAP_CELL;
+		for (int y = 0; y < HEATMAP_CELL; y++) {
+			for (int x = 0; x < HEATMAP_CELL; x++) {
+				bool edge = (0 == x || 0 == y || HEATMAP_CELL-1 == x || HEATMAP_CELL-1 == y);
+				pimg[(y0 + y) * size + x0 + x] = (edge ? frame : col);
+			}
+		}
+	}
+	int ret = WritePPM(fname, pimg, size, size);
+	delete [] pimg;
+	return ret;
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		Interrupt()
- * Purpose:		Send Interrupt ReQuest to CPU (set the IRQ line LOW).
- * Arguments: n/a
- * Returns:   n/a
+ * Method:		LoadSymbols()
+ * Purpose:		Load program symbols from assembler listing (ca65,
+ *            AS65) or label file (ld65 -Ln, LABEL = $addr lines).
+ *            Symbols name addresses in disassembly, execute history,
+ *            profiler reports and debug traces. Symbols of several
+ *            files can be loaded.
+ * Arguments:	fname - file name
+ * Returns:		int - # of symbols found in file, -1 if error
  *--------------------------------------------------------------------
  */
-void VMachine::Interrupt()
+int VMachine::LoadSymbols(string fname)
 {
-	mpCPU->Interrupt();
+	int ret = mpSymTab->Load(fname);
+	if (mpSymTab->GetCount() > 0) mpCPU->SetSymTab(mpSymTab);
+	if (mDebugTraceActive) {
+		AddDebugTrace("Symbols loaded from " + fname + ": " + to_string(ret));
+	}
+	return ret;
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		GetLastError()
- * Purpose:		Return error code set by last operation. Reset error
- *            code to OK.
- * Arguments: n/a
- * Returns:   n/a
+ * Method:		ClearSymbols()
+ * Purpose:		Remove all program symbols.
+ * Arguments:	n/a
+ * Returns:		n/a
  *--------------------------------------------------------------------
  */
-int VMachine::GetLastError()
+void VMachine::ClearSymbols()
 {
-	int ret = mError;
-	mError = MEMIMGERR_OK;
-	return ret;
+	mpCPU->SetSymTab(NULL);
+	mpSymTab->Clear();
 }
 
 /*
  *--------------------------------------------------------------------
- * Method:		EnableExecHistory()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		GetNumSymbols()
+ * Purpose:		Get # of loaded program symbols.
+ * Arguments:	n/a
+ * Returns:		int - # of symbols
  *--------------------------------------------------------------------
  */
-void VMachine::EnableExecHistory(bool enexehist)
+int VMachine::GetNumSymbols()
 {
-	mpCPU->EnableExecHistory(enexehist);
-	if (mDebugTraceActive) {
-		string msg;
-		msg = "The op-code execute history " 
-					+ (string)((enexehist) ? "ENABLED" : "DISABLED");
-		msg += ".";
-		AddDebugTrace(msg);
-	}
+	return mpSymTab->GetCount();
 }
-		
+
 /*
  *--------------------------------------------------------------------
- * Method:		IsExecHistoryActive()
- * Purpose:
- * Arguments:
- * Returns:
+ * Method:		GetSymbolName()
+ * Purpose:		Name address after the nearest symbol, label+offset.
+ * Arguments:	addr - address
+ * Returns:		string - name, empty if no symbol is near
  *--------------------------------------------------------------------
- */		
-bool VMachine::IsExecHistoryActive()
+ */
+string VMachine::GetSymbolName(unsigned short addr)
 {
-	return mpCPU->IsExecHistoryEnabled();
+	return mpSymTab->AddrName(addr);
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetSymbolLabel()
+ * Purpose:		Get symbol defined exactly at address.
+ * Arguments:	addr - address
+ * Returns:		string - label, empty if none
+ *--------------------------------------------------------------------
+ */
+string VMachine::GetSymbolLabel(unsigned short addr)
+{
+	return mpSymTab->Label(addr);
 }
 
 /*
@@ -1928,4 +3707,116 @@ string VMachine::Addr2DecStr(unsigned short addr)
 	return ret;
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		Addr2SymStr()
+ * Purpose:   Convert 16-bit address to hexadecimal notation string
+ *            followed by the symbol (if any), e.g.: 0409 (CHESS).
+ * Arguments: addr - 16-bit unsigned
+ * Returns:   string
+ *--------------------------------------------------------------------
+ */
+string VMachine::Addr2SymStr(unsigned short addr)
+{
+	string ret = Addr2HexStr(addr);
+	string sym = mpSymTab->AddrName(addr);
+
+	if (sym.length() > 0) ret += " (" + sym + ")";
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		EnableOutputCapture()
+ * Purpose:		Start capturing character I/O device output.
+ * Arguments:	maxlen - capture buffer size limit (bytes), 0 - default
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::EnableOutputCapture(unsigned long maxlen)
+{
+	mpRAM->GetMemMapDevPtr()->EnableCharIOCapture(maxlen);
+	AddDebugTrace("Output capture enabled.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DisableOutputCapture()
+ * Purpose:		Stop capturing character I/O device output.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::DisableOutputCapture()
+{
+	mpRAM->GetMemMapDevPtr()->DisableCharIOCapture();
+	AddDebugTrace("Output capture disabled.");
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ClearOutputCapture()
+ * Purpose:		Discard captured output, reset byte counter and hash.
+ * Arguments:	n/a
+ * Returns:		n/a
+ *--------------------------------------------------------------------
+ */
+void VMachine::ClearOutputCapture()
+{
+	mpRAM->GetMemMapDevPtr()->ClearCharIOCapture();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		IsOutputCaptureActive()
+ * Purpose:		Return status of output capture.
+ * Arguments:	n/a
+ * Returns:		bool - true if output capture is enabled
+ *--------------------------------------------------------------------
+ */
+bool VMachine::IsOutputCaptureActive()
+{
+	return mpRAM->GetMemMapDevPtr()->IsCharIOCaptureActive();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetOutputCapture()
+ * Purpose:		Return captured character I/O device output.
+ * Arguments:	n/a
+ * Returns:		string - captured output (up to size limit)
+ *--------------------------------------------------------------------
+ */
+string VMachine::GetOutputCapture()
+{
+	return mpRAM->GetMemMapDevPtr()->GetCharIOCapture();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetOutputCaptureCount()
+ * Purpose:		Return # of bytes output since capture was enabled.
+ * Arguments:	n/a
+ * Returns:		unsigned long - byte count
+ *--------------------------------------------------------------------
+ */
+unsigned long VMachine::GetOutputCaptureCount()
+{
+	return mpRAM->GetMemMapDevPtr()->GetCharIOCaptCount();
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		GetOutputCaptureHash()
+ * Purpose:		Return 32-bit FNV-1a hash of output captured so far.
+ * Arguments:	n/a
+ * Returns:		unsigned long - hash value
+ *--------------------------------------------------------------------
+ */
+unsigned long VMachine::GetOutputCaptureHash()
+{
+	return mpRAM->GetMemMapDevPtr()->GetCharIOCaptHash();
+}
+
 } // namespace MKBasic
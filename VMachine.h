@@ -41,6 +41,7 @@
 #include "Memory.h"
 #include "Display.h"
 #include "ConsoleIO.h"
+#include "SymTab.h"
 
 //#define WINDOWS 1
 #if defined (WINDOWS)
@@ -53,12 +54,25 @@
 #define HDRMAGICKEY_OLD "SNAPSHOT"
 #define HDRDATALEN	128
 #define HDRDATALEN_OLD	15
+#define HDR_DEVSTATE	33	// offset of devices state in header data
+// flags of devices state present in header data
+#define HDR_DEVST_DMA	0x01
+#define HDR_DEVST_VIA	0x02
+#define HDR_DEVST_INTC	0x04
+#define HDR_DEVST_ACIA	0x08
+#define HDR_DEVST_DISK	0x10
+// state blocks follow the flags in order of the flag bits, block of
+// a device with flag clear is omitted
+#define HDR_DEVSTDATA	(HDR_DEVSTATE + 1)
 #define HEXEOF	":00000001FF"
 // take emulation speed measurement every 2 minutes (120,000,000 usec)
 #define PERFSTAT_INTERVAL	120000000
 // but not more often than 30,000,000 clock ticks
 #define PERFSTAT_CYCLES 30000000
 #define DBG_TRACE_SIZE	200	// maximum size of debug messages queue
+// check graphics display window events every 65536 steps (power of 2)
+#define GRAPHEVT_STEPS	0x10000
+#define HEATMAP_CELL	16	// size of heat map image cell in pixels
 
 using namespace std;
 using namespace chrono;
@@ -125,6 +139,18 @@ enum eMemImgLoadErrors {
 	MEMIMGERR_UNKNOWN
 };
 
+// Formats of instruction mix statistics file.
+enum eOpStatsFormats {
+	OPSTATS_CSV = 0,
+	OPSTATS_JSON
+};
+
+// Formats of memory heat map file.
+enum eHeatMapFormats {
+	HEATMAP_CSV = 0,			// table, one row per page
+	HEATMAP_PPM						// image, 16 x 16 cells, one per page
+};
+
 // Types of other errors
 enum eVMErrors {
 	VMERR_OK = 0,																// all is good
@@ -141,6 +167,9 @@ struct PerfStats {
 	long prev_cycles;				// previously measured stats
 	long prev_usec;					// previously measured stats
 	int  perf_onemhz;				// avg. % perf. based on 1MHz CPU.
+	long gr_pixels;					// graphics pixels drawn during last run
+	long gr_usec;						// duration of last run (usec)
+	long gr_pixrate;				// graphics throughput (pixels/sec)
 };
 
 class VMachine
@@ -189,15 +218,79 @@ class VMachine
 		unsigned short Disassemble(unsigned short addr, char *buf);
 		void Reset();
 		void Interrupt();
+		void NMInterrupt();
 		int SaveSnapshot(string fname);
 		int GetLastError();
 		void SetGraphDisp(unsigned short addr);
 		void DisableGraphDisp();
 		unsigned short GetGraphDispAddr();
+		void SetGraphDispFrameRate(int fps);
+		void SetGraphDispBackend(int backend);
+		int SaveGraphDispImage(string fname);
+		void SetGraphDispFrameDump(string prefix);
+		void SetDMA(unsigned short addr);
+		void DisableDMA();
+		unsigned short GetDMAAddr();
+		bool GetDMAActive();
+		void SetDMACycles(int cycles);
+		void SetVIA(unsigned short addr);
+		void DisableVIA();
+		unsigned short GetVIAAddr();
+		bool GetVIAActive();
+		void SetACIA(unsigned short addr);
+		void DisableACIA();
+		unsigned short GetACIAAddr();
+		bool GetACIAActive();
+		int SetACIALink(int type, string path);
+		string GetACIALinkName();
+		void SetIntCtrl(unsigned short addr);
+		void DisableIntCtrl();
+		unsigned short GetIntCtrlAddr();
+		bool GetIntCtrlActive();
+		IntSrcStats GetIntStats(int src);
+		IntSrcStats GetNmiStats();
+		string GetIntSrcName(int src);
+		void ResetIntStats();
+		void SetDisk(unsigned short addr);
+		void DisableDisk();
+		unsigned short GetDiskAddr();
+		bool GetDiskActive();
+		void SetDiskCycles(unsigned long cycles);
+		int SyncDisk();
+		MassStorFlushStats GetDiskFlushStats();
+		int GetDiskNumOpen();
+		size_t GetDiskMappedSize();
+		int LoadPlugDevLib(string libpath);
+		void RegisterPlugDevType(string type, PlugDevCreateFn pfun);
+		int AddPlugDev(string type, unsigned short addr, DevParams params);
+		bool GetPlugDevActive();
 		PerfStats GetPerfStats();	// returns performance stats based on 1 million
 															// cycles per second (1 MHz CPU).
 		void EnableExecHistory(bool enexehist);
 		bool IsExecHistoryActive();
+		void EnableProfiler(bool enprof);
+		bool IsProfilerActive();
+		void ResetProfiler();
+		ProfReport GetProfile(int maxn);
+		void EnableCallGraph(bool encallgr);
+		bool IsCallGraphActive();
+		void ResetCallGraph();
+		int SaveCallGraph(string fname);
+		void EnableOpStats(bool enopstats);
+		bool IsOpStatsActive();
+		void ResetOpStats();
+		OpStats GetOpStats();
+		int SaveOpStats(string fname, int format);
+		void EnableHeatMap(bool enheatmap);
+		bool IsHeatMapActive();
+		void ResetHeatMap();
+		MemPageStats GetPageStats(int page);
+		int SaveHeatMap(string fname, int format);
+		int LoadSymbols(string fname);
+		void ClearSymbols();
+		int GetNumSymbols();
+		string GetSymbolName(unsigned short addr);
+		string GetSymbolLabel(unsigned short addr);
 		void EnableDebugTrace();
 		void DisableDebugTrace();
 		bool IsDebugTraceActive();
@@ -205,6 +298,14 @@ class VMachine
 		void DisablePerfStats();
 		bool IsPerfStatsActive();
 		queue<string> GetDebugTraces();
+		Regs *RunBatch(bool reset, unsigned long maxcycles);
+		void EnableOutputCapture(unsigned long maxlen);
+		void DisableOutputCapture();
+		void ClearOutputCapture();
+		bool IsOutputCaptureActive();
+		string GetOutputCapture();
+		unsigned long GetOutputCaptureCount();
+		unsigned long GetOutputCaptureHash();
 
 		
 	protected:
@@ -216,6 +317,7 @@ class VMachine
 		Memory	*mpRAM;			// object maintained locally
 		Display	*mpDisp;		// just a pointer
 		ConsoleIO *mpConIO;	// object maintained locally
+		SymTab	*mpSymTab;	// object maintained locally
 		unsigned short mRunAddr;
 		unsigned short mCharIOAddr;
 		bool mCharIOActive;
@@ -225,6 +327,12 @@ class VMachine
 		bool mAutoReset;
 		int  mError;			 // last error code
 		bool mGraphDispActive;
+		bool mDMAActive;
+		bool mVIAActive;
+		bool mACIAActive;
+		bool mIntCtrlActive;
+		bool mDiskActive;
+		bool mPlugDevActive;
 		bool mOldStyleHeader;
 		PerfStats mPerfStats;
 		queue<string> mDebugTraces;
@@ -240,9 +348,12 @@ class VMachine
 		void SaveHdrData(FILE *fp);
 		eMemoryImageTypes GetMemoryImageType(string ramfname);
 		int CalcCurrPerf();
+		void CalcGraphPerf(unsigned long pixbegin,
+											 time_point<high_resolution_clock> begin);
 		void AddDebugTrace(string msg);
 		string Addr2HexStr(unsigned short addr);
 		string Addr2DecStr(unsigned short addr);
+		string Addr2SymStr(unsigned short addr);
 };
 
 } // namespace MKBasic
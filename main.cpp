@@ -36,6 +36,7 @@
 #include <chrono>
 #include <thread>
 #include <string.h>
+#include <math.h>
 #include "system.h"
 #include "MKCpu.h"
 #include "Memory.h"
@@ -54,6 +55,7 @@ using namespace MKBasic;
 #define PROMPT_START_ADDR	"Start address (0..FFFF): "
 #define PROMPT_RANGE_ADDR	"Enter address range (0..0xFFFF).."
 #define PROMPT_END_ADDR		"End address   (0..FFFF): "
+#define PROF_REPORT_SIZE	20	// # of hot-spots in profiler report
 
 const bool ClsIfDirty = true;
 
@@ -67,6 +69,18 @@ bool ioecho = false, opbrk = false, needhelp = false;
 bool loadbin = false, loadhex = false, reset = false, execvm = false;
 int g_stackdisp_lines = 1;
 string ramfile = "dummy.ram";
+bool batchrun = false;
+string goldfile = "", capfile = "";
+unsigned long maxcycles = 0;
+bool headless = false;
+string imgfile = "", dumpprefix = "";
+string diskcmd = "", diskpath = "";
+int diskdrive = 0;
+bool profile = false;
+string callgrfile = "";
+string opstatsfile = "";
+string heatfile = "";
+vector<string> symfiles;
 
 bool ShowRegs(Regs *preg, VMachine *pvm, bool ioecho, bool showiostat);
 void ShowHelp();
@@ -452,6 +466,12 @@ void ShowMenu()
 	cout << "   V - toggle graphics emulation    |    U - enable/disable exec. history" << endl;
 	cout << "   Z - enable/disable debug traces  |    1 - enable/disable perf. stats" << endl;
 	cout << "   2 - display debug traces         |    ? - show this menu" << endl;
+	cout << "   3 - show interrupt stats         |    4 - NMI" << endl;
+	cout << "   5 - enable/disable profiler      |    6 - show profiler hot-spots" << endl;
+	cout << "   7 - enable/disable call graph    |    8 - save call graph" << endl;
+	cout << "   9 - load symbols                 |    # - enable/disable instr. mix stats" << endl;
+	cout << "   % - save instr. mix stats        |    & - enable/disable memory heat map" << endl;
+	cout << "   * - show memory heat map         |    @ - save memory heat map" << endl;
 	cout << "------------------------------------+----------------------------------------" << endl;
 } 
 
@@ -521,6 +541,16 @@ void ShowSpeedStats()
 		cout << "|-> Average speed based on 1MHz CPU: " << pvm->GetPerfStats().perf_onemhz << " %" << endl;
 		cout << "|-> Last measured # of cycles exec.: " << pvm->GetPerfStats().prev_cycles << endl;
 		cout << "|-> Last measured time of execution: " << pvm->GetPerfStats().prev_usec << " usec" << endl; 
+		if (pvm->GetGraphDispActive()) {
+			cout << "Graphics display stats (last run): " << endl;
+			cout << "|-> # of pixels drawn: " << pvm->GetPerfStats().gr_pixels << endl;
+			cout << "|-> Throughput: " << pvm->GetPerfStats().gr_pixrate << " pixels/sec" << endl;
+		}
+		if (pvm->GetDiskActive()) {
+			cout << "Disk images: " << endl;
+			cout << "|-> # of images open: " << pvm->GetDiskNumOpen() << endl;
+			cout << "|-> Mapped size: " << pvm->GetDiskMappedSize() << " bytes" << endl;
+		}
 		cout << endl;
 	} else {
 		cout << endl;
@@ -529,6 +559,278 @@ void ShowSpeedStats()
 	}
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		ShowIntStats()
+ * Purpose:		Print # of interrupt requests and IRQ-to-handler
+ *            latencies (cycles) of sources that requested interrupt.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ShowIntStats()
+{
+	cout << endl;
+	cout << dec;
+	cout << "Interrupt stats (source: requests / serviced, latency min/avg/max):" << endl;
+	bool none = true;
+	for (int src = 0; src <= INTC_NUM_SRC; src++) {
+		IntSrcStats st = (src < INTC_NUM_SRC) ? pvm->GetIntStats(src)
+																					: pvm->GetNmiStats();
+		if (0 == st.count) continue;
+		none = false;
+		cout << "|-> " << ((src < INTC_NUM_SRC) ? pvm->GetIntSrcName(src) : "NMI");
+		cout << ": " << st.count << " / " << st.serviced;
+		if (st.serviced > 0) {
+			cout << ", " << st.lat_min << "/" << (st.lat_total / st.serviced);
+			cout << "/" << st.lat_max << " cycles";
+		}
+		cout << endl;
+	}
+	if (none) cout << "|-> No interrupts requested." << endl;
+	cout << endl;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ShowProfile()
+ * Purpose:		Print execution profiler report: addresses of the
+ *            instructions which took the most cycles.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ShowProfile()
+{
+	ProfReport rep = pvm->GetProfile(PROF_REPORT_SIZE);
+	char line[DISS_BUF_SIZE + 60];
+	cout << endl;
+	cout << dec;
+	cout << "Profile: " << rep.count << " instructions, " << rep.cycles;
+	cout << " cycles at " << rep.addrs << " addresses." << endl;
+	if (0 == rep.count) {
+		cout << endl;
+		return;
+	}
+	bool syms = (pvm->GetNumSymbols() > 0);
+	cout << "      CYCLES    %       COUNT  ";
+	if (syms) cout << "SYMBOL                ";
+	cout << "INSTR" << endl;
+	cout << "------------------------------------------------------------" << endl;
+	for (vector<ProfEntry>::iterator it = rep.hot.begin(); it != rep.hot.end(); ++it) {
+		sprintf(line, "%12llu %5.1f %11llu  ", it->cycles,
+						(100.0 * it->cycles) / rep.cycles, it->count);
+		cout << line;
+		if (syms) {
+			sprintf(line, "%-21s ", it->sym.c_str());
+			cout << line;
+		}
+		cout << it->instr << endl;
+	}
+	cout << endl;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SaveCallGraph()
+ * Purpose:		Save call graph profile to file in folded stacks
+ *            format.
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, 2 if file I/O error
+ *--------------------------------------------------------------------
+ */
+int SaveCallGraph(string fname)
+{
+	if (0 != pvm->SaveCallGraph(fname)) {
+		cout << "ERROR: Unable to save call graph: " << fname << endl;
+		return 2;
+	}
+	cout << "Call graph saved to: " << fname << endl;
+	return 0;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ToggleCallGraph()
+ * Purpose:		Enable/disable call graph profiler, call paths
+ *            are collected from scratch each time it is enabled.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ToggleCallGraph()
+{
+	if (pvm->IsCallGraphActive()) {
+		pvm->EnableCallGraph(false);
+		cout << "Call graph profiler was disabled." << endl;
+	} else {
+		pvm->EnableCallGraph(true);
+		pvm->ResetCallGraph();
+		cout << "Call graph profiler was enabled." << endl;
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SaveOpStats()
+ * Purpose:		Save instruction mix statistics to file, JSON if file
+ *            name ends with .json, CSV otherwise.
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, 2 if file I/O error
+ *--------------------------------------------------------------------
+ */
+int SaveOpStats(string fname)
+{
+	int fmt = OPSTATS_CSV;
+	if (fname.length() > 5 && 0 == fname.compare(fname.length() - 5, 5, ".json")) {
+		fmt = OPSTATS_JSON;
+	}
+	if (0 != pvm->SaveOpStats(fname, fmt)) {
+		cout << "ERROR: Unable to save instruction mix stats: " << fname << endl;
+		return 2;
+	}
+	cout << "Instruction mix stats saved to: " << fname << endl;
+	return 0;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ToggleOpStats()
+ * Purpose:		Enable/disable instruction mix statistics, counting
+ *            starts from zero each time they are enabled.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ToggleOpStats()
+{
+	if (pvm->IsOpStatsActive()) {
+		pvm->EnableOpStats(false);
+		cout << "Instruction mix stats were disabled." << endl;
+	} else {
+		pvm->EnableOpStats(true);
+		pvm->ResetOpStats();
+		cout << "Instruction mix stats were enabled." << endl;
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ShowHeatMap()
+ * Purpose:		Display memory heat map: 16 x 16 table of pages, each
+ *            cell shows CPU accesses (reads + writes) of the page in
+ *            logarithmic scale relative to the busiest page, D marks
+ *            pages with device hits.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ShowHeatMap()
+{
+	static const char *scale = " .:-=+*#%@";
+	unsigned long long tot[MEM_NUM_PAGES], max = 0;
+	bool dev[MEM_NUM_PAGES];
+	unsigned long long reads = 0, writes = 0, devhits = 0, fetches = 0;
+
+	for (int pg = 0; pg < MEM_NUM_PAGES; pg++) {
+		MemPageStats st = pvm->GetPageStats(pg);
+		tot[pg] = st.reads + st.writes;
+		dev[pg] = (st.devhits > 0);
+		if (tot[pg] > max) max = tot[pg];
+		reads += st.reads;
+		writes += st.writes;
+		devhits += st.devhits;
+		fetches += st.fetches;
+	}
+	cout << endl << "Memory heat map (" << (pvm->IsHeatMapActive() ? "ON" : "OFF");
+	cout << "): " << dec << reads << " reads (" << fetches << " op-code fetches), ";
+	cout << writes << " writes, " << devhits << " device hits." << endl;
+	if (0 == max) {
+		cout << endl;
+		return;
+	}
+	cout << "Zero page: " << tot[0] << ", stack: " << tot[1] << " accesses." << endl;
+	cout << endl << "     ";
+	for (int col = 0; col < 16; col++) cout << " " << hex << uppercase << col << " ";
+	cout << endl;
+	for (int row = 0; row < 16; row++) {
+		cout << "  " << hex << uppercase << row << "x ";
+		for (int col = 0; col < 16; col++) {
+			int pg = row * 16 + col;
+			int lvl = 0;
+			if (tot[pg] > 0) lvl = 1 + (int)(8.0 * log(1.0 + tot[pg]) / log(1.0 + max));
+			cout << " " << scale[lvl] << (dev[pg] ? 'D' : ' ');
+		}
+		cout << endl;
+	}
+	cout << dec << nouppercase << endl;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		SaveHeatMap()
+ * Purpose:		Save memory heat map to file, PPM image if file name
+ *            ends with .ppm, CSV table otherwise.
+ * Arguments:	fname - file name
+ * Returns:		int - 0 if OK, 2 if file I/O error
+ *--------------------------------------------------------------------
+ */
+int SaveHeatMap(string fname)
+{
+	int fmt = HEATMAP_CSV;
+	if (fname.length() > 4 && 0 == fname.compare(fname.length() - 4, 4, ".ppm")) {
+		fmt = HEATMAP_PPM;
+	}
+	if (0 != pvm->SaveHeatMap(fname, fmt)) {
+		cout << "ERROR: Unable to save memory heat map: " << fname << endl;
+		return 2;
+	}
+	cout << "Memory heat map saved to: " << fname << endl;
+	return 0;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ToggleHeatMap()
+ * Purpose:		Enable/disable memory heat map, counting starts from
+ *            zero each time it is enabled.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ToggleHeatMap()
+{
+	if (pvm->IsHeatMapActive()) {
+		pvm->EnableHeatMap(false);
+		cout << "Memory heat map was disabled." << endl;
+	} else {
+		pvm->EnableHeatMap(true);
+		pvm->ResetHeatMap();
+		cout << "Memory heat map was enabled." << endl;
+	}
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		ToggleProfiler()
+ * Purpose:		Enable/disable execution profiler, counting starts
+ *            from zero each time it is enabled.
+ * Arguments:
+ * Returns:
+ *--------------------------------------------------------------------
+ */
+void ToggleProfiler()
+{
+	if (pvm->IsProfilerActive()) {
+		pvm->EnableProfiler(false);
+		cout << "Execution profiler was disabled." << endl;
+	} else {
+		pvm->EnableProfiler(true);
+		pvm->ResetProfiler();
+		cout << "Execution profiler was enabled." << endl;
+	}
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		ExecHistory()
@@ -690,6 +992,8 @@ void DisassembleMemory()
 	cout << endl;
 	for (unsigned int addr = addrbeg; addr <= addrend;) {
 		char instrbuf[DISS_BUF_SIZE];
+		string label = pvm->GetSymbolLabel((unsigned short)addr);
+		if (label.length() > 0) cout << label << ":" << endl;
 		addr = pvm->Disassemble((unsigned short)addr, instrbuf);
 		cout << instrbuf << endl;
 	}	
@@ -816,6 +1120,238 @@ void TogglePerfStats()
 	}
 }
 
+/*
+ *--------------------------------------------------------------------
+ * Method:		BatchRun()
+ * Purpose:		Run loaded program non-interactively with output
+ *            capture enabled, then save captured output to file
+ *            and/or compare it with the golden output file.
+ * Arguments:	n/a
+ * Returns:		int - 0 if output matches golden file (or no golden
+ *                  file given), 1 if mismatch, 2 if file I/O error
+ *--------------------------------------------------------------------
+ */
+int BatchRun()
+{
+	int ret = 0;
+
+	pvm->EnableOutputCapture(0);
+	preg = pvm->RunBatch(reset, maxcycles);
+	pvm->DisableOutputCapture();
+	string out = pvm->GetOutputCapture();
+	unsigned long count = pvm->GetOutputCaptureCount();
+	unsigned long hash = pvm->GetOutputCaptureHash();
+	cout << endl;
+	cout << "Stopped at: $" << hex << preg->PtrAddr;
+	cout << (preg->LastRTS ? " (last RTS)" : (preg->SoftIrq ? " (BRK)" : ""));
+	cout << endl;
+	cout << "Output: " << dec << count << " bytes, hash: $" << hex << hash;
+	cout << dec << endl;
+	if (count > out.length()) {
+		cout << "WARNING: Output truncated to " << out.length() << " bytes." << endl;
+	}
+	if (pvm->GetGraphDispActive()) {
+		cout << "Graphics: " << pvm->GetPerfStats().gr_pixels << " pixels, ";
+		cout << pvm->GetPerfStats().gr_pixrate << " pixels/sec" << endl;
+	}
+	bool anyint = (pvm->GetNmiStats().count > 0);
+	for (int src = 0; src < INTC_NUM_SRC; src++) {
+		if (pvm->GetIntStats(src).count > 0) anyint = true;
+	}
+	if (anyint) ShowIntStats();
+	if (pvm->IsProfilerActive()) ShowProfile();
+	if (callgrfile.length() > 0 && 0 != SaveCallGraph(callgrfile)) ret = 2;
+	if (opstatsfile.length() > 0 && 0 != SaveOpStats(opstatsfile)) ret = 2;
+	if (heatfile.length() > 0 && 0 != SaveHeatMap(heatfile)) ret = 2;
+	if (pvm->GetDiskActive()) {
+		if (0 != pvm->SyncDisk()) {
+			cout << "ERROR: Unable to write disk images." << endl;
+		}
+		MassStorFlushStats fst = pvm->GetDiskFlushStats();
+		if (fst.requests > 0) {
+			cout << "Disk: " << fst.bytes << " bytes in " << fst.requests;
+			cout << " writes / " << fst.batches << " batches, queue max ";
+			cout << fst.queue_max << ", latency avg/max ";
+			cout << (fst.lat_total / fst.requests) << "/" << fst.lat_max;
+			cout << " usec" << endl;
+		}
+		if (pvm->GetDiskNumOpen() > 0) {
+			cout << "Disk images: " << pvm->GetDiskNumOpen() << " open, ";
+			cout << pvm->GetDiskMappedSize() << " bytes mapped" << endl;
+		}
+	}
+	if (imgfile.length() > 0) {
+		if (0 != pvm->SaveGraphDispImage(imgfile)) {
+			cout << "ERROR: Unable to save graphics image: " << imgfile << endl;
+			return 2;
+		}
+		cout << "Graphics image saved to: " << imgfile << endl;
+	}
+	if (capfile.length() > 0) {
+		FILE *fp = fopen(capfile.c_str(), "wb");
+		if (NULL == fp) {
+			cout << "ERROR: Unable to create file: " << capfile << endl;
+			return 2;
+		}
+		fwrite(out.data(), 1, out.length(), fp);
+		fclose(fp);
+		cout << "Output saved to: " << capfile << endl;
+	}
+	if (goldfile.length() > 0) {
+		FILE *fp = fopen(goldfile.c_str(), "rb");
+		if (NULL == fp) {
+			cout << "ERROR: Unable to open file: " << goldfile << endl;
+			return 2;
+		}
+		// compare count and hash of the entire golden file, locate the
+		// first difference within captured part of the output
+		unsigned long gcount = 0, ghash = FNV1A_OFFSET, diffpos = count;
+		int c = 0;
+		while (EOF != (c = fgetc(fp))) {
+			if (diffpos == count && (gcount >= out.length()
+					|| (unsigned char)out[gcount] != (unsigned char)c)) {
+				diffpos = gcount;
+			}
+			ghash = ((ghash ^ (unsigned char)c) * FNV1A_PRIME) & 0xFFFFFFFFUL;
+			gcount++;
+		}
+		fclose(fp);
+		if (gcount == count && ghash == hash) {
+			cout << "PASS: Output matches " << goldfile << endl;
+		} else {
+			if (diffpos == count) diffpos = min(gcount, count);
+			cout << "FAIL: Output differs from " << goldfile;
+			cout << " at offset " << diffpos << " (expected " << gcount;
+			cout << " bytes, got " << count << ")." << endl;
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ *--------------------------------------------------------------------
+ * Method:		DiskTool()
+ * Purpose:		Execute disk image command given in command line
+ *            (-D), no emulation is started.
+ *            list    - show directory of disk image
+ *            import  - load .d64 file to disk image
+ *            export  - save disk image as .d64 file
+ *            extract - save all files of disk image to directory
+ * Arguments:	n/a
+ * Returns:		int - 0 if OK, 1 if bad command / drive / file not
+ *                  found, 2 if file I/O error
+ *--------------------------------------------------------------------
+ */
+int DiskTool()
+{
+	static const char *ftypes[] = {"DEL", "SEQ", "PRG", "USR", "REL"};
+	int ret = 0;
+
+	if (diskdrive < 0 || diskdrive >= MassStorage::num_of_images) {
+		cout << "ERROR: Drive # must be 0 - ";
+		cout << (MassStorage::num_of_images - 1) << "." << endl;
+		return 1;
+	}
+	MassStorage *pms = new MassStorage();
+	if (NULL == pms) throw MKGenException("Out of memory - MassStorage");
+	// opening missing image would create and format it
+	if (0 != diskcmd.compare("import") && !pms->ImageExists(diskdrive)) {
+		cout << "ERROR: Disk image #" << diskdrive << " does not exist." << endl;
+		delete pms;
+		return 1;
+	}
+	vector<MassStorDirEntry> dir;
+	if (0 != diskcmd.compare("import")) dir = pms->GetDirectory(diskdrive);
+	if (0 == diskcmd.compare("list")) {
+		unsigned char *pbam = pms->ReadSectorData(diskdrive, MassStorage::dir_track, 0);
+		if (NULL == pbam) {
+			cout << "ERROR: Unable to open disk image #" << diskdrive << "." << endl;
+			ret = 2;
+		} else {
+			string dname((const char *) pbam + 0x90, 16);
+			dname.erase(dname.find_last_not_of('\xa0') + 1);
+			int nfree = 0;
+			for (int t = 0; t < MassStorage::max_numof_tracks; t++) {
+				if (t + 1 != MassStorage::dir_track) nfree += pbam[0x04 + t * 4];
+			}
+			cout << "0 \"" << dname << "\"" << endl;
+			for (vector<MassStorDirEntry>::iterator it = dir.begin();
+					 it != dir.end();
+					 ++it
+					) {
+				cout << it->blocks << "\t\"" << it->name << "\"\t";
+				cout << ((it->type < 5) ? ftypes[it->type] : "???") << endl;
+			}
+			cout << nfree << " BLOCKS FREE." << endl;
+		}
+	} else if (0 == diskcmd.compare("import")) {
+		int err = pms->ImportD64(diskdrive, diskpath);
+		if (-2 == err) {
+			cout << "ERROR: " << diskpath << " has more than ";
+			cout << MassStorage::max_numof_tracks << " tracks, not supported." << endl;
+			ret = 1;
+		} else if (0 != err) {
+			cout << "ERROR: Unable to import " << diskpath << "." << endl;
+			ret = 2;
+		} else {
+			cout << "Imported " << diskpath << " to disk image #" << diskdrive;
+			cout << ", " << pms->GetDirectory(diskdrive).size() << " files." << endl;
+		}
+	} else if (0 == diskcmd.compare("export")) {
+		if (0 != pms->ExportD64(diskdrive, diskpath)) {
+			cout << "ERROR: Unable to export to " << diskpath << "." << endl;
+			ret = 2;
+		} else {
+			cout << "Exported disk image #" << diskdrive << " to " << diskpath;
+			cout << "." << endl;
+		}
+	} else if (0 == diskcmd.compare("extract")) {
+		string dirpath = (diskpath.length() > 0) ? diskpath : ".";
+		int nfiles = 0;
+		for (vector<MassStorDirEntry>::iterator it = dir.begin();
+				 it != dir.end();
+				 ++it
+				) {
+			vector<unsigned char> data;
+			if (MASSSTOR_FTYPE_DEL == it->type || it->type > MASSSTOR_FTYPE_USR) continue;
+			if (0 != pms->ReadFile(diskdrive, it->name, data)) {
+				cout << "WARNING: Unable to read file " << it->name << "." << endl;
+				ret = 1;
+				continue;
+			}
+			// host file name: printable characters only, type as extension
+			string fname = it->name;
+			for (string::iterator c = fname.begin(); c != fname.end(); ++c) {
+				if (!isprint((unsigned char) *c) || '/' == *c || '\\' == *c) *c = '_';
+			}
+			fname = dirpath + "/" + fname + "." + ftypes[it->type];
+			FILE *fp = fopen(fname.c_str(), "wb");
+			if (NULL == fp
+					|| fwrite(data.data(), 1, data.size(), fp) != data.size()) {
+				cout << "ERROR: Unable to write " << fname << "." << endl;
+				if (NULL != fp) fclose(fp);
+				ret = 2;
+				continue;
+			}
+			fclose(fp);
+			nfiles++;
+		}
+		cout << "Extracted " << nfiles << " files to " << dirpath << "." << endl;
+	} else {
+		cout << "ERROR: Unknown disk command: " << diskcmd << "." << endl;
+		ret = 1;
+	}
+	if (0 != pms->Sync() && 0 == ret) {
+		cout << "ERROR: Unable to write disk image #" << diskdrive << "." << endl;
+		ret = 2;
+	}
+	delete pms;
+
+	return ret;
+}
+
 /*
  *--------------------------------------------------------------------
  * Method:		LoadArgs()
@@ -836,6 +1372,35 @@ void TogglePerfStats()
  				loadhex = true;
  			} else if (!strcmp(argv[i], "-h")) {
  				needhelp = true;
+ 			} else if (!strcmp(argv[i], "-g") && i+1 < argc) {
+ 				goldfile = argv[++i];
+ 				batchrun = true;
+ 			} else if (!strcmp(argv[i], "-o") && i+1 < argc) {
+ 				capfile = argv[++i];
+ 				batchrun = true;
+ 			} else if (!strcmp(argv[i], "-l") && i+1 < argc) {
+ 				maxcycles = strtoul(argv[++i], NULL, 0);
+ 			} else if (!strcmp(argv[i], "-n")) {
+ 				headless = true;
+ 			} else if (!strcmp(argv[i], "-i") && i+1 < argc) {
+ 				imgfile = argv[++i];
+ 				batchrun = true;
+ 			} else if (!strcmp(argv[i], "-d") && i+1 < argc) {
+ 				dumpprefix = argv[++i];
+ 			} else if (!strcmp(argv[i], "-p")) {
+ 				profile = true;
+ 			} else if (!strcmp(argv[i], "-c") && i+1 < argc) {
+ 				callgrfile = argv[++i];
+ 			} else if (!strcmp(argv[i], "-m") && i+1 < argc) {
+ 				opstatsfile = argv[++i];
+ 			} else if (!strcmp(argv[i], "-a") && i+1 < argc) {
+ 				heatfile = argv[++i];
+ 			} else if (!strcmp(argv[i], "-s") && i+1 < argc) {
+ 				symfiles.push_back(argv[++i]);
+ 			} else if (!strcmp(argv[i], "-D") && i+2 < argc) {
+ 				diskcmd = argv[++i];
+ 				diskdrive = atoi(argv[++i]);
+ 				if (i+1 < argc && argv[i+1][0] != '-') diskpath = argv[++i];
  			} else {
  				ramfile = argv[i];
  			}
@@ -882,29 +1447,55 @@ int main(int argc, char *argv[]) {
 	string romfile("dummy.rom");
 	LoadArgs(argc, argv);
 	if (needhelp) { CmdArgHelp(argv[0]); exit(0); }
+	if (diskcmd.length() > 0) {
+		try {
+			return DiskTool();
+		} catch (MKGenException& ex) {
+			cout << ex.GetCause() << endl;
+			return 2;
+		}
+	}
 	if (loadbin && loadhex) {
 		cout << "ERROR: Can't load both formats at the same time." << endl;
 		exit(-1);
 	}	
 	try {
 		cout << endl;
-		if (loadbin) {
-			pvm = new VMachine(romfile, "dummy.ram");
-			if (NULL != pvm) {
-				PrintVMErr (pvm->LoadRAMBin(ramfile));
-				if (!reset) { reset = execvm = pvm->IsAutoReset(); }
+		pvm = new VMachine();
+		if (NULL == pvm) {
+			throw MKGenException("Out of memory - VMachine");
+		}
+		// graphics backend must be selected before memory definition
+		// (which may enable graphics device) is loaded
+		if (headless) pvm->SetGraphDispBackend(GRDISP_BACKEND_OFFSCREEN);
+		if (dumpprefix.length() > 0) pvm->SetGraphDispFrameDump(dumpprefix);
+		for (vector<string>::iterator it = symfiles.begin(); it != symfiles.end(); ++it) {
+			if (0 > pvm->LoadSymbols(*it)) {
+				cout << "WARNING: Unable to load symbols: " << *it << endl;
 			}
+		}
+		pvm->LoadROM(romfile);
+		if (loadbin) {
+			pvm->LoadRAM("dummy.ram");
+			PrintVMErr (pvm->LoadRAMBin(ramfile));
+			if (!reset) { reset = execvm = pvm->IsAutoReset(); }
 		} else if (loadhex) {
-			pvm = new VMachine(romfile, "dummy.ram");
-			if (NULL != pvm) PrintVMErr (pvm->LoadRAMHex(ramfile));
+			pvm->LoadRAM("dummy.ram");
+			PrintVMErr (pvm->LoadRAMHex(ramfile));
 		}
 		else {
-			pvm = new VMachine(romfile, ramfile);
-			if (NULL != pvm) PrintVMErr(pvm->GetLastError());
-			if (NULL != pvm && !reset) { reset = execvm = pvm->IsAutoReset(); }
+			pvm->LoadRAM(ramfile);
+			PrintVMErr(pvm->GetLastError());
+			if (!reset) { reset = execvm = pvm->IsAutoReset(); }
 		}
-		if (NULL == pvm) {
-			throw MKGenException("Out of memory - VMachine");
+		if (profile) pvm->EnableProfiler(true);
+		if (callgrfile.length() > 0) pvm->EnableCallGraph(true);
+		if (opstatsfile.length() > 0) pvm->EnableOpStats(true);
+		if (heatfile.length() > 0) pvm->EnableHeatMap(true);
+		if (batchrun) {
+			int bret = BatchRun();
+			delete pvm;
+			return bret;
 		}
 		pvm->ClearScreen();
 		CopyrightBanner();
@@ -1004,6 +1595,14 @@ int main(int argc, char *argv[]) {
 									cout << "OK" << endl;
 									show_menu = true;
 									break;
+				// Non-Maskable Interrupt
+				case '4':	pvm->NMInterrupt();
+									cout << "OK" << endl;
+									show_menu = true;
+									break;
+				// interrupt statistics
+				case '3':	ShowIntStats();
+									break;
 				// save snapshot of current CPU and memory in binary image
 				case 'y': {
 										string name;
@@ -1151,6 +1750,66 @@ int main(int argc, char *argv[]) {
 				// toggle enable/disable perf. stats
 				case '1':	TogglePerfStats();
 									break;
+				// toggle enable/disable execution profiler
+				case '5':	ToggleProfiler();
+									break;
+				// show execution profiler hot-spots
+				case '6':	ShowProfile();
+									break;
+				// toggle enable/disable call graph profiler
+				case '7':	ToggleCallGraph();
+									break;
+				// save call graph in folded stacks format
+				case '8': {
+										string name;
+										cout << "Enter file name: ";
+										cin >> name;
+										cout << " [" << name << "]" << endl;
+										SaveCallGraph(name);
+									}
+									break;
+				// load program symbols
+				case '9': {
+										string name;
+										cout << "Listing / label file name: ";
+										cin >> name;
+										cout << " [" << name << "]" << endl;
+										int n = pvm->LoadSymbols(name);
+										if (0 > n) {
+											cout << "ERROR: Unable to open file." << endl;
+										} else {
+											cout << "Symbols found: " << dec << n << ", total: ";
+											cout << pvm->GetNumSymbols() << endl;
+										}
+									}
+									break;
+				// toggle enable/disable instruction mix statistics
+				case '#':	ToggleOpStats();
+									break;
+				// save instruction mix statistics
+				case '%': {
+										string name;
+										cout << "Enter file name (.csv / .json): ";
+										cin >> name;
+										cout << " [" << name << "]" << endl;
+										SaveOpStats(name);
+									}
+									break;
+				// toggle enable/disable memory heat map
+				case '&':	ToggleHeatMap();
+									break;
+				// show memory heat map
+				case '*':	ShowHeatMap();
+									break;
+				// save memory heat map
+				case '@': {
+										string name;
+										cout << "Enter file name (.csv / .ppm): ";
+										cin >> name;
+										cout << " [" << name << "]" << endl;
+										SaveHeatMap(name);
+									}
+									break;
 
 				default:	cout << "ERROR: Unknown command." << endl;
 									break;
@@ -1158,6 +1817,10 @@ int main(int argc, char *argv[]) {
 
 		}
 		if (NULL != pconio) pconio->CloseCursesScr();
+		if (pvm->IsProfilerActive()) ShowProfile();
+		if (callgrfile.length() > 0) SaveCallGraph(callgrfile);
+		if (opstatsfile.length() > 0) SaveOpStats(opstatsfile);
+		if (heatfile.length() > 0) SaveHeatMap(heatfile);
 	}
 	catch (MKGenException& ex) {
 		if (NULL != pconio) pconio->CloseCursesScr();
@@ -1199,13 +1862,38 @@ void CmdArgHelp(string prgname)
 	cout << endl << endl;
 	cout << "Usage:" << endl << endl;
 	cout << "\t" << prgname;
-	cout << " [-h] | [ramdeffile] [-b | -x] [-r]" << endl;
+	cout << " [-h] | [ramdeffile] [-b | -x] [-r] [-g goldfile] [-o outfile]";
+	cout << " [-l cycles]" << endl;
+	cout << "\t\t[-n] [-i imgfile] [-d prefix] [-p] [-c foldfile]" << endl;
+	cout << "\t\t[-m statsfile] [-a heatfile] [-s symfile]" << endl;
+	cout << "\t\t[-D command drive [path]]" << endl;
 	cout << endl << endl;
 	cout << "Where:" << endl << endl;
 	cout << "\tramdeffile    - RAM definition file name" << endl;
 	cout << "\t-b            - specify input format as binary" << endl;
 	cout << "\t-x            - specify input format as Intel HEX" << endl;
 	cout << "\t-r            - after loading, perform CPU RESET" << endl;
+	cout << "\t-g goldfile   - batch mode, compare output with golden file" << endl;
+	cout << "\t-o outfile    - batch mode, save output to file" << endl;
+	cout << "\t-l cycles     - batch mode, limit of executed clock cycles" << endl;
+	cout << "\t-n            - headless, graphics rendered offscreen" << endl;
+	cout << "\t-i imgfile    - batch mode, save graphics to PPM file" << endl;
+	cout << "\t-d prefix     - save each graphics frame to PPM file" << endl;
+	cout << "\t                (headless only), prefix_NNNNNN.ppm" << endl;
+	cout << "\t-p            - enable execution profiler, show hot-spots" << endl;
+	cout << "\t                at exit" << endl;
+	cout << "\t-c foldfile   - enable call graph profiler, save cycles per" << endl;
+	cout << "\t                call path at exit (folded stacks format)" << endl;
+	cout << "\t-m statsfile  - count executions per op-code and addressing" << endl;
+	cout << "\t                mode, save at exit (.json or CSV)" << endl;
+	cout << "\t-a heatfile   - count memory accesses per page, save heat" << endl;
+	cout << "\t                map at exit (.ppm image or CSV)" << endl;
+	cout << "\t-s symfile    - load symbols from listing or label file" << endl;
+	cout << "\t                (ca65, AS65, ld65 -Ln), may be repeated" << endl;
+	cout << "\t-D command drive [path]" << endl;
+	cout << "\t              - disk image (0-9) command, no emulation:" << endl;
+	cout << "\t                list, import file.d64, export file.d64," << endl;
+	cout << "\t                extract [directory]" << endl;
 	cout << "\t-h            - print this help screen" << endl;
 	cout << R"(
 
@@ -1219,6 +1907,14 @@ on the contents of the memory definition file and enter the corresponding
 mode of operation as defined in that file.
 If input format is specified (-b|-x), program will load memory from the
 provided image file and enter the debug console menu.
+In batch mode (-g and/or -o), program runs the loaded code without the
+debug console until last RTS, BRK or cycles limit, captures the output
+of character I/O device, then saves it to outfile and/or compares it
+with goldfile. Exit code is 0 if output matches, 1 if it does not and
+2 on file I/O error.
+With -n, graphics device does not open a window, it only renders to
+memory, so graphics programs can be tested without a display. The
+final image (-i) or each presented frame (-d) can be saved to file.
 
 )";
 	cout << endl;
@@ -1383,6 +2079,11 @@ L - load memory image
                 line that follows sets the address in decimal or hexadecimal
                 format.
 
+      GRAPHFPS  Defines the frame rate of raster graphics device (how many
+                times per second the drawing is presented in the window).
+                The next line that follows sets the value in decimal format.
+                Default is 60.
+
      NOTE: The binary image file can contain a header which contains
            definitions corresponding to the above parameters at fixed
            positions. This header is created when user saves the snapshot of
@@ -1427,6 +2128,44 @@ Z - enable/disable debug traces
     Display recent debug traces.
 1 - enable/disable performance stats
     Toggle enable/disable emulation speed measurement.
+3 - show interrupt stats
+    Display # of interrupt requests per source (VIA, ACIA, ...) and NMI,
+    how many of them CPU serviced and the latency in clock cycles from
+    the request to the first instruction of interrupt handler.
+4 - NMI
+    Send Non-Maskable Interrupt to the CPU.
+5 - enable/disable execution profiler
+    Count executed instructions and clock cycles per address. Counters
+    start from zero when profiler is enabled.
+6 - show profiler hot-spots
+    Display addresses which took the most clock cycles with the
+    disassembled instructions. Also shown at exit if profiler is enabled.
+7 - enable/disable call graph profiler
+    Follow subroutine calls and interrupts, count clock cycles per call
+    path. Paths are collected from scratch when profiler is enabled.
+8 - save call graph
+    Save call paths with clock cycles to file in folded stacks format,
+    which flame graph tools take as input.
+9 - load symbols
+    Load labels from assembler listing (ca65, AS65) or label file
+    (ld65 -Ln, LABEL = $addr). Addresses in disassembly, op-codes
+    history and profiler reports are then shown as label+offset.
+# - enable/disable instruction mix statistics
+    Count executions and clock cycles per op-code and addressing mode,
+    taken / not taken branches and page crossing penalties. Counters
+    start from zero when statistics are enabled.
+% - save instruction mix statistics
+    Save counters to file, JSON if file name ends with .json, otherwise
+    CSV.
+& - enable/disable memory heat map
+    Count CPU reads, writes, device hits and op-code fetches per memory
+    page. Counters start from zero when heat map is enabled.
+* - show memory heat map
+    Display 16 x 16 table of memory pages with accesses in logarithmic
+    scale, pages with device hits are marked with D.
+@ - save memory heat map
+    Save counters to file, PPM image if file name ends with .ppm,
+    otherwise CSV table.
                     
 NOTE:
     1. If no arguments provided, each command will prompt user to enter
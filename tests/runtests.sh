@@ -0,0 +1,124 @@
+#!/bin/sh
+#
+# VM65 regression tests.
+#
+# Usage: runtests.sh [vm65 executable]
+#
+# Test programs (NAME.dat) are run in batch mode, their character I/O
+# output is compared with NAME.gold. Files written by the emulator and
+# the disk image tool are compared with NAME.*.gold files.
+# Tests run in a temporary directory, so disk images (DISKn_n.disk) of
+# current directory are not touched.
+#
+
+VM65=${1:-./vm65}
+MAXSTEPS=1000000
+
+case "$VM65" in
+	/*) ;;
+	*) VM65="$(pwd)/$VM65" ;;
+esac
+TESTDIR=$(cd "$(dirname "$0")" && pwd)
+WORKDIR=$(mktemp -d "${TMPDIR:-/tmp}/vm65test.XXXXXX") || exit 2
+trap 'rm -rf "$WORKDIR"' EXIT
+cd "$WORKDIR" || exit 2
+# keep terminal control sequences out of the output
+TERM=dumb
+export TERM
+
+npass=0
+nfail=0
+
+pass() {
+	npass=$((npass + 1))
+	echo "PASS: $1"
+}
+
+fail() {
+	nfail=$((nfail + 1))
+	echo "FAIL: $1"
+}
+
+# run_prog NAME [options] - run NAME.dat, compare output with NAME.gold
+run_prog() {
+	name=$1
+	shift
+	if "$VM65" "$TESTDIR/$name.dat" -n -g "$TESTDIR/$name.gold" \
+			-l $MAXSTEPS "$@" </dev/null >"$name.log" 2>&1; then
+		pass "$name"
+	else
+		fail "$name"
+	fi
+}
+
+# check NAME FILE GOLD - compare file written by test with golden file
+check() {
+	if cmp -s "$2" "$TESTDIR/$3"; then
+		pass "$1"
+	else
+		fail "$1"
+	fi
+}
+
+# disk_tool OUTFILE ARGS - run disk image command, save its output
+disk_tool() {
+	out=$1
+	shift
+	"$VM65" -D "$@" </dev/null 2>&1 | tr -d '\r' >"$out"
+}
+
+# CPU timing: extra cycles of taken branches and page crossing
+run_prog pagecross
+
+# event scheduler: VIA timers due order and timing
+run_prog evtsched
+
+# interrupt controller: source priority and masking
+run_prog intctrl
+
+# memory heat map counters
+run_prog heatmap -a heatmap.csv
+check heatmap.csv heatmap.csv heatmap.csv.gold
+
+# symbols from ca65, AS65, VICE label and assignment files
+run_prog symtab -c symtab.fold \
+	-s "$TESTDIR/symtab_ca65.lst" -s "$TESTDIR/symtab_as65.lst" \
+	-s "$TESTDIR/symtab_vice.lbl" -s "$TESTDIR/symtab_assign.inc"
+check symtab.fold symtab.fold symtab.fold.gold
+
+# disk controller writes file to image #1
+run_prog disk
+disk_tool list1.txt list 1
+check disk_list list1.txt disk_list.gold
+
+# D64 export / import round trip, file data at track 17, sector 0
+disk_tool export1.txt export 1 disk1.d64
+disk_tool import3.txt import 3 disk1.d64
+disk_tool export3.txt export 3 disk3.d64
+if cmp -s disk1.d64 disk3.d64 && [ "$(wc -c <disk1.d64)" -eq 174848 ] \
+		&& [ "$(dd if=disk1.d64 bs=1 skip=86018 count=12 2>/dev/null)" \
+				 = "HELLO, DISK!" ]; then
+	pass d64
+else
+	fail d64
+fi
+
+# journal replay after crash: journal without commit record is
+# discarded, committed journal is written to image when it is opened
+cp "$TESTDIR/disk_torn.jrnl" DISK3_3.disk.jrnl
+disk_tool list3.txt list 3
+if [ ! -f DISK3_3.disk.jrnl ]; then
+	check disk_torn list3.txt disk_list.gold
+else
+	fail disk_torn
+fi
+cp "$TESTDIR/disk_commit.jrnl" DISK3_3.disk.jrnl
+disk_tool list3.txt list 3
+if [ ! -f DISK3_3.disk.jrnl ]; then
+	check disk_replay list3.txt disk_replay.gold
+else
+	fail disk_replay
+fi
+
+echo "$npass passed, $nfail failed."
+[ "$nfail" -eq 0 ]